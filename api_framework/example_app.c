@@ -13,6 +13,8 @@
 #include "logger.h"
 #include "router.h"
 #include "json.h"
+#include "latency.h"
+#include "admin.h"
 
 // 模擬的資料庫
 typedef struct
@@ -261,10 +263,24 @@ void home_page(Request *req, Response *res)
 int main(int argc, char *argv[])
 {
     int port = DEFAULT_PORT;
+    int metrics_port = 0;
+    const char *metrics_bind = NULL;
 
-    if (argc > 1)
+    // 參數：[port] [--metrics-port N] [--metrics-bind ADDR]
+    for (int i = 1; i < argc; i++)
     {
-        port = atoi(argv[1]);
+        if (strcmp(argv[i], "--metrics-port") == 0 && i + 1 < argc)
+        {
+            metrics_port = atoi(argv[++i]); // 追蹤控制只在這個埠上提供
+        }
+        else if (strcmp(argv[i], "--metrics-bind") == 0 && i + 1 < argc)
+        {
+            metrics_bind = argv[++i]; // 預設只監聽 127.0.0.1
+        }
+        else
+        {
+            port = atoi(argv[i]);
+        }
     }
 
     // 設置信號處理
@@ -272,6 +288,7 @@ int main(int argc, char *argv[])
 #ifndef _WIN32
     signal(SIGTERM, signal_handler);
 #endif
+    latency_install_dump_signal(); // kill -USR1 <pid> 輸出延遲報表
 
     // 初始化
     init_logger("server.log");
@@ -304,6 +321,12 @@ int main(int argc, char *argv[])
     }
 
     log_message(LOG_INFO, "API Server started on port %d", port);
+
+    // 選用的管理埠
+    if (metrics_port > 0 && admin_start(metrics_bind, metrics_port) != 0)
+    {
+        log_message(LOG_WARNING, "Admin endpoint disabled");
+    }
     printf("API Server running on http://localhost:%d\n", port);
     printf("Visit http://localhost:%d for API documentation\n", port);
     printf("Press Ctrl+C to stop\n");
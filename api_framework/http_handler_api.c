@@ -16,11 +16,42 @@
 #include "logger.h"
 #include "file_utils.h"
 #include "router.h"
+#include "metrics.h"
+#include "admin.h"
+#include "latency.h"
+#include "http_utils.h"
+#include "compress.h"
 
 int router_enabled = 1; // 框架模式啟用路由
 
-static void send_response_with_headers(int client_socket, Response *res)
+// 依 Accept-Encoding 壓縮可壓縮類型的回應內容，並加上對應的標頭
+// 回傳要附加的標頭（靜態字串），未壓縮時 res 不變
+static const char *compress_response(Response *res, const char *accept_encoding)
 {
+    if (!compress_available() || !res->content_type || !compress_is_compressible(res->content_type))
+        return "";
+
+    CompressCodec codec = accept_encoding ? compress_negotiate(accept_encoding) : COMPRESS_NONE;
+    if (codec == COMPRESS_NONE || res->body_length < COMPRESS_MIN_SIZE)
+        return "Vary: Accept-Encoding\r\n";
+
+    size_t compressed_len;
+    char *compressed = compress_buffer(codec, compress_level(codec, 1), res->body, res->body_length, &compressed_len);
+    if (!compressed)
+        return "Vary: Accept-Encoding\r\n";
+
+    free(res->body);
+    res->body = compressed;
+    res->body_length = (int)compressed_len;
+    return codec == COMPRESS_ZSTD ? "Content-Encoding: zstd\r\nVary: Accept-Encoding\r\n"
+                                  : "Content-Encoding: gzip\r\nVary: Accept-Encoding\r\n";
+}
+
+// head_only 為 1 時（HEAD 請求）只送出標頭，Content-Length 仍為 GET 的內容長度
+static void send_response_with_headers(int client_socket, Response *res, const char *accept_encoding, int head_only)
+{
+    const char *encoding_headers = compress_response(res, accept_encoding);
+
     char header[2048];
     time_t now = time(NULL);
     char date[100];
@@ -41,6 +72,9 @@ static void send_response_with_headers(int client_socket, Response *res)
     case 404:
         status_text = "Not Found";
         break;
+    case 405:
+        status_text = "Method Not Allowed";
+        break;
     case 500:
         status_text = "Internal Server Error";
         break;
@@ -53,19 +87,24 @@ static void send_response_with_headers(int client_socket, Response *res)
              "Content-Type: %s\r\n"
              "Content-Length: %d\r\n"
              "Access-Control-Allow-Origin: *\r\n"
-             "Access-Control-Allow-Methods: GET, POST, PUT, DELETE, OPTIONS\r\n"
+             "Access-Control-Allow-Methods: GET, HEAD, POST, PUT, DELETE, PATCH, OPTIONS\r\n"
              "Access-Control-Allow-Headers: Content-Type\r\n"
              "Connection: close\r\n"
-             "%s"
+             "%s%s"
              "\r\n",
              res->status_code, status_text, date, res->content_type, res->body_length,
-             res->headers ? res->headers : "");
+             encoding_headers, res->headers ? res->headers : "");
 
-    send(client_socket, header, strlen(header), 0);
-    if (res->body_length > 0)
+    int header_len = strlen(header);
+    send(client_socket, header, header_len, 0);
+    int body_length = head_only ? 0 : res->body_length;
+    if (body_length > 0)
     {
-        send(client_socket, res->body, res->body_length, 0);
+        send(client_socket, res->body, body_length, 0);
     }
+
+    latency_mark(LAT_SENT);
+    metrics_http_response(res->status_code, header_len + body_length);
 }
 
 void send_response(int client_socket, const char *status, const char *content_type, const char *body, int body_len)
@@ -85,11 +124,14 @@ void send_response(int client_socket, const char *status, const char *content_ty
              "\r\n",
              status, date, content_type, body_len);
 
-    send(client_socket, header, strlen(header), 0);
+    int header_len = strlen(header);
+    send(client_socket, header, header_len, 0);
     if (body_len > 0)
     {
         send(client_socket, body, body_len, 0);
     }
+
+    metrics_http_response(atoi(status), header_len + body_len);
 }
 
 void handle_client(int client_socket)
@@ -103,6 +145,8 @@ void handle_client(int client_socket)
     }
 
     buffer[received] = '\0';
+    latency_mark(LAT_FIRST_BYTE);
+    metrics_http_request(received);
 
     // 解析 HTTP 請求
     char method[16], path[256], version[16];
@@ -116,19 +160,46 @@ void handle_client(int client_socket)
     {
         const char *cors_response = "HTTP/1.1 200 OK\r\n"
                                     "Access-Control-Allow-Origin: *\r\n"
-                                    "Access-Control-Allow-Methods: GET, POST, PUT, DELETE, OPTIONS\r\n"
+                                    "Access-Control-Allow-Methods: GET, HEAD, POST, PUT, DELETE, PATCH, OPTIONS\r\n"
                                     "Access-Control-Allow-Headers: Content-Type\r\n"
                                     "Content-Length: 0\r\n"
                                     "\r\n";
         send(client_socket, cors_response, strlen(cors_response), 0);
+        metrics_http_response(200, strlen(cors_response));
         return;
     }
 
     log_message(LOG_INFO, "%s %s", method, path);
 
+    char accept_encoding[256];
+    const char *accept = NULL;
+    if (http_find_header(buffer, "Accept-Encoding", accept_encoding, sizeof(accept_encoding)) >= 0)
+        accept = accept_encoding;
+
     Request req = {0};
     Response res = {0};
 
+    // 唯讀的管理端點 (/metrics, /admin/latency) 不經過路由器；追蹤控制只在 --metrics-port 上提供
+    char *admin_body = NULL;
+    const char *admin_type = NULL;
+    int admin_status = admin_handle(path, &admin_body, &admin_type);
+    if (admin_status)
+    {
+        static LatencyRoute *admin_route = NULL;
+        if (!__atomic_load_n(&admin_route, __ATOMIC_ACQUIRE))
+            __atomic_store_n(&admin_route, latency_route("admin"), __ATOMIC_RELEASE);
+        latency_set_route(admin_route);
+
+        res.status_code = admin_status;
+        res.content_type = strdup(admin_type);
+        res.body = admin_body;
+        res.body_length = strlen(admin_body);
+        send_response_with_headers(client_socket, &res, accept, strcmp(method, "HEAD") == 0);
+        free(res.content_type);
+        free(res.body);
+        return;
+    }
+
     // 解析請求
     req.method = parse_method(method);
 
@@ -155,10 +226,11 @@ void handle_client(int client_socket)
     }
 
     // 處理路由
+    latency_mark(LAT_PARSED);
     router_handle(&req, &res);
 
     // 發送回應
-    send_response_with_headers(client_socket, &res);
+    send_response_with_headers(client_socket, &res, accept, req.method == HTTP_HEAD);
 
     // 清理
     if (res.content_type)
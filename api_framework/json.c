@@ -75,6 +75,29 @@ void json_add_bool(JsonBuilder *json, const char *key, int value)
     json->size += strlen(temp);
 }
 
+// key 為 NULL 時建立匿名物件（用於陣列元素）
+void json_start_object(JsonBuilder *json, const char *key)
+{
+    json_add_comma(json);
+    size_t needed = (key ? strlen(key) : 0) + 10;
+    json_ensure_capacity(json, needed);
+
+    char temp[256];
+    if (key)
+        sprintf(temp, "\"%s\":{", key);
+    else
+        strcpy(temp, "{");
+    strcat(json->buffer, temp);
+    json->size += strlen(temp);
+}
+
+void json_end_object(JsonBuilder *json)
+{
+    json_ensure_capacity(json, 2);
+    strcat(json->buffer, "}");
+    json->size++;
+}
+
 void json_start_array(JsonBuilder *json, const char *key)
 {
     json_add_comma(json);
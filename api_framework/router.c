@@ -1,114 +1,431 @@
+// router.c - 路由器實現
+//
+// 路由以壓縮前綴樹（radix tree）存放：靜態部分依共同前綴合併成節點，
+// ":name" 與 "*name" 分別是節點的參數子節點與萬用字元子節點。
+// 比對時沿著路徑走一次，不複製路徑，只在遇到參數時才複製參數值；
+// 靜態子節點失敗時才退回嘗試參數，再退回萬用字元。
+// 每個方法各有一棵樹，請求只比對自己方法的路由；找不到時才查其他方法的樹，以回應 405。
+// 路由可在伺服器執行中加入：比對持有讀取鎖，加入持有寫入鎖；路由加入後不會移除，
+// 因此比對完成即可放開鎖再呼叫處理函數（處理函數本身也可以註冊路由）。
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 #include "router.h"
 #include "logger.h"
 
-static Route routes[MAX_ROUTES];
+typedef struct RouteNode
+{
+    char *prefix; // 靜態節點的標籤；參數與萬用字元節點為 NULL
+    size_t prefix_len;
+    char *name;   // 參數或萬用字元的名稱（不含 ':' 與 '*'）
+    struct RouteNode **children; // 靜態子節點，各自的第一個字元都不同
+    char *indices;               // children[i] 標籤的第一個字元，比對時不必碰觸子節點
+    int child_count;
+    struct RouteNode *param;
+    struct RouteNode *wildcard;
+    Route *route; // 在此結束的路由
+} RouteNode;
+
+static pthread_rwlock_t router_lock = PTHREAD_RWLOCK_INITIALIZER;
+static RouteNode *route_trees[HTTP_METHOD_COUNT];
+static Route **routes = NULL; // 所有路由，依註冊順序
 static int route_count = 0;
+static int route_capacity = 0;
 
-void router_init(void)
+static RouteNode *route_node_create(const char *prefix, size_t prefix_len)
 {
-    route_count = 0;
-    memset(routes, 0, sizeof(routes));
+    RouteNode *node = calloc(1, sizeof(RouteNode));
+    if (!node)
+        return NULL;
+    if (prefix)
+    {
+        node->prefix = malloc(prefix_len + 1);
+        if (!node->prefix)
+        {
+            free(node);
+            return NULL;
+        }
+        memcpy(node->prefix, prefix, prefix_len);
+        node->prefix[prefix_len] = '\0';
+        node->prefix_len = prefix_len;
+    }
+    return node;
 }
 
-void router_add(HttpMethod method, const char *pattern, RouteHandler handler)
+static void route_node_free(RouteNode *node)
 {
-    if (route_count >= MAX_ROUTES)
-    {
-        log_message(LOG_ERROR, "Maximum routes reached");
+    if (!node)
         return;
+    for (int i = 0; i < node->child_count; i++)
+        route_node_free(node->children[i]);
+    route_node_free(node->param);
+    route_node_free(node->wildcard);
+    free(node->children);
+    free(node->indices);
+    free(node->prefix);
+    free(node->name);
+    free(node);
+}
+
+static int route_node_add_child(RouteNode *node, RouteNode *child)
+{
+    RouteNode **children = realloc(node->children, (node->child_count + 1) * sizeof(RouteNode *));
+    if (!children)
+        return -1;
+    node->children = children;
+    char *indices = realloc(node->indices, node->child_count + 1);
+    if (!indices)
+        return -1;
+    node->indices = indices;
+    node->children[node->child_count] = child;
+    node->indices[node->child_count] = child->prefix[0];
+    node->child_count++;
+    return 0;
+}
+
+// 在 node 下加入靜態字串 text（len > 0），必要時分割既有節點，回傳對應字串結尾的節點
+static RouteNode *route_insert_static(RouteNode *node, const char *text, size_t len)
+{
+    while (len > 0)
+    {
+        int index = 0;
+        while (index < node->child_count && node->indices[index] != text[0])
+            index++;
+        if (index == node->child_count)
+        {
+            RouteNode *child = route_node_create(text, len);
+            if (!child || route_node_add_child(node, child) != 0)
+            {
+                route_node_free(child);
+                return NULL;
+            }
+            return child;
+        }
+
+        RouteNode *child = node->children[index];
+        size_t common = 0;
+        while (common < child->prefix_len && common < len && child->prefix[common] == text[common])
+            common++;
+
+        if (common < child->prefix_len)
+        {
+            // 分割：共同前綴成為新節點，原節點保留其餘部分與所有子節點
+            RouteNode *split = route_node_create(child->prefix, common);
+            if (!split)
+                return NULL;
+            RouteNode *tail = route_node_create(child->prefix + common, child->prefix_len - common);
+            if (!tail)
+            {
+                route_node_free(split);
+                return NULL;
+            }
+            free(child->prefix);
+            child->prefix = tail->prefix;
+            child->prefix_len = tail->prefix_len;
+            tail->prefix = NULL;
+            route_node_free(tail);
+            if (route_node_add_child(split, child) != 0)
+            {
+                route_node_free(split);
+                return NULL;
+            }
+            node->children[index] = split;
+            child = split;
+        }
+        node = child;
+        text += common;
+        len -= common;
     }
+    return node;
+}
 
-    routes[route_count].method = method;
-    routes[route_count].pattern = strdup(pattern);
-    routes[route_count].handler = handler;
-    route_count++;
+// 取得 node 的參數或萬用字元子節點，名稱不同時視為衝突，回傳 NULL
+static RouteNode *route_insert_dynamic(RouteNode **slot, const char *name, size_t len)
+{
+    if (*slot)
+        return strlen((*slot)->name) == len && memcmp((*slot)->name, name, len) == 0 ? *slot : NULL;
 
-    log_message(LOG_INFO, "Added route: %s %s", get_method_string(method), pattern);
+    RouteNode *node = route_node_create(NULL, 0);
+    if (!node || !(node->name = malloc(len + 1)))
+    {
+        free(node);
+        return NULL;
+    }
+    memcpy(node->name, name, len);
+    node->name[len] = '\0';
+    *slot = node;
+    return node;
 }
 
-// 解析路徑參數 (例如 /users/:id 匹配 /users/123)
-static int match_route(const char *pattern, const char *path, Request *req)
+// 在 tree 中依 pattern 建立節點，回傳路由結束處的節點；pattern 不合法或與既有路由衝突時回傳 NULL
+static RouteNode *route_insert(RouteNode *tree, const char *pattern)
 {
-    // 完全匹配的情況
-    if (strcmp(pattern, path) == 0)
+    size_t len = strlen(pattern);
+    // 結尾的 '/' 不影響比對（根路徑除外）
+    while (len > 1 && pattern[len - 1] == '/')
+        len--;
+
+    RouteNode *node = tree;
+    size_t i = 0;
+    while (node && i < len)
     {
-        return 1;
+        if (i > 0 && pattern[i - 1] == '/' && (pattern[i] == ':' || pattern[i] == '*'))
+        {
+            size_t start = ++i;
+            if (pattern[start - 1] == '*')
+            {
+                // 萬用字元匹配其餘整個路徑，之後不能再有其他段
+                node = route_insert_dynamic(&node->wildcard, pattern + start, len - start);
+                break;
+            }
+            while (i < len && pattern[i] != '/')
+                i++;
+            node = route_insert_dynamic(&node->param, pattern + start, i - start);
+            continue;
+        }
+
+        // 靜態部分一直到下一個以 ':' 或 '*' 開頭的段
+        size_t end = i + 1;
+        while (end < len && !(pattern[end - 1] == '/' && (pattern[end] == ':' || pattern[end] == '*')))
+            end++;
+        node = route_insert_static(node, pattern + i, end - i);
+        i = end;
     }
+    return node;
+}
 
-    // 帶參數的路由匹配
-    char pattern_copy[256];
-    char path_copy[256];
-    strcpy(pattern_copy, pattern);
-    strcpy(path_copy, path);
+// 需持有寫入鎖
+static void router_free_all(void)
+{
+    for (int i = 0; i < route_count; i++)
+    {
+        free(routes[i]->pattern);
+        free(routes[i]);
+    }
+    free(routes);
+    routes = NULL;
+    route_count = 0;
+    route_capacity = 0;
+    for (int m = 0; m < HTTP_METHOD_COUNT; m++)
+    {
+        route_node_free(route_trees[m]);
+        route_trees[m] = NULL;
+    }
+}
 
-    // 如果路徑結尾有 /，移除它
-    int plen = strlen(pattern_copy);
-    int pathlen = strlen(path_copy);
-    if (plen > 1 && pattern_copy[plen - 1] == '/')
-        pattern_copy[plen - 1] = '\0';
-    if (pathlen > 1 && path_copy[pathlen - 1] == '/')
-        path_copy[pathlen - 1] = '\0';
+void router_init(void)
+{
+    pthread_rwlock_wrlock(&router_lock);
+    router_free_all();
+    pthread_rwlock_unlock(&router_lock);
+}
+
+void router_add(HttpMethod method, const char *pattern, RouteHandler handler)
+{
+    if ((int)method < 0 || method >= HTTP_METHOD_COUNT || pattern[0] != '/')
+    {
+        log_message(LOG_ERROR, "Invalid route: %s %s", get_method_string(method), pattern);
+        return;
+    }
 
-    char *pattern_token = strtok(pattern_copy, "/");
-    char *path_token = strtok(path_copy, "/");
+    Route *route = calloc(1, sizeof(Route));
+    if (!route || !(route->pattern = strdup(pattern)))
+    {
+        free(route);
+        log_message(LOG_ERROR, "Out of memory adding route %s %s", get_method_string(method), pattern);
+        return;
+    }
+    route->method = method;
+    route->handler = handler;
 
-    req->param_count = 0;
+    // 延遲分佈的登記有自己的鎖，在取得寫入鎖之前完成
+    char label[300];
+    snprintf(label, sizeof(label), "%s %s", get_method_string(method), pattern);
+    route->latency = latency_route(label);
 
-    while (pattern_token && path_token)
+    pthread_rwlock_wrlock(&router_lock);
+    if (route_count == route_capacity)
     {
-        if (pattern_token[0] == ':')
-        {
-            // 參數
-            strcpy(req->params[req->param_count], pattern_token + 1);
-            strcpy(req->param_values[req->param_count], path_token);
-            req->param_count++;
-        }
-        else if (strcmp(pattern_token, path_token) != 0)
+        int capacity = route_capacity ? route_capacity * 2 : 64;
+        Route **grown = realloc(routes, capacity * sizeof(Route *));
+        if (!grown)
         {
-            // 不匹配
-            return 0;
+            pthread_rwlock_unlock(&router_lock);
+            log_message(LOG_ERROR, "Out of memory adding route %s %s", get_method_string(method), pattern);
+            free(route->pattern);
+            free(route);
+            return;
         }
+        routes = grown;
+        route_capacity = capacity;
+    }
 
-        pattern_token = strtok(NULL, "/");
-        path_token = strtok(NULL, "/");
+    if (!route_trees[method])
+        route_trees[method] = route_node_create("", 0);
+    RouteNode *node = route_trees[method] ? route_insert(route_trees[method], pattern) : NULL;
+    const char *existing = node && node->route ? node->route->pattern : NULL;
+    if (node && !existing)
+    {
+        node->route = route;
+        routes[route_count++] = route;
+    }
+    pthread_rwlock_unlock(&router_lock);
+
+    if (!node || existing)
+    {
+        if (existing)
+            log_message(LOG_WARNING, "Route %s %s already registered as %s, ignoring", get_method_string(method),
+                        pattern, existing);
+        else
+            log_message(LOG_ERROR, "Route %s %s conflicts with a parameter or wildcard of another name",
+                        get_method_string(method), pattern);
+        free(route->pattern);
+        free(route);
+        return;
     }
 
-    // 兩者都應該結束
-    return pattern_token == NULL && path_token == NULL;
+    log_message(LOG_INFO, "Added route: %s %s", get_method_string(method), pattern);
 }
 
-void router_handle(Request *req, Response *res)
+// 把參數加入 req（超過 MAX_PARAMS 時忽略），名稱與值過長時截斷
+static void route_push_param(Request *req, const char *name, const char *value, size_t value_len)
 {
-    log_message(LOG_DEBUG, "Router handling path: %s, method: %s", req->path, get_method_string(req->method));
+    if (req->param_count >= MAX_PARAMS)
+        return;
+    snprintf(req->params[req->param_count], sizeof(req->params[0]), "%s", name);
+    if (value_len >= sizeof(req->param_values[0]))
+        value_len = sizeof(req->param_values[0]) - 1;
+    memcpy(req->param_values[req->param_count], value, value_len);
+    req->param_values[req->param_count][value_len] = '\0';
+    req->param_count++;
+}
 
-    for (int i = 0; i < route_count; i++)
+// path 為 node 的標籤之後剩下的部分；失敗時 req 的參數數量恢復原狀
+static Route *route_match(const RouteNode *node, const char *path, Request *req)
+{
+    if (node->route && (path[0] == '\0' || (path[0] == '/' && path[1] == '\0')))
+        return node->route;
+
+    if (path[0] != '\0')
     {
-        if (routes[i].method == req->method)
+        for (int i = 0; i < node->child_count; i++)
         {
-            if (match_route(routes[i].pattern, req->path, req))
+            if (node->indices[i] != path[0])
+                continue;
+            const RouteNode *child = node->children[i];
+            if (strncmp(path, child->prefix, child->prefix_len) == 0)
             {
-                log_message(LOG_INFO, "Matched route: %s", routes[i].pattern);
-                routes[i].handler(req, res);
-                return;
+                Route *route = route_match(child, path + child->prefix_len, req);
+                if (route)
+                    return route;
             }
+            break;
         }
     }
 
-    // 沒有匹配的路由，返回 404
-    log_message(LOG_WARNING, "No route matched for: %s", req->path);
-    set_response(res, 404, "application/json", "{\"error\":\"Not Found\"}");
+    int saved = req->param_count;
+    if (node->param && path[0] != '\0' && path[0] != '/')
+    {
+        size_t len = 1;
+        while (path[len] && path[len] != '/')
+            len++;
+        route_push_param(req, node->param->name, path, len);
+        Route *route = route_match(node->param, path + len, req);
+        if (route)
+            return route;
+        req->param_count = saved;
+    }
+
+    if (node->wildcard && node->wildcard->route)
+    {
+        route_push_param(req, node->wildcard->name, path, strlen(path));
+        return node->wildcard->route;
+    }
+    return NULL;
 }
 
-void router_cleanup(void)
+// 列出 path 在其他方法下符合的路由，寫成 Allow 標頭的值（需持有讀取鎖）；都不符合時回傳 0
+static int router_allowed_methods(Request *req, char *allow, size_t size)
 {
-    for (int i = 0; i < route_count; i++)
+    int saved = req->param_count;
+    int found = 0;
+    size_t len = 0;
+    allow[0] = '\0';
+    static const HttpMethod order[] = {HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_DELETE, HTTP_PATCH};
+    for (size_t i = 0; i < sizeof(order) / sizeof(order[0]); i++)
     {
-        free(routes[i].pattern);
+        HttpMethod m = order[i];
+        // GET 的路由也回應 HEAD
+        int matched = route_trees[m] && route_match(route_trees[m], req->path, req);
+        req->param_count = saved;
+        if (!matched && m == HTTP_HEAD && route_trees[HTTP_GET])
+        {
+            matched = route_match(route_trees[HTTP_GET], req->path, req) != NULL;
+            req->param_count = saved;
+        }
+        if (!matched)
+            continue;
+        len += snprintf(allow + len, len < size ? size - len : 0, "%s%s", found ? ", " : "",
+                        get_method_string(m));
+        found = 1;
     }
-    route_count = 0;
+    if (found)
+        snprintf(allow + len, len < size ? size - len : 0, ", OPTIONS");
+    return found;
+}
+
+void router_handle(Request *req, Response *res)
+{
+    log_message(LOG_DEBUG, "Router handling path: %s, method: %s", req->path, get_method_string(req->method));
+
+    // 路徑參數接在查詢參數之後
+    Route *route = NULL;
+    char allow[128] = "";
+    pthread_rwlock_rdlock(&router_lock);
+    if ((int)req->method >= 0 && req->method < HTTP_METHOD_COUNT && route_trees[req->method])
+        route = route_match(route_trees[req->method], req->path, req);
+    // HEAD 沒有專屬路由時使用 GET 的路由，回應時不送出內容
+    if (!route && req->method == HTTP_HEAD && route_trees[HTTP_GET])
+        route = route_match(route_trees[HTTP_GET], req->path, req);
+    if (!route)
+        router_allowed_methods(req, allow, sizeof(allow));
+    pthread_rwlock_unlock(&router_lock);
+
+    if (route)
+    {
+        latency_mark(LAT_ROUTED);
+        latency_set_route(route->latency);
+        log_message(LOG_INFO, "Matched route: %s", route->pattern);
+        route->handler(req, res);
+        latency_mark(LAT_HANDLED);
+        return;
+    }
+
+    latency_mark(LAT_ROUTED);
+    if (allow[0])
+    {
+        // 路徑存在，但不接受這個方法
+        log_message(LOG_WARNING, "Method %s not allowed for: %s", get_method_string(req->method), req->path);
+        set_response(res, 405, "application/json", "{\"error\":\"Method Not Allowed\"}");
+        char header[160];
+        snprintf(header, sizeof(header), "Allow: %s\r\n", allow);
+        res->headers = strdup(header);
+    }
+    else
+    {
+        // 沒有匹配的路由，返回 404
+        log_message(LOG_WARNING, "No route matched for: %s", req->path);
+        set_response(res, 404, "application/json", "{\"error\":\"Not Found\"}");
+    }
+    latency_mark(LAT_HANDLED);
+}
+
+void router_cleanup(void)
+{
+    pthread_rwlock_wrlock(&router_lock);
+    router_free_all();
+    pthread_rwlock_unlock(&router_lock);
 }
 
 const char *get_method_string(HttpMethod method)
@@ -125,6 +442,8 @@ const char *get_method_string(HttpMethod method)
         return "DELETE";
     case HTTP_PATCH:
         return "PATCH";
+    case HTTP_HEAD:
+        return "HEAD";
     default:
         return "UNKNOWN";
     }
@@ -142,29 +461,40 @@ HttpMethod parse_method(const char *method_str)
         return HTTP_DELETE;
     if (strcmp(method_str, "PATCH") == 0)
         return HTTP_PATCH;
-    return HTTP_GET;
+    if (strcmp(method_str, "HEAD") == 0)
+        return HTTP_HEAD;
+    return HTTP_METHOD_COUNT;
 }
 
 void parse_query_string(Request *req, const char *query)
 {
-    if (!query || strlen(query) == 0)
+    if (!query)
         return;
 
-    char query_copy[1024];
-    strcpy(query_copy, query);
-
-    char *token = strtok(query_copy, "&");
-    while (token && req->param_count < MAX_PARAMS)
+    // 逐段掃描，不使用 strtok（多個執行緒同時處理請求）
+    const char *p = query;
+    while (*p && req->param_count < MAX_PARAMS)
     {
-        char *equals = strchr(token, '=');
+        size_t len = strcspn(p, "&");
+        const char *equals = memchr(p, '=', len);
         if (equals)
         {
-            *equals = '\0';
-            strcpy(req->params[req->param_count], token);
-            strcpy(req->param_values[req->param_count], equals + 1);
+            size_t name_len = equals - p;
+            if (name_len >= sizeof(req->params[0]))
+                name_len = sizeof(req->params[0]) - 1;
+            memcpy(req->params[req->param_count], p, name_len);
+            req->params[req->param_count][name_len] = '\0';
+
+            size_t value_len = len - (equals + 1 - p);
+            if (value_len >= sizeof(req->param_values[0]))
+                value_len = sizeof(req->param_values[0]) - 1;
+            memcpy(req->param_values[req->param_count], equals + 1, value_len);
+            req->param_values[req->param_count][value_len] = '\0';
             req->param_count++;
         }
-        token = strtok(NULL, "&");
+        p += len;
+        if (*p == '&')
+            p++;
     }
 }
 
@@ -2,8 +2,8 @@
 #define ROUTER_H
 
 #include <stddef.h>
+#include "latency.h"
 
-#define MAX_ROUTES 100
 #define MAX_PARAMS 10
 
 // HTTP 方法
@@ -13,7 +13,9 @@ typedef enum
     HTTP_POST,
     HTTP_PUT,
     HTTP_DELETE,
-    HTTP_PATCH
+    HTTP_PATCH,
+    HTTP_HEAD,        // 沒有 HEAD 路由時使用 GET 的路由
+    HTTP_METHOD_COUNT // 方法數；parse_method 遇到不支援的方法時回傳此值
 } HttpMethod;
 
 // 請求結構
@@ -49,9 +51,15 @@ typedef struct
     HttpMethod method;
     char *pattern;
     RouteHandler handler;
+    LatencyRoute *latency; // 此路由各階段的延遲分佈
 } Route;
 
 // 路由器函數
+// pattern 以 '/' 分段：":name" 匹配一段並存為參數，"*name" 匹配其餘整個路徑（只能在最後）
+// 比對時靜態段優先於參數，參數優先於萬用字元；結尾的 '/' 不影響比對
+// router_add 沒有數量上限，伺服器執行中也可以呼叫（包括在處理函數中）
+// router_handle 在路徑只符合其他方法的路由時回應 405 並附上 Allow 標頭
+// router_init / router_cleanup 會釋放所有路由，只能在沒有請求進行時呼叫
 void router_init(void);
 void router_add(HttpMethod method, const char *pattern, RouteHandler handler);
 void router_handle(Request *req, Response *res);
@@ -0,0 +1,219 @@
+// compressbench.c - 比較各壓縮方式與等級的壓縮率與 CPU 成本
+//
+// 用法: compressbench [-j] [-m ms] [file...]
+// 未指定檔案時使用 www/（或 ../www/）下的檔案，另外加上一份合成的 JSON 回應。
+// 每個檔案、壓縮方式與等級重複壓縮至少 -m 毫秒，回報傳輸位元組數、壓縮率、
+// 吞吐量（MB/s）與每位元組的 CPU 時間。-j 輸出 JSON Lines。
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <dirent.h>
+
+#include "latency.h"
+#include "compress.h"
+
+#define MAX_FILES 256
+
+typedef struct
+{
+    char name[512];
+    char *data;
+    size_t len;
+} Sample;
+
+static struct
+{
+    int json;
+    int min_ms;
+} g_opts = {0, 200};
+
+static Sample g_samples[MAX_FILES];
+static int g_sample_count = 0;
+
+static void add_sample(const char *name, char *data, size_t len)
+{
+    if (g_sample_count >= MAX_FILES)
+    {
+        free(data);
+        return;
+    }
+    Sample *sample = &g_samples[g_sample_count++];
+    snprintf(sample->name, sizeof(sample->name), "%s", name);
+    sample->data = data;
+    sample->len = len;
+}
+
+static void load_file(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return;
+    }
+    fseek(file, 0, SEEK_END);
+    long len = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char *data = len > 0 ? malloc(len) : NULL;
+    if (data && fread(data, 1, len, file) == (size_t)len)
+        add_sample(path, data, len);
+    else
+        free(data);
+    fclose(file);
+}
+
+// 遞迴載入目錄下的一般檔案（略過 .gz / .br 壓縮檔）
+static void load_dir(const char *dir_path)
+{
+    DIR *dir = opendir(dir_path);
+    if (!dir)
+        return;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (entry->d_name[0] == '.')
+            continue;
+        size_t name_len = strlen(entry->d_name);
+        if (name_len > 3 && (strcmp(entry->d_name + name_len - 3, ".gz") == 0 ||
+                             strcmp(entry->d_name + name_len - 3, ".br") == 0))
+            continue;
+
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s", dir_path, entry->d_name);
+        struct stat st;
+        if (stat(path, &st) != 0)
+            continue;
+        if (S_ISDIR(st.st_mode))
+            load_dir(path);
+        else if (S_ISREG(st.st_mode))
+            load_file(path);
+    }
+    closedir(dir);
+}
+
+// 類似 API 列表回應的 JSON，代表動態壓縮的典型負載
+static void add_synthetic_json(void)
+{
+    size_t capacity = 32768;
+    char *data = malloc(capacity);
+    if (!data)
+        return;
+    size_t len = 0;
+    len += snprintf(data + len, capacity - len, "{\"users\":[");
+    for (int i = 0; len < capacity - 256; i++)
+    {
+        len += snprintf(data + len, capacity - len,
+                        "%s{\"id\":%d,\"name\":\"user%d\",\"email\":\"user%d@example.com\",\"active\":%s,\"score\":%d}",
+                        i ? "," : "", i, i, i, (i % 3) ? "true" : "false", (i * 7919) % 1000);
+    }
+    len += snprintf(data + len, capacity - len, "]}");
+    add_sample("synthetic:users.json", data, len);
+}
+
+static void run_sample(const Sample *sample, CompressCodec codec, int level)
+{
+    size_t out_len = sample->len;
+    uint64_t iterations = 0;
+    uint64_t start = latency_now();
+    uint64_t elapsed;
+    do
+    {
+        size_t len;
+        char *out = compress_buffer(codec, level, sample->data, sample->len, &len);
+        if (out)
+        {
+            out_len = len;
+            free(out);
+        }
+        iterations++;
+        elapsed = latency_now() - start;
+    } while (elapsed < (uint64_t)g_opts.min_ms * 1000000ULL);
+
+    double ns_per_op = (double)elapsed / iterations;
+    double ns_per_byte = ns_per_op / sample->len;
+    double mb_per_s = sample->len / ns_per_op * 1000.0;
+    double ratio = (double)out_len / sample->len;
+    const char *encoding = compress_encoding_name(codec);
+
+    if (g_opts.json)
+    {
+        printf("{\"file\":\"%s\",\"encoding\":\"%s\",\"level\":%d,\"bytes_in\":%zu,\"bytes_out\":%zu,"
+               "\"ratio\":%.4f,\"ns_per_byte\":%.3f,\"mb_per_s\":%.1f}\n",
+               sample->name, encoding, level, sample->len, out_len, ratio, ns_per_byte, mb_per_s);
+    }
+    else
+    {
+        printf("%-40s %-5s %5d %10zu %10zu %7.1f%% %9.2f %9.1f\n",
+               sample->name, encoding, level, sample->len, out_len, ratio * 100, ns_per_byte, mb_per_s);
+    }
+}
+
+static void print_usage(const char *program)
+{
+    printf("Usage: %s [-j] [-m ms] [file...]\n", program);
+    printf("  -j      Output JSON lines\n");
+    printf("  -m ms   Minimum time per measurement (default %d)\n", g_opts.min_ms);
+    printf("Without files, everything under www/ (or ../www/) is measured.\n");
+}
+
+int main(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-j") == 0)
+            g_opts.json = 1;
+        else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+            g_opts.min_ms = atoi(argv[++i]);
+        else if (argv[i][0] == '-')
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+        else
+            load_file(argv[i]);
+    }
+
+    if (g_sample_count == 0)
+    {
+        struct stat st;
+        load_dir(stat("www", &st) == 0 ? "www" : "../www");
+        add_synthetic_json();
+    }
+
+    if (!compress_available())
+    {
+        fprintf(stderr, "No compression library was compiled in (build with -DHAVE_ZLIB -lz)\n");
+        return 1;
+    }
+
+    // 各壓縮方式的最快等級與伺服器使用的兩個等級；zstd 另測 19 作為對照
+    const CompressCodec codecs[] = {COMPRESS_GZIP, COMPRESS_ZSTD};
+    const int levels[][4] = {
+        {1, COMPRESS_LEVEL_DYNAMIC, COMPRESS_LEVEL_STATIC, 0},
+        {1, COMPRESS_ZSTD_LEVEL_DYNAMIC, COMPRESS_ZSTD_LEVEL_STATIC, 19},
+    };
+
+    if (!g_opts.json)
+        printf("%-40s %-5s %5s %10s %10s %8s %9s %9s\n",
+               "file", "codec", "level", "bytes", "on-wire", "ratio", "ns/byte", "MB/s");
+
+    for (int i = 0; i < g_sample_count; i++)
+    {
+        for (size_t c = 0; c < sizeof(codecs) / sizeof(codecs[0]); c++)
+        {
+            // 只測試有編譯進來的壓縮方式
+            if (compress_negotiate(compress_encoding_name(codecs[c])) != codecs[c])
+                continue;
+
+            for (size_t l = 0; l < sizeof(levels[c]) / sizeof(levels[c][0]) && levels[c][l] > 0; l++)
+                run_sample(&g_samples[i], codecs[c], levels[c][l]);
+        }
+    }
+
+    for (int i = 0; i < g_sample_count; i++)
+        free(g_samples[i].data);
+    return 0;
+}
@@ -0,0 +1,782 @@
+// microbench.c - 熱路徑微基準測試（路由、JSON、Content-Type、查詢字串、日誌、並行未命中合併、快取頁面類型、快取替換）
+//
+// 用法: microbench [options] [filter]
+// 每個測試先暖機，再取多個樣本；每個樣本連續執行固定次數，
+// 以 rdtsc（非 x86 則退回單調時鐘）量測，回報每次操作的週期數與奈秒數。
+// -j 輸出 JSON Lines，可直接存檔後與下一次結果比對。
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_RDTSC 1
+#endif
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include "latency.h"
+#include "logger.h"
+#include "file_utils.h"
+#include "router.h"
+#include "json.h"
+#include "single_flight.h"
+#include "file_cache.h"
+#include "metrics.h"
+
+#ifdef _WIN32
+#define NULL_DEVICE "NUL"
+#else
+#define NULL_DEVICE "/dev/null"
+#endif
+
+#define MAX_SAMPLES 1000
+#define LOG_FILE "microbench.log"
+
+// 單一測試項目：setup 可為 NULL，run 執行 iterations 次被測操作
+typedef struct
+{
+    const char *name;
+    int param; // 路由數、陣列長度等（無則為 0）
+    void (*setup)(int param);
+    void (*run)(uint64_t iterations);
+    void (*teardown)(void);
+} Benchmark;
+
+static struct
+{
+    int samples;
+    int warmup_ms;
+    int sample_us; // 每個樣本的目標時長
+    int cpu;       // -1 表示不綁定
+    int json;
+    const char *filter;
+} g_opts = {31, 200, 2000, 0, 0, NULL};
+
+static FILE *g_out;             // 結果輸出（stdout 會被導向空裝置以吞掉日誌）
+static double g_cycles_per_ns = 1.0;
+static volatile uintptr_t g_sink; // 防止編譯器刪除被測結果
+
+static inline uint64_t cycles_now(void)
+{
+#ifdef HAVE_RDTSC
+    _mm_lfence();
+    return __rdtsc();
+#else
+    return latency_now();
+#endif
+}
+
+// 以單調時鐘校正 TSC 頻率
+static void calibrate_cycles(void)
+{
+#ifdef HAVE_RDTSC
+    uint64_t t0 = latency_now();
+    uint64_t c0 = cycles_now();
+    while (latency_now() - t0 < 50000000ULL)
+        ;
+    uint64_t t1 = latency_now();
+    uint64_t c1 = cycles_now();
+    g_cycles_per_ns = (double)(c1 - c0) / (double)(t1 - t0);
+#else
+    g_cycles_per_ns = 1.0;
+#endif
+}
+
+static void pin_cpu(int cpu)
+{
+    if (cpu < 0)
+        return;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0)
+        fprintf(stderr, "warning: could not pin to CPU %d\n", cpu);
+#else
+    fprintf(stderr, "warning: CPU pinning is only supported on Linux\n");
+#endif
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// ===== 路由 =====
+
+static void noop_handler(Request *req, Response *res)
+{
+    (void)req;
+    res->status_code = 200;
+}
+
+static Request g_req;
+static char g_path_first[64];
+static char g_path_last[64];
+static char g_path_param[64];
+
+// 一半靜態路由、一半帶參數路由，交錯註冊
+static void setup_routes(int count)
+{
+    char pattern[64];
+
+    router_cleanup();
+    router_init();
+    for (int i = 0; i < count; i++)
+    {
+        if (i % 2 == 0)
+            snprintf(pattern, sizeof(pattern), "/api/r%d", i);
+        else
+            snprintf(pattern, sizeof(pattern), "/api/r%d/:id", i);
+        router_add(HTTP_GET, pattern, noop_handler);
+    }
+
+    snprintf(g_path_first, sizeof(g_path_first), "/api/r0");
+    snprintf(g_path_last, sizeof(g_path_last), "/api/r%d", (count - 1) & ~1);
+    snprintf(g_path_param, sizeof(g_path_param), "/api/r%d/42", count - 1);
+    memset(&g_req, 0, sizeof(g_req));
+    g_req.method = HTTP_GET;
+}
+
+static void teardown_routes(void)
+{
+    router_cleanup();
+}
+
+static void route_once(char *path)
+{
+    Response res;
+    memset(&res, 0, sizeof(res));
+    g_req.path = path;
+    g_req.param_count = 0;
+    router_handle(&g_req, &res);
+    g_sink += res.status_code;
+    free(res.content_type);
+    free(res.body);
+}
+
+static void run_route_first(uint64_t iterations)
+{
+    for (uint64_t i = 0; i < iterations; i++)
+        route_once(g_path_first);
+}
+
+static void run_route_last(uint64_t iterations)
+{
+    for (uint64_t i = 0; i < iterations; i++)
+        route_once(g_path_last);
+}
+
+static void run_route_param(uint64_t iterations)
+{
+    for (uint64_t i = 0; i < iterations; i++)
+        route_once(g_path_param);
+}
+
+static void run_route_miss(uint64_t iterations)
+{
+    static char miss[] = "/not/found";
+    for (uint64_t i = 0; i < iterations; i++)
+        route_once(miss);
+}
+
+// ===== JSON =====
+
+static int g_array_length;
+
+static void setup_array(int length)
+{
+    g_array_length = length;
+}
+
+static void run_json_array(uint64_t iterations)
+{
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        JsonBuilder *json = json_create();
+        json_start_array(json, "users");
+        for (int n = 0; n < g_array_length; n++)
+        {
+            json_start_object(json, NULL);
+            json_add_number(json, "id", n);
+            json_add_string(json, "name", "Alice");
+            json_add_string(json, "email", "alice@example.com");
+            json_end_object(json);
+        }
+        json_end_array(json);
+        g_sink += (uintptr_t)json_get_string(json)[1];
+        json_destroy(json);
+    }
+}
+
+static void run_json_parse(uint64_t iterations)
+{
+    static const char body[] = "{\"name\": \"Charlie\", \"email\": \"charlie@example.com\", \"role\": \"admin\"}";
+    JsonPair pairs[10];
+
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        int count = json_parse_simple(body, pairs, 10);
+        g_sink += count;
+        for (int n = 0; n < count; n++)
+        {
+            free(pairs[n].key);
+            free(pairs[n].value);
+        }
+    }
+}
+
+// ===== 其他熱路徑 =====
+
+static void run_content_type(uint64_t iterations)
+{
+    static const char *paths[] = {
+        "./www/index.html", "./www/style.css", "./www/app.js",
+        "./www/images/logo.png", "./www/photo.jpg", "./www/data.bin"};
+    const int path_count = sizeof(paths) / sizeof(paths[0]);
+
+    for (uint64_t i = 0; i < iterations; i++)
+        g_sink += (uintptr_t)get_content_type(paths[i % path_count]);
+}
+
+static void run_query_string(uint64_t iterations)
+{
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        g_req.param_count = 0;
+        parse_query_string(&g_req, "page=2&limit=50&sort=name&order=asc");
+        g_sink += g_req.param_count;
+    }
+}
+
+static void setup_logger(int param)
+{
+    (void)param;
+    init_logger(LOG_FILE);
+}
+
+static void teardown_logger(void)
+{
+    close_logger();
+    remove(LOG_FILE);
+}
+
+static void run_log_message(uint64_t iterations)
+{
+    for (uint64_t i = 0; i < iterations; i++)
+        log_message(LOG_INFO, "Request: %s %s -> %d", "GET", "/api/users", 200);
+}
+
+// ===== 並行未命中（thundering herd） =====
+// 每次操作：快取項目失效後，param 個執行緒同時請求同一個檔案。
+// 「載入」是把 HERD_FILE_SIZE 位元組複製到新配置的緩衝區並計算總和，代表讀檔放進快取的成本；
+// 合併時只有一個執行緒載入，其餘等待後共用結果，不合併時每個執行緒各自載入。
+
+#define HERD_FILE_SIZE (256 * 1024)
+#define HERD_MAX_THREADS 256
+
+static struct
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t start;
+    pthread_cond_t finished;
+    pthread_t threads[HERD_MAX_THREADS];
+    int thread_count;
+    int coalesce;
+    uint64_t round; // 遞增時所有執行緒開始一輪請求
+    int done;       // 本輪完成的執行緒數
+    int stop;
+    char *source;   // 「磁碟上」的檔案內容
+    char *value;    // 「快取」中的內容，NULL 表示未命中
+    SingleFlight *group;
+} g_herd = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .start = PTHREAD_COND_INITIALIZER,
+    .finished = PTHREAD_COND_INITIALIZER,
+};
+
+static char *herd_load(void)
+{
+    char *body = malloc(HERD_FILE_SIZE);
+    if (!body)
+        return NULL;
+    memcpy(body, g_herd.source, HERD_FILE_SIZE);
+    uint64_t sum = 0;
+    for (size_t i = 0; i < HERD_FILE_SIZE; i += 64)
+        sum += (unsigned char)body[i];
+    body[0] = (char)sum;
+    return body;
+}
+
+static void herd_request(void)
+{
+    if (__atomic_load_n(&g_herd.value, __ATOMIC_ACQUIRE))
+        return;
+
+    SingleFlightCall *call = g_herd.coalesce ? single_flight_begin(g_herd.group, "/www/index.html") : NULL;
+    if (!__atomic_load_n(&g_herd.value, __ATOMIC_ACQUIRE))
+    {
+        char *body = herd_load();
+        char *expected = NULL;
+        if (body && !__atomic_compare_exchange_n(&g_herd.value, &expected, body, 0, __ATOMIC_RELEASE,
+                                                 __ATOMIC_RELAXED))
+            free(body);
+    }
+    single_flight_end(g_herd.group, call);
+}
+
+static void *herd_worker(void *arg)
+{
+    (void)arg;
+    uint64_t seen = 0;
+    pthread_mutex_lock(&g_herd.mutex);
+    for (;;)
+    {
+        while (g_herd.round == seen && !g_herd.stop)
+            pthread_cond_wait(&g_herd.start, &g_herd.mutex);
+        if (g_herd.stop)
+            break;
+        seen = g_herd.round;
+        pthread_mutex_unlock(&g_herd.mutex);
+
+        herd_request();
+
+        pthread_mutex_lock(&g_herd.mutex);
+        if (++g_herd.done == g_herd.thread_count)
+            pthread_cond_signal(&g_herd.finished);
+    }
+    pthread_mutex_unlock(&g_herd.mutex);
+    return NULL;
+}
+
+static void setup_herd(int param)
+{
+    if (!g_herd.source)
+    {
+        g_herd.source = malloc(HERD_FILE_SIZE);
+        for (size_t i = 0; g_herd.source && i < HERD_FILE_SIZE; i++)
+            g_herd.source[i] = (char)i;
+        g_herd.group = single_flight_create("microbench");
+    }
+    g_herd.stop = 0;
+    g_herd.round = 0;
+    g_herd.thread_count = 0;
+
+    // 主執行緒可能已綁定在單一 CPU 上，工作執行緒改為可在所有 CPU 上執行
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+#ifdef __linux__
+    cpu_set_t all;
+    CPU_ZERO(&all);
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        CPU_SET(cpu, &all);
+    pthread_attr_setaffinity_np(&attr, sizeof(all), &all);
+#endif
+    int threads = param < HERD_MAX_THREADS ? param : HERD_MAX_THREADS;
+    while (g_herd.thread_count < threads &&
+           pthread_create(&g_herd.threads[g_herd.thread_count], &attr, herd_worker, NULL) == 0)
+        g_herd.thread_count++;
+    pthread_attr_destroy(&attr);
+}
+
+static void setup_herd_coalesced(int param)
+{
+    g_herd.coalesce = 1;
+    setup_herd(param);
+}
+
+static void setup_herd_uncoalesced(int param)
+{
+    g_herd.coalesce = 0;
+    setup_herd(param);
+}
+
+static void run_herd(uint64_t iterations)
+{
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        pthread_mutex_lock(&g_herd.mutex);
+        free(g_herd.value); // 檔案變更，快取項目失效
+        g_herd.value = NULL;
+        g_herd.done = 0;
+        g_herd.round++;
+        pthread_cond_broadcast(&g_herd.start);
+        while (g_herd.done < g_herd.thread_count)
+            pthread_cond_wait(&g_herd.finished, &g_herd.mutex);
+        g_sink += (uintptr_t)g_herd.value;
+        pthread_mutex_unlock(&g_herd.mutex);
+    }
+}
+
+static void teardown_herd(void)
+{
+    pthread_mutex_lock(&g_herd.mutex);
+    g_herd.stop = 1;
+    pthread_cond_broadcast(&g_herd.start);
+    pthread_mutex_unlock(&g_herd.mutex);
+    for (int i = 0; i < g_herd.thread_count; i++)
+        pthread_join(g_herd.threads[i], NULL);
+    free(g_herd.value);
+    g_herd.value = NULL;
+}
+
+// ===== 記憶體快取的頁面類型 =====
+// 每次操作：隨機取一個 16KB 的快取項目，把標頭與內容複製到送出緩衝區（與 send 複製到 socket 緩衝區相同），
+// param 為快取中的資料量（MB）。工作集遠大於 TLB 涵蓋範圍時，大頁面 arena 可省去多數的頁表查詢。
+
+#define SERVE_ENTRY_SIZE (16 * 1024)
+
+static FileCache *g_serve_cache;
+static char (*g_serve_paths)[32];
+static int g_serve_count;
+static char g_serve_buffer[SERVE_ENTRY_SIZE + 512];
+
+static void setup_serve(int param, CacheArenaMode mode)
+{
+    size_t bytes = (size_t)param * 1024 * 1024;
+    g_serve_count = (int)(bytes / (SERVE_ENTRY_SIZE + 256));
+    g_serve_paths = malloc((size_t)g_serve_count * sizeof(*g_serve_paths));
+    // 容量多留一些，確保所有項目都留在快取中
+    g_serve_cache = file_cache_create("microbench", bytes + bytes / 2, SERVE_ENTRY_SIZE, mode);
+
+    static const char header[] = "Content-Type: text/html\r\nContent-Length: 16384\r\nConnection: keep-alive\r\n\r\n";
+    char *body = malloc(SERVE_ENTRY_SIZE);
+    for (int i = 0; i < SERVE_ENTRY_SIZE; i++)
+        body[i] = (char)i;
+    for (int i = 0; i < g_serve_count; i++)
+    {
+        snprintf(g_serve_paths[i], sizeof(g_serve_paths[i]), "/www/page%d.html", i);
+        FileCacheEntry *entry = file_cache_put(g_serve_cache, g_serve_paths[i],
+                                               file_cache_generation(g_serve_cache, g_serve_paths[i]),
+                                               header, sizeof(header) - 1, body, SERVE_ENTRY_SIZE, NULL);
+        file_cache_release(entry);
+    }
+    free(body);
+}
+
+static void setup_serve_huge(int param)
+{
+    setup_serve(param, CACHE_ARENA_HUGE_PAGES);
+}
+
+static void setup_serve_small(int param)
+{
+    setup_serve(param, CACHE_ARENA_SMALL_PAGES);
+}
+
+static void setup_serve_malloc(int param)
+{
+    setup_serve(param, CACHE_ARENA_OFF);
+}
+
+static void run_serve(uint64_t iterations)
+{
+    static uint32_t state = 2463534242u;
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        // xorshift：存取順序隨機，硬體預取無法預測下一個項目
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        FileCacheEntry *entry = file_cache_get(g_serve_cache, g_serve_paths[state % g_serve_count]);
+        if (!entry)
+            continue;
+        memcpy(g_serve_buffer, entry->data, entry->header_len + entry->body_len);
+        g_sink += (uintptr_t)g_serve_buffer[SERVE_ENTRY_SIZE / 2];
+        file_cache_release(entry);
+    }
+}
+
+static void teardown_serve(void)
+{
+    file_cache_destroy(g_serve_cache);
+    free(g_serve_paths);
+}
+
+// ===== 記憶體快取已滿時的替換 =====
+// 每次操作：放入一個新路徑的項目，大小在 256B 到 256KB 之間呈對數分布，涵蓋大部分 slab 級距。
+// 快取一直是滿的，每次放入都要先淘汰；淘汰釋放的 arena 空位應直接給新項目使用，
+// 結束時檢查 static_cache_arena_fallbacks_total 沒有增加（改用 malloc 表示 arena 容量算錯了）。
+
+#define CHURN_SIZE_COUNT 4096
+#define CHURN_MAX_BODY (256 * 1024)
+
+static FileCache *g_churn_cache;
+static Metric *g_churn_fallbacks;
+static int64_t g_churn_fallbacks_start;
+static size_t g_churn_sizes[CHURN_SIZE_COUNT];
+static char *g_churn_body;
+static uint32_t g_churn_next;
+
+static void churn_put(void)
+{
+    static const char header[] = "Content-Type: text/html\r\nConnection: keep-alive\r\n\r\n";
+    char path[32];
+    uint32_t n = g_churn_next++;
+    snprintf(path, sizeof(path), "/www/churn%u.html", n);
+    FileCacheEntry *entry = file_cache_put(g_churn_cache, path, file_cache_generation(g_churn_cache, path),
+                                           header, sizeof(header) - 1,
+                                           g_churn_body, g_churn_sizes[n % CHURN_SIZE_COUNT], NULL);
+    g_sink += (uintptr_t)entry;
+    file_cache_release(entry);
+}
+
+// param 為快取容量（MB）
+static void setup_churn(int param)
+{
+    size_t bytes = (size_t)param * 1024 * 1024;
+    g_churn_cache = file_cache_create("microbench_churn", bytes, CHURN_MAX_BODY, CACHE_ARENA_HUGE_PAGES);
+    g_churn_fallbacks = metrics_counter("static_cache_arena_fallbacks_total",
+                                        "Cache entries allocated with malloc because the arena had no room",
+                                        "cache=\"microbench_churn\"");
+    g_churn_fallbacks_start = metrics_value(g_churn_fallbacks);
+
+    uint32_t state = 2463534242u;
+    for (int i = 0; i < CHURN_SIZE_COUNT; i++)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        // 256B << (0..10)，再乘上 1 到 2 之間的隨機倍數
+        size_t size = (size_t)256 << (state % 11);
+        size += size * ((state >> 8) & 0xff) / 256;
+        g_churn_sizes[i] = size < CHURN_MAX_BODY ? size : CHURN_MAX_BODY;
+    }
+    g_churn_body = calloc(1, CHURN_MAX_BODY);
+    g_churn_next = 0;
+
+    // 放入兩倍容量的資料，讓快取在量測前就已經滿了
+    for (size_t filled = 0; filled < bytes * 2; filled += g_churn_sizes[g_churn_next % CHURN_SIZE_COUNT])
+        churn_put();
+}
+
+static void run_churn(uint64_t iterations)
+{
+    for (uint64_t i = 0; i < iterations; i++)
+        churn_put();
+}
+
+static void teardown_churn(void)
+{
+    int64_t fallbacks = metrics_value(g_churn_fallbacks) - g_churn_fallbacks_start;
+    if (fallbacks > 0)
+        fprintf(stderr, "warning: file_cache_churn: %lld entries fell back to malloc\n", (long long)fallbacks);
+    file_cache_destroy(g_churn_cache);
+    free(g_churn_body);
+}
+
+static const Benchmark g_benchmarks[] = {
+    {"router_handle/first", 10, setup_routes, run_route_first, teardown_routes},
+    {"router_handle/last", 10, setup_routes, run_route_last, teardown_routes},
+    {"router_handle/param", 10, setup_routes, run_route_param, teardown_routes},
+    {"router_handle/miss", 10, setup_routes, run_route_miss, teardown_routes},
+    {"router_handle/first", 100, setup_routes, run_route_first, teardown_routes},
+    {"router_handle/last", 100, setup_routes, run_route_last, teardown_routes},
+    {"router_handle/param", 100, setup_routes, run_route_param, teardown_routes},
+    {"router_handle/miss", 100, setup_routes, run_route_miss, teardown_routes},
+    {"router_handle/first", 1000, setup_routes, run_route_first, teardown_routes},
+    {"router_handle/last", 1000, setup_routes, run_route_last, teardown_routes},
+    {"router_handle/param", 1000, setup_routes, run_route_param, teardown_routes},
+    {"router_handle/miss", 1000, setup_routes, run_route_miss, teardown_routes},
+    {"json_builder/array", 10, setup_array, run_json_array, NULL},
+    {"json_builder/array", 100, setup_array, run_json_array, NULL},
+    {"json_builder/array", 1000, setup_array, run_json_array, NULL},
+    {"json_parse_simple", 0, NULL, run_json_parse, NULL},
+    {"get_content_type", 0, NULL, run_content_type, NULL},
+    {"parse_query_string", 0, NULL, run_query_string, NULL},
+    {"log_message", 0, setup_logger, run_log_message, teardown_logger},
+    {"herd/coalesced", 16, setup_herd_coalesced, run_herd, teardown_herd},
+    {"herd/uncoalesced", 16, setup_herd_uncoalesced, run_herd, teardown_herd},
+    {"herd/coalesced", 64, setup_herd_coalesced, run_herd, teardown_herd},
+    {"herd/uncoalesced", 64, setup_herd_uncoalesced, run_herd, teardown_herd},
+    {"herd/coalesced", 256, setup_herd_coalesced, run_herd, teardown_herd},
+    {"herd/uncoalesced", 256, setup_herd_uncoalesced, run_herd, teardown_herd},
+    {"file_cache_serve/huge", 64, setup_serve_huge, run_serve, teardown_serve},
+    {"file_cache_serve/small", 64, setup_serve_small, run_serve, teardown_serve},
+    {"file_cache_serve/malloc", 64, setup_serve_malloc, run_serve, teardown_serve},
+    {"file_cache_serve/huge", 1024, setup_serve_huge, run_serve, teardown_serve},
+    {"file_cache_serve/small", 1024, setup_serve_small, run_serve, teardown_serve},
+    {"file_cache_serve/malloc", 1024, setup_serve_malloc, run_serve, teardown_serve},
+    {"file_cache_churn", 256, setup_churn, run_churn, teardown_churn},
+    {"file_cache_churn", 64, setup_churn, run_churn, teardown_churn},
+};
+
+static void run_benchmark(const Benchmark *bench)
+{
+    char label[128];
+    if (bench->param)
+        snprintf(label, sizeof(label), "%s/%d", bench->name, bench->param);
+    else
+        snprintf(label, sizeof(label), "%s", bench->name);
+
+    if (g_opts.filter && !strstr(label, g_opts.filter))
+        return;
+
+    if (bench->setup)
+        bench->setup(bench->param);
+
+    // 暖機，同時估算每個樣本需要的迭代次數
+    uint64_t iterations = 1;
+    uint64_t warmup_end = latency_now() + (uint64_t)g_opts.warmup_ms * 1000000ULL;
+    uint64_t per_op_ns = 0;
+    do
+    {
+        uint64_t t0 = latency_now();
+        bench->run(iterations);
+        uint64_t elapsed = latency_now() - t0;
+        per_op_ns = elapsed / iterations;
+        if (elapsed < (uint64_t)g_opts.sample_us * 1000ULL / 2)
+            iterations *= 2;
+    } while (latency_now() < warmup_end);
+
+    if (per_op_ns == 0)
+        per_op_ns = 1;
+    iterations = (uint64_t)g_opts.sample_us * 1000ULL / per_op_ns;
+    if (iterations == 0)
+        iterations = 1;
+
+    uint64_t samples[MAX_SAMPLES];
+    for (int s = 0; s < g_opts.samples; s++)
+    {
+        uint64_t c0 = cycles_now();
+        bench->run(iterations);
+        uint64_t c1 = cycles_now();
+        // 以千分之一週期為單位，保留單次操作低於一個週期時的精度
+        samples[s] = (c1 - c0) * 1000ULL / iterations;
+    }
+
+    if (bench->teardown)
+        bench->teardown();
+
+    qsort(samples, g_opts.samples, sizeof(uint64_t), compare_u64);
+    double min = samples[0] / 1000.0;
+    double median = samples[g_opts.samples / 2] / 1000.0;
+    double p90 = samples[(g_opts.samples * 9) / 10] / 1000.0;
+    double max = samples[g_opts.samples - 1] / 1000.0;
+
+    if (g_opts.json)
+    {
+        fprintf(g_out,
+                "{\"name\":\"%s\",\"iterations\":%llu,\"samples\":%d,"
+                "\"cycles_min\":%.1f,\"cycles_median\":%.1f,\"cycles_p90\":%.1f,\"cycles_max\":%.1f,"
+                "\"ns_median\":%.1f}\n",
+                label, (unsigned long long)iterations, g_opts.samples,
+                min, median, p90, max, median / g_cycles_per_ns);
+    }
+    else
+    {
+        fprintf(g_out, "%-32s %12.1f %12.1f %12.1f %12.1f %10.1f\n",
+                label, min, median, p90, max, median / g_cycles_per_ns);
+    }
+    fflush(g_out);
+}
+
+static void usage(void)
+{
+    printf("Usage: microbench [options] [filter]\n");
+    printf("  -s N     samples per benchmark (default 31, max %d)\n", MAX_SAMPLES);
+    printf("  -w MS    warmup time per benchmark in milliseconds (default 200)\n");
+    printf("  -t US    target duration of one sample in microseconds (default 2000)\n");
+    printf("  -C CPU   pin to CPU (default 0, -1 disables pinning)\n");
+    printf("  -j       print one JSON object per benchmark\n");
+    printf("  -l       list benchmarks and exit\n");
+    printf("  filter   only run benchmarks whose name contains this string\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int list = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:w:t:C:jlh")) != -1)
+    {
+        switch (opt)
+        {
+        case 's':
+            g_opts.samples = atoi(optarg);
+            break;
+        case 'w':
+            g_opts.warmup_ms = atoi(optarg);
+            break;
+        case 't':
+            g_opts.sample_us = atoi(optarg);
+            break;
+        case 'C':
+            g_opts.cpu = atoi(optarg);
+            break;
+        case 'j':
+            g_opts.json = 1;
+            break;
+        case 'l':
+            list = 1;
+            break;
+        default:
+            usage();
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind < argc)
+        g_opts.filter = argv[optind];
+    if (g_opts.samples < 1 || g_opts.samples > MAX_SAMPLES || g_opts.sample_us < 1 || g_opts.warmup_ms < 0)
+    {
+        usage();
+        return 1;
+    }
+
+    const int bench_count = sizeof(g_benchmarks) / sizeof(g_benchmarks[0]);
+    if (list)
+    {
+        for (int i = 0; i < bench_count; i++)
+        {
+            if (g_benchmarks[i].param)
+                printf("%s/%d\n", g_benchmarks[i].name, g_benchmarks[i].param);
+            else
+                printf("%s\n", g_benchmarks[i].name);
+        }
+        return 0;
+    }
+
+    // 被測函數會把日誌寫到 stdout，結果改寫到複製出來的檔案描述符
+    fflush(stdout);
+    g_out = fdopen(dup(fileno(stdout)), "w");
+    if (!g_out || !freopen(NULL_DEVICE, "w", stdout))
+    {
+        fprintf(stderr, "failed to redirect stdout\n");
+        return 1;
+    }
+
+    pin_cpu(g_opts.cpu);
+    calibrate_cycles();
+
+    if (g_opts.json)
+    {
+        fprintf(g_out, "{\"meta\":{\"cycles_per_ns\":%.4f,\"rdtsc\":%s,\"cpu\":%d,\"samples\":%d}}\n",
+                g_cycles_per_ns,
+#ifdef HAVE_RDTSC
+                "true",
+#else
+                "false",
+#endif
+                g_opts.cpu, g_opts.samples);
+    }
+    else
+    {
+        fprintf(g_out, "cycles/ns: %.4f, samples: %d, cpu: %d\n", g_cycles_per_ns, g_opts.samples, g_opts.cpu);
+        fprintf(g_out, "%-32s %12s %12s %12s %12s %10s\n",
+                "benchmark", "min(cyc)", "median(cyc)", "p90(cyc)", "max(cyc)", "median(ns)");
+    }
+
+    for (int i = 0; i < bench_count; i++)
+        run_benchmark(&g_benchmarks[i]);
+
+    fclose(g_out);
+    return 0;
+}
@@ -0,0 +1,918 @@
+// webbench.c - HTTP 壓力測試工具（單執行緒 epoll 用戶端）
+//
+// 用法: webbench [options] http://host:port/path [path ...]
+// 開放迴圈模式 (-R) 下，延遲從「預定送出時間」起算，
+// 伺服器變慢時排隊等待的時間也會被計入，避免 coordinated omission。
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "latency.h"
+
+#ifndef __linux__
+
+int main(void)
+{
+    fprintf(stderr, "webbench requires Linux (epoll)\n");
+    return 1;
+}
+
+#else
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define MAX_CONNECTIONS 10000
+#define MAX_DEPTH 64
+#define MAX_MIX 64
+#define READ_BUFFER_SIZE 65536
+#define HEADER_LIMIT 16384
+
+// 請求組合中的一種請求
+typedef struct
+{
+    char method[16];
+    char path[1024];
+    unsigned weight;
+    char *request; // 預先組好的請求文字
+    size_t request_len;
+} MixEntry;
+
+// 已送出（或待重送）的請求
+typedef struct
+{
+    uint64_t intended; // 預定送出時間
+    uint64_t sent;     // 實際送出時間
+    int mix;
+} InflightRequest;
+
+typedef enum
+{
+    CONN_CLOSED,
+    CONN_CONNECTING,
+    CONN_OPEN
+} ConnState;
+
+typedef enum
+{
+    RESP_HEADERS,
+    RESP_BODY_LENGTH,
+    RESP_CHUNK_SIZE,
+    RESP_CHUNK_DATA,
+    RESP_CHUNK_DATA_END,
+    RESP_CHUNK_TRAILER,
+    RESP_BODY_EOF
+} ResponseState;
+
+typedef struct
+{
+    int fd;
+    ConnState state;
+
+    InflightRequest inflight[MAX_DEPTH];
+    int inflight_head;
+    int inflight_count;
+
+    // 連線被關閉時尚未收到回應的請求，重新連線後優先送出
+    InflightRequest retry[MAX_DEPTH];
+    int retry_count;
+
+    uint64_t next_intended; // 開放迴圈：下一個請求的預定時間
+
+    char *wbuf;
+    size_t wlen;
+    size_t woff;
+    size_t wcap;
+
+    ResponseState rstate;
+    char header[HEADER_LIMIT];
+    size_t header_len;
+    uint64_t body_remaining;
+    int status;
+    int close_after;
+    int response_started;
+    uint64_t last_activity;
+} Connection;
+
+typedef struct
+{
+    char host[256];
+    char port[16];
+    int connections;
+    int duration;
+    int keep_alive;
+    int depth;
+    double rate;
+    int timeout_ms;
+    int json;
+} Options;
+
+typedef struct
+{
+    uint64_t completed;
+    uint64_t bytes;
+    uint64_t status[6];
+    uint64_t connect_errors;
+    uint64_t read_errors;
+    uint64_t timeouts;
+    uint64_t reconnects;
+} Stats;
+
+static Options g_opts;
+static MixEntry g_mix[MAX_MIX];
+static int g_mix_count = 0;
+static unsigned g_mix_total_weight = 0;
+static Connection *g_conns = NULL;
+static int g_epoll = -1;
+static struct addrinfo *g_addr = NULL;
+static Stats g_stats;
+static HdrHistogram *g_latency = NULL; // 由預定時間起算
+static HdrHistogram *g_service = NULL; // 由實際送出時間起算
+static uint64_t g_interval = 0;        // 每個連線的請求間隔（開放迴圈）
+static int g_running = 1;
+static uint64_t g_rng = 0x9E3779B97F4A7C15ULL;
+
+static void usage(void)
+{
+    printf("Usage: webbench [options] http://host:port/path [path ...]\n");
+    printf("  -c N     concurrent connections (default 16)\n");
+    printf("  -d S     test duration in seconds (default 10)\n");
+    printf("  -k       use keep-alive connections\n");
+    printf("  -p N     pipelining depth per connection, implies -k (default 1)\n");
+    printf("  -R N     target request rate (req/s), open loop with corrected latency\n");
+    printf("  -m FILE  request mix file, one \"weight [METHOD] path\" per line\n");
+    printf("  -T MS    response timeout in milliseconds (default 5000)\n");
+    printf("  -j       print a JSON summary line\n");
+}
+
+static uint64_t next_random(void)
+{
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return g_rng;
+}
+
+static int add_mix(const char *method, const char *path, unsigned weight)
+{
+    if (g_mix_count >= MAX_MIX || weight == 0)
+        return -1;
+
+    MixEntry *entry = &g_mix[g_mix_count];
+    snprintf(entry->method, sizeof(entry->method), "%s", method);
+    snprintf(entry->path, sizeof(entry->path), "%s", path);
+    entry->weight = weight;
+    g_mix_count++;
+    g_mix_total_weight += weight;
+    return 0;
+}
+
+static int load_mix(const char *filename)
+{
+    FILE *file = fopen(filename, "r");
+    if (!file)
+    {
+        fprintf(stderr, "Cannot open mix file: %s\n", filename);
+        return -1;
+    }
+
+    char line[1200];
+    while (fgets(line, sizeof(line), file))
+    {
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r')
+            continue;
+
+        unsigned weight;
+        char a[1024], b[1024];
+        int n = sscanf(line, "%u %1023s %1023s", &weight, a, b);
+        if (n == 3)
+            add_mix(a, b, weight);
+        else if (n == 2)
+            add_mix("GET", a, weight);
+    }
+
+    fclose(file);
+    return g_mix_count > 0 ? 0 : -1;
+}
+
+static void build_requests(void)
+{
+    for (int i = 0; i < g_mix_count; i++)
+    {
+        char buffer[2048];
+        int len = snprintf(buffer, sizeof(buffer),
+                           "%s %s HTTP/1.1\r\n"
+                           "Host: %s:%s\r\n"
+                           "User-Agent: webbench\r\n"
+                           "Accept: */*\r\n"
+                           "Connection: %s\r\n"
+                           "\r\n",
+                           g_mix[i].method, g_mix[i].path, g_opts.host, g_opts.port,
+                           g_opts.keep_alive ? "keep-alive" : "close");
+        g_mix[i].request = strdup(buffer);
+        g_mix[i].request_len = len;
+    }
+}
+
+static int pick_mix(void)
+{
+    if (g_mix_count == 1)
+        return 0;
+
+    unsigned r = (unsigned)(next_random() % g_mix_total_weight);
+    for (int i = 0; i < g_mix_count; i++)
+    {
+        if (r < g_mix[i].weight)
+            return i;
+        r -= g_mix[i].weight;
+    }
+    return g_mix_count - 1;
+}
+
+static int parse_url(const char *url)
+{
+    const char *p = url;
+    if (strncmp(p, "http://", 7) == 0)
+        p += 7;
+
+    const char *path = strchr(p, '/');
+    size_t hostport_len = path ? (size_t)(path - p) : strlen(p);
+    char hostport[sizeof(g_opts.host)];
+    if (hostport_len == 0 || hostport_len >= sizeof(hostport))
+        return -1;
+    memcpy(hostport, p, hostport_len);
+    hostport[hostport_len] = '\0';
+
+    char *colon = strrchr(hostport, ':');
+    if (colon)
+    {
+        *colon = '\0';
+        snprintf(g_opts.port, sizeof(g_opts.port), "%s", colon + 1);
+    }
+    else
+    {
+        snprintf(g_opts.port, sizeof(g_opts.port), "80");
+    }
+    snprintf(g_opts.host, sizeof(g_opts.host), "%s", hostport);
+
+    if (g_mix_count == 0)
+        add_mix("GET", path ? path : "/", 1);
+    return 0;
+}
+
+static void conn_append(Connection *conn, const char *data, size_t len)
+{
+    if (conn->wlen + len > conn->wcap)
+    {
+        size_t cap = conn->wcap ? conn->wcap : 4096;
+        while (conn->wlen + len > cap)
+            cap *= 2;
+        conn->wbuf = realloc(conn->wbuf, cap);
+        conn->wcap = cap;
+    }
+    memcpy(conn->wbuf + conn->wlen, data, len);
+    conn->wlen += len;
+}
+
+static void conn_reset_response(Connection *conn)
+{
+    conn->rstate = RESP_HEADERS;
+    conn->header_len = 0;
+    conn->body_remaining = 0;
+    conn->close_after = !g_opts.keep_alive;
+    conn->response_started = 0;
+}
+
+static void conn_update_events(Connection *conn)
+{
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    if (conn->state == CONN_CONNECTING || conn->woff < conn->wlen)
+        ev.events |= EPOLLOUT;
+    ev.data.ptr = conn;
+    epoll_ctl(g_epoll, EPOLL_CTL_MOD, conn->fd, &ev);
+}
+
+static int conn_open(Connection *conn)
+{
+    int fd = socket(g_addr->ai_family, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (fd < 0)
+    {
+        g_stats.connect_errors++;
+        return -1;
+    }
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    if (connect(fd, g_addr->ai_addr, g_addr->ai_addrlen) < 0 && errno != EINPROGRESS)
+    {
+        close(fd);
+        g_stats.connect_errors++;
+        return -1;
+    }
+
+    conn->fd = fd;
+    conn->state = CONN_CONNECTING;
+    conn->wlen = conn->woff = 0;
+    conn->last_activity = latency_now();
+    conn_reset_response(conn);
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLOUT;
+    ev.data.ptr = conn;
+    epoll_ctl(g_epoll, EPOLL_CTL_ADD, fd, &ev);
+    return 0;
+}
+
+// 關閉連線；尚未收到回應的請求移到重送佇列
+static void conn_close(Connection *conn, int drop_head)
+{
+    if (conn->state == CONN_CLOSED)
+        return;
+
+    epoll_ctl(g_epoll, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    conn->fd = -1;
+    conn->state = CONN_CLOSED;
+
+    int start = drop_head ? 1 : 0;
+    for (int i = start; i < conn->inflight_count && conn->retry_count < MAX_DEPTH; i++)
+    {
+        conn->retry[conn->retry_count++] = conn->inflight[(conn->inflight_head + i) % MAX_DEPTH];
+    }
+    conn->inflight_head = 0;
+    conn->inflight_count = 0;
+}
+
+// 依模式送出可以送出的請求
+static void conn_fill(Connection *conn, uint64_t now)
+{
+    if (conn->state != CONN_OPEN)
+        return;
+
+    int depth = g_opts.keep_alive ? g_opts.depth : 1;
+
+    while (conn->inflight_count < depth && g_running)
+    {
+        InflightRequest req;
+
+        if (conn->retry_count > 0)
+        {
+            req = conn->retry[0];
+            memmove(conn->retry, conn->retry + 1, (conn->retry_count - 1) * sizeof(InflightRequest));
+            conn->retry_count--;
+        }
+        else if (g_interval)
+        {
+            if (conn->next_intended > now)
+                break;
+            req.intended = conn->next_intended;
+            req.mix = pick_mix();
+            conn->next_intended += g_interval;
+        }
+        else
+        {
+            req.intended = now;
+            req.mix = pick_mix();
+        }
+
+        req.sent = now;
+        if (conn->inflight_count == 0)
+            conn->last_activity = now;
+        conn->inflight[(conn->inflight_head + conn->inflight_count) % MAX_DEPTH] = req;
+        conn->inflight_count++;
+        conn_append(conn, g_mix[req.mix].request, g_mix[req.mix].request_len);
+
+        if (!g_opts.keep_alive)
+            break;
+    }
+}
+
+static void conn_flush(Connection *conn)
+{
+    while (conn->woff < conn->wlen)
+    {
+        ssize_t n = send(conn->fd, conn->wbuf + conn->woff, conn->wlen - conn->woff, MSG_NOSIGNAL);
+        if (n < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            g_stats.read_errors++;
+            conn_close(conn, 0);
+            return;
+        }
+        conn->woff += n;
+    }
+
+    if (conn->woff == conn->wlen)
+        conn->woff = conn->wlen = 0;
+    conn_update_events(conn);
+}
+
+static void complete_response(Connection *conn, int status)
+{
+    uint64_t now = latency_now();
+    InflightRequest *req = &conn->inflight[conn->inflight_head];
+
+    hdr_record(g_latency, now - req->intended);
+    hdr_record(g_service, now - req->sent);
+
+    g_stats.completed++;
+    int cls = status / 100;
+    g_stats.status[(cls >= 1 && cls <= 5) ? cls : 0]++;
+
+    conn->inflight_head = (conn->inflight_head + 1) % MAX_DEPTH;
+    conn->inflight_count--;
+}
+
+static int parse_headers(Connection *conn)
+{
+    conn->header[conn->header_len] = '\0';
+    if (sscanf(conn->header, "HTTP/%*s %d", &conn->status) != 1)
+        return -1;
+
+    int has_length = 0;
+    int chunked = 0;
+    conn->close_after = !g_opts.keep_alive;
+
+    char *line = strstr(conn->header, "\r\n");
+    while (line && line[2] != '\r')
+    {
+        line += 2;
+        if (strncasecmp(line, "Content-Length:", 15) == 0)
+        {
+            conn->body_remaining = strtoull(line + 15, NULL, 10);
+            has_length = 1;
+        }
+        else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0 && strstr(line, "chunked"))
+        {
+            chunked = 1;
+        }
+        else if (strncasecmp(line, "Connection:", 11) == 0 && strncasecmp(line + 12, "close", 5) == 0)
+        {
+            conn->close_after = 1;
+        }
+        line = strstr(line, "\r\n");
+    }
+
+    InflightRequest *req = &conn->inflight[conn->inflight_head];
+    int bodyless = strcmp(g_mix[req->mix].method, "HEAD") == 0 ||
+                   conn->status == 204 || conn->status == 304 || conn->status / 100 == 1;
+
+    if (bodyless)
+        conn->body_remaining = 0, conn->rstate = RESP_BODY_LENGTH;
+    else if (chunked)
+        conn->rstate = RESP_CHUNK_SIZE;
+    else if (has_length)
+        conn->rstate = RESP_BODY_LENGTH;
+    else
+        conn->rstate = RESP_BODY_EOF, conn->close_after = 1;
+    return 0;
+}
+
+// 解析收到的資料；回傳 -1 表示協定錯誤
+static int conn_consume(Connection *conn, const char *data, size_t len)
+{
+    size_t pos = 0;
+
+    while (pos < len)
+    {
+        if (conn->inflight_count == 0)
+            return -1; // 收到多餘的資料
+
+        conn->response_started = 1;
+
+        switch (conn->rstate)
+        {
+        case RESP_HEADERS:
+        {
+            while (pos < len && conn->header_len < HEADER_LIMIT - 1)
+            {
+                conn->header[conn->header_len++] = data[pos++];
+                if (conn->header_len >= 4 &&
+                    memcmp(conn->header + conn->header_len - 4, "\r\n\r\n", 4) == 0)
+                {
+                    if (parse_headers(conn) < 0)
+                        return -1;
+                    break;
+                }
+            }
+            if (conn->header_len >= HEADER_LIMIT - 1)
+                return -1;
+            if (conn->rstate == RESP_BODY_LENGTH && conn->body_remaining == 0)
+            {
+                // 沒有主體的回應（HEAD、304、Content-Length: 0）
+                complete_response(conn, conn->status);
+                int close_after = conn->close_after;
+                conn_reset_response(conn);
+                if (close_after)
+                    return 1;
+            }
+            break;
+        }
+        case RESP_BODY_LENGTH:
+        {
+            size_t take = len - pos;
+            if (take > conn->body_remaining)
+                take = conn->body_remaining;
+            pos += take;
+            conn->body_remaining -= take;
+            if (conn->body_remaining == 0)
+            {
+                complete_response(conn, conn->status);
+                int close_after = conn->close_after;
+                conn_reset_response(conn);
+                if (close_after)
+                    return 1;
+            }
+            break;
+        }
+        case RESP_CHUNK_SIZE:
+        case RESP_CHUNK_TRAILER:
+        {
+            // 以 header 緩衝區暫存一行
+            while (pos < len && conn->header_len < HEADER_LIMIT - 1)
+            {
+                conn->header[conn->header_len++] = data[pos++];
+                if (conn->header_len >= 2 && conn->header[conn->header_len - 2] == '\r' &&
+                    conn->header[conn->header_len - 1] == '\n')
+                    break;
+            }
+            if (conn->header_len < 2 || conn->header[conn->header_len - 1] != '\n')
+                break;
+
+            if (conn->rstate == RESP_CHUNK_SIZE)
+            {
+                conn->header[conn->header_len] = '\0';
+                conn->body_remaining = strtoull(conn->header, NULL, 16);
+                conn->rstate = conn->body_remaining ? RESP_CHUNK_DATA : RESP_CHUNK_TRAILER;
+            }
+            else if (conn->header_len == 2)
+            {
+                // 空行：chunked 主體結束
+                complete_response(conn, conn->status);
+                int close_after = conn->close_after;
+                conn_reset_response(conn);
+                if (close_after)
+                    return 1;
+                continue;
+            }
+            conn->header_len = 0;
+            break;
+        }
+        case RESP_CHUNK_DATA:
+        {
+            size_t take = len - pos;
+            if (take > conn->body_remaining)
+                take = conn->body_remaining;
+            pos += take;
+            conn->body_remaining -= take;
+            if (conn->body_remaining == 0)
+            {
+                conn->rstate = RESP_CHUNK_DATA_END;
+                conn->body_remaining = 2;
+            }
+            break;
+        }
+        case RESP_CHUNK_DATA_END:
+        {
+            size_t take = len - pos;
+            if (take > conn->body_remaining)
+                take = conn->body_remaining;
+            pos += take;
+            conn->body_remaining -= take;
+            if (conn->body_remaining == 0)
+            {
+                conn->rstate = RESP_CHUNK_SIZE;
+                conn->header_len = 0;
+            }
+            break;
+        }
+        case RESP_BODY_EOF:
+            pos = len;
+            break;
+        }
+    }
+
+    return 0;
+}
+
+static void conn_read(Connection *conn)
+{
+    char buffer[READ_BUFFER_SIZE];
+
+    while (conn->state == CONN_OPEN)
+    {
+        ssize_t n = recv(conn->fd, buffer, sizeof(buffer), 0);
+        if (n > 0)
+        {
+            g_stats.bytes += n;
+            conn->last_activity = latency_now();
+            int result = conn_consume(conn, buffer, n);
+            if (result < 0)
+            {
+                g_stats.read_errors++;
+                conn_close(conn, conn->inflight_count > 0);
+                return;
+            }
+            if (result > 0)
+            {
+                conn_close(conn, 0);
+                return;
+            }
+            continue;
+        }
+
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+
+        // 對方關閉連線
+        if (n == 0 && conn->rstate == RESP_BODY_EOF && conn->inflight_count > 0)
+        {
+            complete_response(conn, 200);
+            conn_close(conn, 0);
+            return;
+        }
+
+        if (conn->response_started && conn->inflight_count > 0)
+        {
+            g_stats.read_errors++;
+            conn_close(conn, 1);
+        }
+        else
+        {
+            conn_close(conn, 0);
+        }
+        return;
+    }
+}
+
+static void handle_event(Connection *conn, uint32_t events)
+{
+    uint64_t now = latency_now();
+
+    if (conn->state == CONN_CONNECTING)
+    {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &err, &len);
+        if (err != 0 || (events & (EPOLLERR | EPOLLHUP)))
+        {
+            g_stats.connect_errors++;
+            conn_close(conn, 0);
+            return;
+        }
+        conn->state = CONN_OPEN;
+        conn_fill(conn, now);
+        conn_flush(conn);
+        return;
+    }
+
+    if (events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+    {
+        conn_read(conn);
+    }
+
+    if (conn->state == CONN_OPEN)
+    {
+        conn_fill(conn, now);
+        conn_flush(conn);
+    }
+
+    // 伺服器關閉連線（例如不支援 keep-alive）時立即重新連線
+    if (conn->state == CONN_CLOSED && g_running)
+    {
+        g_stats.reconnects++;
+        conn_open(conn);
+    }
+}
+
+static void print_summary(const char *label, HdrHistogram *hist)
+{
+    HdrSummary s;
+    hdr_summarize(hist, &s);
+    printf("  %-22s p50=%.1f p75=%.1f p90=%.1f p99=%.1f p99.9=%.1f p99.99=%.1f max=%.1f (us)\n",
+           label, s.p50 / 1000.0, hdr_percentile(hist, 75.0) / 1000.0, s.p90 / 1000.0,
+           s.p99 / 1000.0, s.p999 / 1000.0, hdr_percentile(hist, 99.99) / 1000.0,
+           s.max / 1000.0);
+}
+
+static void report(double elapsed)
+{
+    printf("  Requests:      %llu (%.1f req/s)\n", (unsigned long long)g_stats.completed,
+           g_stats.completed / elapsed);
+    printf("  Transfer:      %.2f MB (%.2f MB/s)\n", g_stats.bytes / 1048576.0,
+           g_stats.bytes / 1048576.0 / elapsed);
+    printf("  Status:        2xx=%llu 3xx=%llu 4xx=%llu 5xx=%llu other=%llu\n",
+           (unsigned long long)g_stats.status[2], (unsigned long long)g_stats.status[3],
+           (unsigned long long)g_stats.status[4], (unsigned long long)g_stats.status[5],
+           (unsigned long long)(g_stats.status[0] + g_stats.status[1]));
+    printf("  Errors:        connect=%llu read=%llu timeout=%llu\n",
+           (unsigned long long)g_stats.connect_errors, (unsigned long long)g_stats.read_errors,
+           (unsigned long long)g_stats.timeouts);
+    printf("  Reconnects:    %llu\n", (unsigned long long)g_stats.reconnects);
+    printf("Latency:\n");
+    if (g_interval)
+    {
+        print_summary("corrected", g_latency);
+        print_summary("service time", g_service);
+    }
+    else
+    {
+        print_summary("closed loop", g_latency);
+        printf("  (closed loop latency is not corrected for coordinated omission; use -R)\n");
+    }
+
+    if (g_opts.json)
+    {
+        HdrSummary s;
+        hdr_summarize(g_latency, &s);
+        printf("{\"connections\":%d,\"keep_alive\":%d,\"depth\":%d,\"rate\":%.1f,"
+               "\"duration\":%.3f,\"requests\":%llu,\"rps\":%.1f,\"bytes\":%llu,"
+               "\"errors\":%llu,\"corrected\":%d,\"p50_us\":%.1f,\"p90_us\":%.1f,"
+               "\"p99_us\":%.1f,\"p999_us\":%.1f,\"max_us\":%.1f}\n",
+               g_opts.connections, g_opts.keep_alive, g_opts.depth, g_opts.rate, elapsed,
+               (unsigned long long)g_stats.completed, g_stats.completed / elapsed,
+               (unsigned long long)g_stats.bytes,
+               (unsigned long long)(g_stats.connect_errors + g_stats.read_errors + g_stats.timeouts),
+               g_interval ? 1 : 0, s.p50 / 1000.0, s.p90 / 1000.0, s.p99 / 1000.0,
+               s.p999 / 1000.0, s.max / 1000.0);
+    }
+}
+
+static void signal_handler(int sig)
+{
+    (void)sig;
+    g_running = 0;
+}
+
+int main(int argc, char *argv[])
+{
+    g_opts.connections = 16;
+    g_opts.duration = 10;
+    g_opts.depth = 1;
+    g_opts.timeout_ms = 5000;
+
+    const char *url = NULL;
+    const char *mix_file = NULL;
+    const char *extra_paths[MAX_MIX];
+    int extra_count = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+            g_opts.connections = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+            g_opts.duration = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-k") == 0)
+            g_opts.keep_alive = 1;
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+            g_opts.depth = atoi(argv[++i]), g_opts.keep_alive = 1;
+        else if (strcmp(argv[i], "-R") == 0 && i + 1 < argc)
+            g_opts.rate = atof(argv[++i]);
+        else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+            mix_file = argv[++i];
+        else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc)
+            g_opts.timeout_ms = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-j") == 0)
+            g_opts.json = 1;
+        else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0)
+        {
+            usage();
+            return 0;
+        }
+        else if (!url)
+            url = argv[i];
+        else if (extra_count < MAX_MIX)
+            extra_paths[extra_count++] = argv[i];
+    }
+
+    if (!url || g_opts.connections <= 0 || g_opts.connections > MAX_CONNECTIONS ||
+        g_opts.depth <= 0 || g_opts.depth > MAX_DEPTH || g_opts.duration <= 0)
+    {
+        usage();
+        return 1;
+    }
+
+    if (mix_file && load_mix(mix_file) < 0)
+        return 1;
+    if (parse_url(url) < 0)
+    {
+        fprintf(stderr, "Invalid URL: %s\n", url);
+        return 1;
+    }
+    for (int i = 0; i < extra_count; i++)
+        add_mix("GET", extra_paths[i], 1);
+    build_requests();
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(g_opts.host, g_opts.port, &hints, &g_addr) != 0)
+    {
+        fprintf(stderr, "Cannot resolve %s\n", g_opts.host);
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, signal_handler);
+
+    g_latency = hdr_create();
+    g_service = hdr_create();
+    g_epoll = epoll_create1(0);
+    g_conns = calloc(g_opts.connections, sizeof(Connection));
+
+    if (g_opts.rate > 0)
+        g_interval = (uint64_t)(1e9 * g_opts.connections / g_opts.rate);
+
+    printf("Running %ds test @ http://%s:%s (%d request type%s)\n", g_opts.duration,
+           g_opts.host, g_opts.port, g_mix_count, g_mix_count > 1 ? "s" : "");
+    printf("  %d connections, keep-alive %s, pipeline depth %d, ", g_opts.connections,
+           g_opts.keep_alive ? "on" : "off", g_opts.keep_alive ? g_opts.depth : 1);
+    if (g_interval)
+        printf("open loop at %.0f req/s\n", g_opts.rate);
+    else
+        printf("closed loop\n");
+
+    uint64_t start = latency_now();
+    uint64_t deadline = start + (uint64_t)g_opts.duration * 1000000000ULL;
+    uint64_t timeout_ns = (uint64_t)g_opts.timeout_ms * 1000000ULL;
+
+    for (int i = 0; i < g_opts.connections; i++)
+    {
+        g_conns[i].fd = -1;
+        // 錯開各連線的起始時間，讓總送出速率平均
+        g_conns[i].next_intended = start + (g_interval * i) / g_opts.connections;
+        conn_open(&g_conns[i]);
+    }
+
+    struct epoll_event events[256];
+    while (g_running)
+    {
+        uint64_t now = latency_now();
+        if (now >= deadline)
+            break;
+
+        int n = epoll_wait(g_epoll, events, 256, 1);
+        for (int i = 0; i < n; i++)
+        {
+            handle_event((Connection *)events[i].data.ptr, events[i].events);
+        }
+
+        // 重新連線、送出到期的請求、檢查逾時
+        now = latency_now();
+        for (int i = 0; i < g_opts.connections; i++)
+        {
+            Connection *conn = &g_conns[i];
+            if (conn->state == CONN_CLOSED)
+            {
+                g_stats.reconnects++;
+                conn_open(conn);
+                continue;
+            }
+            if (conn->state == CONN_OPEN)
+            {
+                if (conn->inflight_count > 0 && now - conn->last_activity > timeout_ns)
+                {
+                    g_stats.timeouts++;
+                    conn_close(conn, 1);
+                    continue;
+                }
+                if (g_interval && conn->woff == conn->wlen)
+                {
+                    conn_fill(conn, now);
+                    if (conn->wlen)
+                        conn_flush(conn);
+                }
+            }
+        }
+    }
+
+    double elapsed = (latency_now() - start) / 1e9;
+    report(elapsed);
+
+    for (int i = 0; i < g_opts.connections; i++)
+    {
+        if (g_conns[i].state != CONN_CLOSED)
+            close(g_conns[i].fd);
+        free(g_conns[i].wbuf);
+    }
+    free(g_conns);
+    hdr_destroy(g_latency);
+    hdr_destroy(g_service);
+    freeaddrinfo(g_addr);
+    close(g_epoll);
+    return 0;
+}
+
+#endif
@@ -57,6 +57,30 @@ void create_directory(const char *path)
     }
 }
 
+// 檢查能否以 header 與 lib 編譯連結，用於偵測選用的函式庫（例如 zlib）
+int probe_library(const char *cc, const char *header, const char *lib)
+{
+    FILE *file = fopen("probe_lib.c", "w");
+    if (!file)
+        return 0;
+    fprintf(file, "#include <%s>\nint main(void) { return 0; }\n", header);
+    fclose(file);
+
+    char cmd[256];
+    sprintf(cmd, "%s probe_lib.c -o probe_lib%s %s > %s 2>&1", cc, EXE_EXT, lib,
+#ifdef _WIN32
+            "nul"
+#else
+            "/dev/null"
+#endif
+    );
+    int found = system(cmd) == 0;
+
+    remove("probe_lib.c");
+    remove("probe_lib" EXE_EXT);
+    return found;
+}
+
 // 建立範例 index.html
 void create_sample_html()
 {
@@ -96,20 +120,28 @@ int build_project(const char *mode)
     // 判斷編譯模式
     int is_framework = (mode && strcmp(mode, "framework") == 0);
     int is_clean = (mode && strcmp(mode, "clean") == 0);
+    int is_bench = (mode && strcmp(mode, "bench") == 0);
+    int is_embed = (mode && strcmp(mode, "embed") == 0);
 
 // 設定編譯器和參數
 #ifdef _WIN32
     const char *cc = "gcc";
-    const char *cflags = "-Wall -Wextra -O2 -I. -Icore -Istatic_server -Iapi_framework";
-    const char *ldflags = "-lws2_32";
+    char cflags[256] = "-Wall -Wextra -O2 -I. -Icore -Istatic_server -Iapi_framework";
+    char ldflags[128] = "-lws2_32 -lpthread";
     const char *static_target = "webserver.exe";
     const char *framework_target = "webapi.exe";
+    const char *webbench_target = "webbench.exe";
+    const char *microbench_target = "microbench.exe";
+    const char *compressbench_target = "compressbench.exe";
 #else
     const char *cc = "gcc";
-    const char *cflags = "-Wall -Wextra -O2 -I. -Icore -Istatic_server -Iapi_framework";
-    const char *ldflags = "-pthread";
+    char cflags[256] = "-Wall -Wextra -O2 -I. -Icore -Istatic_server -Iapi_framework";
+    char ldflags[128] = "-pthread";
     const char *static_target = "webserver";
     const char *framework_target = "webapi";
+    const char *webbench_target = "webbench";
+    const char *microbench_target = "microbench";
+    const char *compressbench_target = "compressbench";
 #endif
 
     // 清理模式
@@ -122,12 +154,37 @@ int build_project(const char *mode)
             "static_server" OBJ_EXT,
             "server" OBJ_EXT,
             "http_handler_static" OBJ_EXT,
+            "file_cache" OBJ_EXT,
+            "cache_arena" OBJ_EXT,
+            "fs_watch" OBJ_EXT,
+            "precompressed" OBJ_EXT,
+            "cache_policy" OBJ_EXT,
+            "open_file_cache" OBJ_EXT,
+            "autoindex" OBJ_EXT,
+            "vhost" OBJ_EXT,
+            "warmup" OBJ_EXT,
+            "http_utils" OBJ_EXT,
+            "compress" OBJ_EXT,
             "http_handler_api" OBJ_EXT,
             "file_utils" OBJ_EXT,
+            "file_stream" OBJ_EXT,
+            "disk_io" OBJ_EXT,
+            "single_flight" OBJ_EXT,
+            "mime" OBJ_EXT,
             "logger" OBJ_EXT,
+            "metrics" OBJ_EXT,
+            "admin" OBJ_EXT,
+            "latency" OBJ_EXT,
+            "trace" OBJ_EXT,
             "router" OBJ_EXT,
             "json" OBJ_EXT,
-            "example_app" OBJ_EXT};
+            "example_app" OBJ_EXT,
+            "webbench" OBJ_EXT,
+            "microbench" OBJ_EXT,
+            "compressbench" OBJ_EXT,
+            "embedded_www" OBJ_EXT,
+            "embedded_assets" OBJ_EXT,
+            "embedded_www.c"};
 
         for (int i = 0; i < sizeof(objects) / sizeof(objects[0]); i++)
         {
@@ -149,6 +206,21 @@ int build_project(const char *mode)
             remove(framework_target);
             printf("Removed %s\n", framework_target);
         }
+        if (file_exists(webbench_target))
+        {
+            remove(webbench_target);
+            printf("Removed %s\n", webbench_target);
+        }
+        if (file_exists(microbench_target))
+        {
+            remove(microbench_target);
+            printf("Removed %s\n", microbench_target);
+        }
+        if (file_exists(compressbench_target))
+        {
+            remove(compressbench_target);
+            printf("Removed %s\n", compressbench_target);
+        }
         if (file_exists("server.log"))
         {
             remove("server.log");
@@ -160,7 +232,7 @@ int build_project(const char *mode)
     }
 
     printf("Building C Web Server (%s mode) for %s...\n\n",
-           is_framework ? "framework" : "static", OS_NAME);
+           is_framework ? "framework" : (is_bench ? "bench" : (is_embed ? "embed" : "static")), OS_NAME);
 
     // 檢查編譯器
     char check_cmd[256];
@@ -178,6 +250,24 @@ int build_project(const char *mode)
         return 1;
     }
 
+    // 選用的壓縮函式庫，找不到時回應不壓縮
+    if (probe_library(cc, "zlib.h", "-lz"))
+    {
+        strcat(cflags, " -DHAVE_ZLIB");
+        strcat(ldflags, " -lz");
+        printf("Found zlib: gzip compression enabled\n");
+    }
+    else
+    {
+        printf("zlib not found: gzip compression disabled\n");
+    }
+    if (probe_library(cc, "zstd.h", "-lzstd"))
+    {
+        strcat(cflags, " -DHAVE_ZSTD");
+        strcat(ldflags, " -lzstd");
+        printf("Found libzstd: zstd compression enabled\n");
+    }
+
     char cmd[1024];
 
     if (is_framework)
@@ -187,7 +277,16 @@ int build_project(const char *mode)
             {"core" PATH_SEP "server.c", "server" OBJ_EXT},
             {"api_framework" PATH_SEP "http_handler_api.c", "http_handler_api" OBJ_EXT},
             {"core" PATH_SEP "file_utils.c", "file_utils" OBJ_EXT},
+            {"core" PATH_SEP "file_stream.c", "file_stream" OBJ_EXT},
+            {"core" PATH_SEP "disk_io.c", "disk_io" OBJ_EXT},
+            {"core" PATH_SEP "mime.c", "mime" OBJ_EXT},
             {"core" PATH_SEP "logger.c", "logger" OBJ_EXT},
+            {"core" PATH_SEP "metrics.c", "metrics" OBJ_EXT},
+            {"core" PATH_SEP "admin.c", "admin" OBJ_EXT},
+            {"core" PATH_SEP "latency.c", "latency" OBJ_EXT},
+            {"core" PATH_SEP "trace.c", "trace" OBJ_EXT},
+            {"core" PATH_SEP "http_utils.c", "http_utils" OBJ_EXT},
+            {"core" PATH_SEP "compress.c", "compress" OBJ_EXT},
             {"api_framework" PATH_SEP "router.c", "router" OBJ_EXT},
             {"api_framework" PATH_SEP "json.c", "json" OBJ_EXT},
             {"api_framework" PATH_SEP "example_app.c", "example_app" OBJ_EXT}};
@@ -255,6 +354,100 @@ int build_project(const char *mode)
         printf("\nUsage: .%s%s [port]\n", PATH_SEP, framework_target);
         printf("Default port: 8080\n");
     }
+    else if (is_bench)
+    {
+        // Bench 模式 - 編譯壓力測試工具與微基準測試
+        FileInfo files[] = {
+            {"core" PATH_SEP "latency.c", "latency" OBJ_EXT},
+            {"core" PATH_SEP "logger.c", "logger" OBJ_EXT},
+            {"core" PATH_SEP "trace.c", "trace" OBJ_EXT},
+            {"bench" PATH_SEP "webbench.c", "webbench" OBJ_EXT},
+            {"bench" PATH_SEP "microbench.c", "microbench" OBJ_EXT},
+            {"core" PATH_SEP "file_utils.c", "file_utils" OBJ_EXT},
+            {"core" PATH_SEP "file_stream.c", "file_stream" OBJ_EXT},
+            {"core" PATH_SEP "disk_io.c", "disk_io" OBJ_EXT},
+            {"core" PATH_SEP "mime.c", "mime" OBJ_EXT},
+            {"api_framework" PATH_SEP "router.c", "router" OBJ_EXT},
+            {"api_framework" PATH_SEP "json.c", "json" OBJ_EXT},
+            {"bench" PATH_SEP "compressbench.c", "compressbench" OBJ_EXT},
+            {"core" PATH_SEP "compress.c", "compress" OBJ_EXT},
+            {"core" PATH_SEP "http_utils.c", "http_utils" OBJ_EXT},
+            {"core" PATH_SEP "metrics.c", "metrics" OBJ_EXT},
+            {"core" PATH_SEP "single_flight.c", "single_flight" OBJ_EXT},
+            {"static_server" PATH_SEP "file_cache.c", "file_cache" OBJ_EXT},
+            {"static_server" PATH_SEP "cache_arena.c", "cache_arena" OBJ_EXT}};
+        int file_count = sizeof(files) / sizeof(files[0]);
+
+        // 各執行檔使用的目的檔（files[] 的索引，前三個為共用的 latency/logger/trace）
+        const char *targets[] = {webbench_target, microbench_target, compressbench_target};
+        int target_objects[][15] = {{0, 1, 2, 3, -1}, {0, 1, 2, 4, 5, 6, 7, 8, 9, 10, 14, 15, 16, 17, -1}, {0, 1, 2, 11, 12, 13, 14, -1}};
+
+        // 檢查必要檔案
+        printf("Checking required files for bench build...\n");
+        int missing = 0;
+        for (int i = 0; i < file_count; i++)
+        {
+            if (!file_exists(files[i].source))
+            {
+                printf("Missing: %s\n", files[i].source);
+                missing = 1;
+            }
+        }
+
+        if (missing)
+        {
+            printf("\nError: Required files are missing for bench build.\n");
+            return 1;
+        }
+
+        // 編譯每個源檔案
+        for (int i = 0; i < file_count; i++)
+        {
+            printf("Compiling %s...\n", files[i].source);
+            sprintf(cmd, "%s %s -c %s -o %s", cc, cflags, files[i].source, files[i].object);
+            if (run_command(cmd) != 0)
+                return 1;
+        }
+
+        // 連結
+        for (int t = 0; t < 3; t++)
+        {
+            printf("\nLinking %s...\n", targets[t]);
+            sprintf(cmd, "%s", cc);
+            for (int i = 0; i < 15 && target_objects[t][i] >= 0; i++)
+            {
+                strcat(cmd, " ");
+                strcat(cmd, files[target_objects[t][i]].object);
+            }
+            strcat(cmd, " -o ");
+            strcat(cmd, targets[t]);
+            strcat(cmd, " ");
+            strcat(cmd, ldflags);
+
+            if (run_command(cmd) != 0)
+                return 1;
+        }
+
+        // 清理中間檔案
+        printf("\nCleaning intermediate files...\n");
+        for (int i = 0; i < file_count; i++)
+        {
+            if (file_exists(files[i].object))
+            {
+                remove(files[i].object);
+                printf("Removed %s\n", files[i].object);
+            }
+        }
+
+        printf("\n========================================\n");
+        printf("Bench build successful!\n");
+        printf("Executables: %s, %s, %s\n", webbench_target, microbench_target, compressbench_target);
+        printf("========================================\n");
+        printf("\nUsage: .%s%s [-c conns] [-d secs] [-k] [-p depth] [-R rate] http://127.0.0.1:8080/\n",
+               PATH_SEP, webbench_target);
+        printf("       .%s%s [-j] [filter]\n", PATH_SEP, microbench_target);
+        printf("       .%s%s [-j] [file...]\n", PATH_SEP, compressbench_target);
+    }
     else
     {
         // Static 模式 - 編譯靜態檔案伺服器
@@ -262,8 +455,27 @@ int build_project(const char *mode)
             {"static_server" PATH_SEP "static_server.c", "static_server" OBJ_EXT},
             {"core" PATH_SEP "server.c", "server" OBJ_EXT},
             {"static_server" PATH_SEP "http_handler_static.c", "http_handler_static" OBJ_EXT},
+            {"static_server" PATH_SEP "file_cache.c", "file_cache" OBJ_EXT},
+            {"static_server" PATH_SEP "cache_arena.c", "cache_arena" OBJ_EXT},
+            {"static_server" PATH_SEP "fs_watch.c", "fs_watch" OBJ_EXT},
+            {"static_server" PATH_SEP "precompressed.c", "precompressed" OBJ_EXT},
+            {"static_server" PATH_SEP "cache_policy.c", "cache_policy" OBJ_EXT},
+            {"static_server" PATH_SEP "open_file_cache.c", "open_file_cache" OBJ_EXT},
+            {"static_server" PATH_SEP "autoindex.c", "autoindex" OBJ_EXT},
+            {"static_server" PATH_SEP "vhost.c", "vhost" OBJ_EXT},
+            {"static_server" PATH_SEP "warmup.c", "warmup" OBJ_EXT},
+            {"core" PATH_SEP "http_utils.c", "http_utils" OBJ_EXT},
+            {"core" PATH_SEP "compress.c", "compress" OBJ_EXT},
             {"core" PATH_SEP "file_utils.c", "file_utils" OBJ_EXT},
-            {"core" PATH_SEP "logger.c", "logger" OBJ_EXT}};
+            {"core" PATH_SEP "file_stream.c", "file_stream" OBJ_EXT},
+            {"core" PATH_SEP "disk_io.c", "disk_io" OBJ_EXT},
+            {"core" PATH_SEP "single_flight.c", "single_flight" OBJ_EXT},
+            {"core" PATH_SEP "mime.c", "mime" OBJ_EXT},
+            {"core" PATH_SEP "logger.c", "logger" OBJ_EXT},
+            {"core" PATH_SEP "metrics.c", "metrics" OBJ_EXT},
+            {"core" PATH_SEP "admin.c", "admin" OBJ_EXT},
+            {"core" PATH_SEP "latency.c", "latency" OBJ_EXT},
+            {"core" PATH_SEP "trace.c", "trace" OBJ_EXT}};
         int file_count = sizeof(files) / sizeof(files[0]);
 
         // 檢查必要檔案
@@ -287,6 +499,31 @@ int build_project(const char *mode)
             return 1;
         }
 
+        // 內嵌模式：先編譯 embed_gen，把 www/ 打包成 embedded_www.c 後一起編譯
+        FileInfo embed_files[] = {
+            {"embedded_www.c", "embedded_www" OBJ_EXT},
+            {"static_server" PATH_SEP "embedded_assets.c", "embedded_assets" OBJ_EXT}};
+        int embed_count = 0;
+        if (is_embed)
+        {
+            create_directory("www");
+            if (!file_exists("www" PATH_SEP "index.html"))
+                create_sample_html();
+
+            printf("Packing www into embedded_www.c...\n");
+            sprintf(cmd, "%s %s static_server" PATH_SEP "embed_gen.c core" PATH_SEP "mime.c core" PATH_SEP "compress.c"
+                         " core" PATH_SEP "http_utils.c core" PATH_SEP "metrics.c core" PATH_SEP "logger.c -o embed_gen%s %s",
+                    cc, cflags, EXE_EXT, ldflags);
+            if (run_command(cmd) != 0)
+                return 1;
+            if (run_command("." PATH_SEP "embed_gen" EXE_EXT " www embedded_www.c") != 0)
+                return 1;
+            remove("embed_gen" EXE_EXT);
+
+            strcat(cflags, " -DHAVE_EMBEDDED_ASSETS");
+            embed_count = sizeof(embed_files) / sizeof(embed_files[0]);
+        }
+
         // 編譯每個源檔案
         for (int i = 0; i < file_count; i++)
         {
@@ -295,6 +532,13 @@ int build_project(const char *mode)
             if (run_command(cmd) != 0)
                 return 1;
         }
+        for (int i = 0; i < embed_count; i++)
+        {
+            printf("Compiling %s...\n", embed_files[i].source);
+            sprintf(cmd, "%s %s -c %s -o %s", cc, cflags, embed_files[i].source, embed_files[i].object);
+            if (run_command(cmd) != 0)
+                return 1;
+        }
 
         // 連結
         printf("\nLinking...\n");
@@ -304,6 +548,11 @@ int build_project(const char *mode)
             strcat(cmd, " ");
             strcat(cmd, files[i].object);
         }
+        for (int i = 0; i < embed_count; i++)
+        {
+            strcat(cmd, " ");
+            strcat(cmd, embed_files[i].object);
+        }
         strcat(cmd, " -o ");
         strcat(cmd, static_target);
         strcat(cmd, " ");
@@ -322,6 +571,11 @@ int build_project(const char *mode)
                 printf("Removed %s\n", files[i].object);
             }
         }
+        for (int i = 0; i < embed_count; i++)
+        {
+            remove(embed_files[i].object);
+            printf("Removed %s\n", embed_files[i].object);
+        }
 
         // 建立 www 目錄
         create_directory("www");
@@ -333,7 +587,7 @@ int build_project(const char *mode)
         }
 
         printf("\n========================================\n");
-        printf("Static server build successful!\n");
+        printf("%s build successful!\n", is_embed ? "Static server (embedded www)" : "Static server");
         printf("Executable: %s\n", static_target);
         printf("========================================\n");
         printf("\nUsage: .%s%s [port]\n", PATH_SEP, static_target);
@@ -350,13 +604,16 @@ void print_usage()
     printf("Usage:\n");
     printf("  build              - Build static file server\n");
     printf("  build framework    - Build web API framework\n");
+    printf("  build embed        - Build static file server with www/ compiled into the binary\n");
+    printf("  build bench        - Build webbench load generator, microbench and compressbench\n");
     printf("  build clean        - Clean all build files\n");
     printf("  build help         - Show this help\n");
     printf("\n");
     printf("Expected folder structure:\n");
-    printf("  core/              - Core modules (server, logger, file_utils)\n");
-    printf("  static_server/     - Static server files (static_server, http_handler_static)\n");
+    printf("  core/              - Core modules (server, logger, file_utils, file_stream, disk_io, single_flight, metrics, admin, latency, trace, http_utils, compress, mime)\n");
+    printf("  static_server/     - Static server files (static_server, http_handler_static, file_cache, cache_arena, fs_watch, precompressed, cache_policy, open_file_cache, autoindex, vhost, warmup, embedded_assets, embed_gen)\n");
     printf("  api_framework/     - API framework files (example_app, http_handler_api, router, json)\n");
+    printf("  bench/             - Benchmark tools (webbench, microbench, compressbench)\n");
 }
 
 int main(int argc, char *argv[])
@@ -0,0 +1,214 @@
+// admin.c - 管理端點實現
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#define close closesocket
+#else
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+#include "admin.h"
+#include "metrics.h"
+#include "latency.h"
+#include "trace.h"
+#include "logger.h"
+
+int admin_handle(const char *path, char **body, const char **content_type)
+{
+    // 忽略查詢字串
+    size_t path_len = strcspn(path, "?");
+
+    if (path_len == strlen("/metrics") && strncmp(path, "/metrics", path_len) == 0)
+    {
+        *body = metrics_render(NULL);
+        *content_type = "text/plain; version=0.0.4; charset=utf-8";
+        return 200;
+    }
+
+    if (path_len == strlen("/admin/latency") && strncmp(path, "/admin/latency", path_len) == 0)
+    {
+        *body = latency_report_json();
+        *content_type = "application/json";
+        return 200;
+    }
+
+    return 0;
+}
+
+// 追蹤控制與匯出：只在獨立的管理埠上處理，開始與停止會改變伺服器狀態，只接受 POST
+static int admin_handle_trace(const char *method, const char *path, char **body, const char **content_type)
+{
+    size_t path_len = strcspn(path, "?");
+
+    if (path_len == strlen("/admin/trace") && strncmp(path, "/admin/trace", path_len) == 0)
+    {
+        *body = trace_export_json();
+        *content_type = "application/json";
+        return 200;
+    }
+
+    int start = path_len == strlen("/admin/trace/start") && strncmp(path, "/admin/trace/start", path_len) == 0;
+    int stop = path_len == strlen("/admin/trace/stop") && strncmp(path, "/admin/trace/stop", path_len) == 0;
+    if (!start && !stop)
+        return 0;
+    if (strcmp(method, "POST") != 0)
+        return 405;
+
+    // 開始時會清除先前的紀錄
+    trace_set_enabled(start);
+    log_info("Request tracing %s", start ? "enabled" : "disabled");
+    *body = strdup(start ? "{\"tracing\":true}" : "{\"tracing\":false}");
+    *content_type = "application/json";
+    return 200;
+}
+
+static const char *admin_status_text(int status)
+{
+    switch (status)
+    {
+    case 200:
+        return "OK";
+    case 400:
+        return "Bad Request";
+    case 404:
+        return "Not Found";
+    case 405:
+        return "Method Not Allowed";
+    default:
+        return "Internal Server Error";
+    }
+}
+
+// 處理單一管理連線（抓取頻率低，直接在監聽執行緒中處理）
+static void admin_serve(int client_socket)
+{
+    char buffer[2048];
+    int received = recv(client_socket, buffer, sizeof(buffer) - 1, 0);
+    if (received <= 0)
+        return;
+    buffer[received] = '\0';
+
+    char method[16], path[512];
+    char *body = NULL;
+    const char *content_type = "text/plain";
+    int status;
+
+    if (sscanf(buffer, "%15s %511s", method, path) != 2)
+    {
+        status = 400;
+    }
+    else
+    {
+        status = admin_handle_trace(method, path, &body, &content_type);
+        if (status == 0)
+            status = admin_handle(path, &body, &content_type);
+        if (status == 0)
+            status = 404;
+    }
+
+    if (!body)
+        body = strdup(admin_status_text(status));
+
+    char header[256];
+    int body_len = strlen(body);
+    int header_len = snprintf(header, sizeof(header),
+                              "HTTP/1.1 %d %s\r\n"
+                              "Content-Type: %s\r\n"
+                              "Content-Length: %d\r\n"
+                              "%s"
+                              "Connection: close\r\n"
+                              "\r\n",
+                              status, admin_status_text(status), content_type, body_len,
+                              status == 405 ? "Allow: POST\r\n" : "");
+
+    send(client_socket, header, header_len, 0);
+    int total_sent = 0;
+    while (total_sent < body_len)
+    {
+        int sent = send(client_socket, body + total_sent, body_len - total_sent, 0);
+        if (sent <= 0)
+            break;
+        total_sent += sent;
+    }
+
+    free(body);
+}
+
+static void *admin_listener_thread(void *arg)
+{
+    int listen_sock = *(int *)arg;
+    free(arg);
+
+    while (1)
+    {
+        struct sockaddr_in client_addr;
+        socklen_t client_len = sizeof(client_addr);
+        int client_sock = accept(listen_sock, (struct sockaddr *)&client_addr, &client_len);
+        if (client_sock < 0)
+            continue;
+
+        admin_serve(client_sock);
+        close(client_sock);
+    }
+
+    return NULL;
+}
+
+int admin_start(const char *bind_address, int port)
+{
+    // 指標與追蹤沒有驗證，預設只接受本機連線
+    if (!bind_address)
+        bind_address = "127.0.0.1";
+
+    int listen_sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_sock < 0)
+    {
+        log_error("Failed to create admin socket");
+        return -1;
+    }
+
+    int opt = 1;
+    setsockopt(listen_sock, SOL_SOCKET, SO_REUSEADDR, (char *)&opt, sizeof(opt));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, bind_address, &addr.sin_addr) != 1)
+    {
+        log_error("Invalid admin bind address: %s", bind_address);
+        close(listen_sock);
+        return -1;
+    }
+
+    if (bind(listen_sock, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(listen_sock, 16) < 0)
+    {
+        log_error("Failed to listen on admin address %s:%d", bind_address, port);
+        close(listen_sock);
+        return -1;
+    }
+
+    int *sock_ptr = malloc(sizeof(int));
+    *sock_ptr = listen_sock;
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, admin_listener_thread, sock_ptr) != 0)
+    {
+        log_error("Failed to create admin thread");
+        free(sock_ptr);
+        close(listen_sock);
+        return -1;
+    }
+    pthread_detach(thread);
+
+    log_info("Admin endpoint listening on %s:%d (/metrics, /admin/latency, /admin/trace)", bind_address, port);
+    return 0;
+}
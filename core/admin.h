@@ -0,0 +1,14 @@
+// admin.h - 管理端點（/metrics 等），可掛在既有伺服器或獨立埠上
+#ifndef ADMIN_H
+#define ADMIN_H
+
+// 處理可以掛在公開埠上的唯讀管理路徑（/metrics、/admin/latency）；若 path 不是這些端點則回傳 0
+// 否則回傳 HTTP 狀態碼，*body 由呼叫者 free，*content_type 為靜態字串
+// 追蹤控制（/admin/trace*）只在 admin_start 的獨立埠上提供
+int admin_handle(const char *path, char **body, const char **content_type);
+
+// 在獨立埠上啟動管理端點監聽執行緒，成功回傳 0
+// bind_address 為 NULL 時只監聽 127.0.0.1
+int admin_start(const char *bind_address, int port);
+
+#endif // ADMIN_H
@@ -0,0 +1,308 @@
+// compress.c - 回應壓縮實現
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "compress.h"
+#include "http_utils.h"
+#include "metrics.h"
+
+int compress_available(void)
+{
+#if defined(HAVE_ZLIB) || defined(HAVE_ZSTD)
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+int compress_is_compressible(const char *content_type)
+{
+    static const char *types[] = {
+        "text/",
+        "application/javascript",
+        "application/json",
+        "application/xml",
+        "application/wasm",
+        "image/svg+xml",
+        "image/x-icon",
+    };
+
+    if (!content_type)
+        return 0;
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+    {
+        if (strncmp(content_type, types[i], strlen(types[i])) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+CompressCodec compress_negotiate(const char *accept_encoding)
+{
+    if (!accept_encoding)
+        return COMPRESS_NONE;
+
+    int zstd = 0;
+    int gzip = 0;
+#ifdef HAVE_ZSTD
+    zstd = http_encoding_quality(accept_encoding, "zstd");
+#endif
+#ifdef HAVE_ZLIB
+    gzip = http_encoding_quality(accept_encoding, "gzip");
+#endif
+
+    if (zstd > 0 && zstd >= gzip)
+        return COMPRESS_ZSTD;
+    if (gzip > 0)
+        return COMPRESS_GZIP;
+    return COMPRESS_NONE;
+}
+
+const char *compress_encoding_name(CompressCodec codec)
+{
+    switch (codec)
+    {
+    case COMPRESS_GZIP:
+        return "gzip";
+    case COMPRESS_ZSTD:
+        return "zstd";
+    default:
+        return "identity";
+    }
+}
+
+int compress_level(CompressCodec codec, int dynamic)
+{
+    if (codec == COMPRESS_ZSTD)
+        return dynamic ? COMPRESS_ZSTD_LEVEL_DYNAMIC : COMPRESS_ZSTD_LEVEL_STATIC;
+    return dynamic ? COMPRESS_LEVEL_DYNAMIC : COMPRESS_LEVEL_STATIC;
+}
+
+#ifdef HAVE_ZLIB
+static char *compress_gzip(int level, const char *data, size_t len, size_t *out_len)
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    // windowBits 加 16 產生 gzip 格式（含標頭與 CRC）
+    if (deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return NULL;
+
+    size_t capacity = deflateBound(&stream, len);
+    char *out = malloc(capacity);
+    if (!out)
+    {
+        deflateEnd(&stream);
+        return NULL;
+    }
+
+    stream.next_in = (Bytef *)data;
+    stream.avail_in = len;
+    stream.next_out = (Bytef *)out;
+    stream.avail_out = capacity;
+
+    int result = deflate(&stream, Z_FINISH);
+    *out_len = stream.total_out;
+    deflateEnd(&stream);
+
+    if (result != Z_STREAM_END)
+    {
+        free(out);
+        return NULL;
+    }
+    return out;
+}
+#endif
+
+#ifdef HAVE_ZSTD
+static char *compress_zstd(int level, const char *data, size_t len, size_t *out_len)
+{
+    size_t capacity = ZSTD_compressBound(len);
+    char *out = malloc(capacity);
+    if (!out)
+        return NULL;
+
+    size_t result = ZSTD_compress(out, capacity, data, len, level);
+    if (ZSTD_isError(result))
+    {
+        free(out);
+        return NULL;
+    }
+    *out_len = result;
+    return out;
+}
+#endif
+
+// 記錄壓縮前後的位元組數（各壓縮方式的指標第一次使用時註冊）
+static void compress_record(CompressCodec codec, size_t in, size_t out)
+{
+    static Metric *bytes_in[3];
+    static Metric *bytes_out[3];
+
+    if (!__atomic_load_n(&bytes_in[codec], __ATOMIC_ACQUIRE))
+    {
+        char labels[64];
+        snprintf(labels, sizeof(labels), "encoding=\"%s\"", compress_encoding_name(codec));
+        __atomic_store_n(&bytes_out[codec],
+                         metrics_counter("http_compression_output_bytes_total", "Bytes produced by response compression", labels),
+                         __ATOMIC_RELEASE);
+        __atomic_store_n(&bytes_in[codec],
+                         metrics_counter("http_compression_input_bytes_total", "Bytes fed into response compression", labels),
+                         __ATOMIC_RELEASE);
+    }
+    metrics_add(__atomic_load_n(&bytes_in[codec], __ATOMIC_ACQUIRE), (int64_t)in);
+    metrics_add(__atomic_load_n(&bytes_out[codec], __ATOMIC_ACQUIRE), (int64_t)out);
+}
+
+char *compress_buffer(CompressCodec codec, int level, const char *data, size_t len, size_t *out_len)
+{
+    char *out = NULL;
+    switch (codec)
+    {
+#ifdef HAVE_ZLIB
+    case COMPRESS_GZIP:
+        out = compress_gzip(level, data, len, out_len);
+        break;
+#endif
+#ifdef HAVE_ZSTD
+    case COMPRESS_ZSTD:
+        out = compress_zstd(level, data, len, out_len);
+        break;
+#endif
+    default:
+        (void)level;
+        return NULL;
+    }
+
+    if (out && *out_len >= len)
+    {
+        free(out);
+        out = NULL;
+    }
+    if (!out)
+        return NULL;
+
+    compress_record(codec, len, *out_len);
+    return out;
+}
+
+struct CompressStream
+{
+    CompressCodec codec;
+    unsigned long long total_in;
+    unsigned long long total_out;
+#ifdef HAVE_ZLIB
+    z_stream zlib;
+#endif
+#ifdef HAVE_ZSTD
+    ZSTD_CCtx *zstd;
+#endif
+};
+
+CompressStream *compress_stream_create(CompressCodec codec, int level)
+{
+    CompressStream *stream = calloc(1, sizeof(CompressStream));
+    if (!stream)
+        return NULL;
+    stream->codec = codec;
+
+    switch (codec)
+    {
+#ifdef HAVE_ZLIB
+    case COMPRESS_GZIP:
+        if (deflateInit2(&stream->zlib, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK)
+            return stream;
+        break;
+#endif
+#ifdef HAVE_ZSTD
+    case COMPRESS_ZSTD:
+        stream->zstd = ZSTD_createCCtx();
+        if (stream->zstd)
+        {
+            ZSTD_CCtx_setParameter(stream->zstd, ZSTD_c_compressionLevel, level);
+            return stream;
+        }
+        break;
+#endif
+    default:
+        (void)level;
+        break;
+    }
+    free(stream);
+    return NULL;
+}
+
+long compress_stream_process(CompressStream *stream, const char *in, size_t in_len, size_t *consumed,
+                             char *out, size_t out_size, int finish, int *done)
+{
+    *consumed = 0;
+    *done = 0;
+    switch (stream->codec)
+    {
+#ifdef HAVE_ZLIB
+    case COMPRESS_GZIP:
+    {
+        z_stream *z = &stream->zlib;
+        z->next_in = (Bytef *)in;
+        z->avail_in = (uInt)in_len;
+        z->next_out = (Bytef *)out;
+        z->avail_out = (uInt)out_size;
+        int result = deflate(z, finish ? Z_FINISH : Z_NO_FLUSH);
+        if (result == Z_STREAM_ERROR)
+            return -1;
+        *consumed = in_len - z->avail_in;
+        *done = result == Z_STREAM_END;
+        stream->total_in += *consumed;
+        stream->total_out += out_size - z->avail_out;
+        return (long)(out_size - z->avail_out);
+    }
+#endif
+#ifdef HAVE_ZSTD
+    case COMPRESS_ZSTD:
+    {
+        ZSTD_inBuffer input = {in, in_len, 0};
+        ZSTD_outBuffer output = {out, out_size, 0};
+        size_t remaining = ZSTD_compressStream2(stream->zstd, &output, &input, finish ? ZSTD_e_end : ZSTD_e_continue);
+        if (ZSTD_isError(remaining))
+            return -1;
+        *consumed = input.pos;
+        *done = finish && remaining == 0;
+        stream->total_in += input.pos;
+        stream->total_out += output.pos;
+        return (long)output.pos;
+    }
+#endif
+    default:
+        (void)in;
+        (void)in_len;
+        (void)out;
+        (void)out_size;
+        (void)finish;
+        return -1;
+    }
+}
+
+void compress_stream_destroy(CompressStream *stream)
+{
+    if (!stream)
+        return;
+#ifdef HAVE_ZLIB
+    if (stream->codec == COMPRESS_GZIP)
+        deflateEnd(&stream->zlib);
+#endif
+#ifdef HAVE_ZSTD
+    if (stream->codec == COMPRESS_ZSTD)
+        ZSTD_freeCCtx(stream->zstd);
+#endif
+    if (stream->total_in > 0)
+        compress_record(stream->codec, stream->total_in, stream->total_out);
+    free(stream);
+}
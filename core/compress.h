@@ -0,0 +1,53 @@
+// compress.h - 回應壓縮（gzip 需 zlib，zstd 為選用），編譯時以 HAVE_ZLIB / HAVE_ZSTD 啟用
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <stddef.h>
+
+#define COMPRESS_MIN_SIZE 1024        // 小於此大小的回應不壓縮
+#define COMPRESS_LEVEL_DYNAMIC 6      // gzip：每次請求都壓縮的動態回應
+#define COMPRESS_LEVEL_STATIC 9       // gzip：靜態檔案只壓縮一次，使用最高壓縮率
+#define COMPRESS_ZSTD_LEVEL_DYNAMIC 3 // zstd 的預設等級，比 gzip 6 快且壓縮率相近
+#define COMPRESS_ZSTD_LEVEL_STATIC 9  // 冷快取未命中時請求會等待壓縮完成，不使用 19 這類很慢的等級
+
+typedef enum
+{
+    COMPRESS_NONE,
+    COMPRESS_GZIP,
+    COMPRESS_ZSTD
+} CompressCodec;
+
+// 是否編譯了任何壓縮器
+int compress_available(void);
+
+// 依 Content-Type 判斷是否值得壓縮（文字、JSON、JavaScript、SVG 等）
+int compress_is_compressible(const char *content_type);
+
+// 依 Accept-Encoding 選出可用且權重最高的壓縮方式，權重相同時優先 zstd
+CompressCodec compress_negotiate(const char *accept_encoding);
+
+// Content-Encoding 標頭的值
+const char *compress_encoding_name(CompressCodec codec);
+
+// 各壓縮方式的預設等級：dynamic 為 1 時用於每次請求都壓縮的回應，0 時用於只壓縮一次的靜態內容
+int compress_level(CompressCodec codec, int dynamic);
+
+// 壓縮 data（level 為該壓縮方式本身的等級），成功時回傳 malloc 的結果（需由呼叫者 free）並填入長度
+// 壓縮失敗或結果沒有比較小時回傳 NULL
+char *compress_buffer(CompressCodec codec, int level, const char *data, size_t len, size_t *out_len);
+
+// 串流壓縮器：輸入分段送入，輸出寫進呼叫者的緩衝區，記憶體用量與資料大小無關
+typedef struct CompressStream CompressStream;
+
+// codec 沒有編譯進來時回傳 NULL
+CompressStream *compress_stream_create(CompressCodec codec, int level);
+
+// 壓縮 in 的資料並寫入 out，回傳寫入的位元組數（錯誤時為 -1），*consumed 為用掉的輸入位元組數
+// 沒有更多輸入時以 finish = 1 重複呼叫，直到 *done 為 1（最後一次仍可能有輸出）
+long compress_stream_process(CompressStream *stream, const char *in, size_t in_len, size_t *consumed,
+                             char *out, size_t out_size, int finish, int *done);
+
+// 釋放壓縮器並計入壓縮前後的位元組數
+void compress_stream_destroy(CompressStream *stream);
+
+#endif // COMPRESS_H
@@ -0,0 +1,217 @@
+// disk_io.c - 背景 I/O 執行緒池
+//
+// 伺服器目前每個連線一個執行緒，等待磁碟時只會卡住該連線；I/O 執行緒池讓冷資料的讀取
+// 與網路處理分開：同時進行的磁碟讀取數受執行緒數限制，等待時間可以量測，
+// disk_io_submit 的完成通知也可直接用於事件迴圈。
+#ifdef __linux__
+#define _GNU_SOURCE // preadv2 / RWF_NOWAIT
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/uio.h>
+#endif
+
+#include "disk_io.h"
+#include "file_utils.h"
+#include "latency.h"
+#include "logger.h"
+#include "metrics.h"
+
+typedef struct
+{
+    int fd;
+    char *buffer;
+    long long length;
+    long long offset;
+    DiskIoCallback callback;
+    void *ctx;
+} DiskIoJob;
+
+static pthread_mutex_t g_io_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_io_not_empty = PTHREAD_COND_INITIALIZER;
+
+static struct
+{
+    DiskIoJob jobs[DISK_IO_QUEUE_SIZE];
+    int head;
+    int count;
+    int started;
+    Metric *cached_reads;
+    Metric *disk_reads;
+    Metric *inline_reads;
+    Metric *queue_depth;
+    Metric *wait_time;
+} g_io;
+
+static void *disk_io_worker(void *arg)
+{
+    (void)arg;
+    while (1)
+    {
+        pthread_mutex_lock(&g_io_mutex);
+        while (g_io.count == 0)
+            pthread_cond_wait(&g_io_not_empty, &g_io_mutex);
+        DiskIoJob job = g_io.jobs[g_io.head];
+        g_io.head = (g_io.head + 1) % DISK_IO_QUEUE_SIZE;
+        g_io.count--;
+        pthread_mutex_unlock(&g_io_mutex);
+        metrics_add(g_io.queue_depth, -1);
+
+        long long result = read_file_at(job.fd, job.buffer, job.length, job.offset);
+        job.callback(result, job.ctx);
+    }
+    return NULL;
+}
+
+int disk_io_start(int threads)
+{
+    // 以微秒記錄、以秒輸出
+    static const uint64_t bounds[] = {10, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 1000000};
+    g_io.cached_reads = metrics_counter("disk_io_reads_total", "File reads by where the data came from", "source=\"page_cache\"");
+    g_io.disk_reads = metrics_counter("disk_io_reads_total", "File reads by where the data came from", "source=\"io_thread\"");
+    g_io.inline_reads = metrics_counter("disk_io_reads_total", "File reads by where the data came from", "source=\"inline\"");
+    g_io.queue_depth = metrics_gauge("disk_io_queue_depth", "Reads waiting for an I/O thread", NULL);
+    g_io.wait_time = metrics_histogram("disk_io_wait_seconds", "Time request threads spent waiting on disk reads", NULL,
+                                       bounds, sizeof(bounds) / sizeof(bounds[0]), 1e-6);
+
+    int started = 0;
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, disk_io_worker, NULL) != 0)
+            break;
+        pthread_detach(thread);
+        started++;
+    }
+    if (threads > 0 && started == 0)
+    {
+        log_message(LOG_WARNING, "Cannot start I/O threads, reading files inline");
+        return -1;
+    }
+    __atomic_store_n(&g_io.started, started, __ATOMIC_RELEASE);
+    if (started > 0)
+        log_message(LOG_INFO, "Disk I/O threads: %d", started);
+    return 0;
+}
+
+int disk_io_submit(int fd, char *buffer, long long length, long long offset, DiskIoCallback callback, void *ctx)
+{
+    if (!__atomic_load_n(&g_io.started, __ATOMIC_ACQUIRE))
+        return -1;
+
+    pthread_mutex_lock(&g_io_mutex);
+    if (g_io.count == DISK_IO_QUEUE_SIZE)
+    {
+        pthread_mutex_unlock(&g_io_mutex);
+        return -1;
+    }
+    DiskIoJob *job = &g_io.jobs[(g_io.head + g_io.count) % DISK_IO_QUEUE_SIZE];
+    job->fd = fd;
+    job->buffer = buffer;
+    job->length = length;
+    job->offset = offset;
+    job->callback = callback;
+    job->ctx = ctx;
+    g_io.count++;
+    pthread_cond_signal(&g_io_not_empty);
+    pthread_mutex_unlock(&g_io_mutex);
+    metrics_add(g_io.queue_depth, 1);
+    return 0;
+}
+
+// 同步等待一筆非同步讀取
+typedef struct
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t done_cond;
+    int done;
+    long long result;
+} DiskIoWait;
+
+static void disk_io_wake(long long result, void *ctx)
+{
+    DiskIoWait *wait = ctx;
+    pthread_mutex_lock(&wait->mutex);
+    wait->result = result;
+    wait->done = 1;
+    pthread_cond_signal(&wait->done_cond);
+    pthread_mutex_unlock(&wait->mutex);
+}
+
+#if defined(__linux__) && defined(RWF_NOWAIT)
+// 只讀取已在 page cache 的部分，回傳讀到的位元組數；全部讀完或到達檔案結尾時 *complete 為 1
+static long long disk_io_read_cached(int fd, char *buffer, long long length, long long offset, int *complete)
+{
+    static int unsupported = 0; // 檔案系統不支援 RWF_NOWAIT
+    *complete = 0;
+    if (__atomic_load_n(&unsupported, __ATOMIC_RELAXED))
+        return 0;
+
+    long long total = 0;
+    while (total < length)
+    {
+        long long remaining = length - total;
+        struct iovec iov = {buffer + total, remaining > 0x7ffff000 ? 0x7ffff000 : (size_t)remaining};
+        ssize_t got = preadv2(fd, &iov, 1, offset + total, RWF_NOWAIT);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got < 0 && (errno == EOPNOTSUPP || errno == EINVAL || errno == ENOSYS))
+            __atomic_store_n(&unsupported, 1, __ATOMIC_RELAXED);
+        if (got < 0)
+            return total; // EAGAIN：其餘部分不在 page cache 中
+        if (got == 0)
+            break; // 檔案結尾
+        total += got;
+    }
+    *complete = 1;
+    return total;
+}
+#endif
+
+long long disk_io_read(int fd, char *buffer, long long length, long long offset)
+{
+    if (!__atomic_load_n(&g_io.started, __ATOMIC_ACQUIRE))
+        return read_file_at(fd, buffer, length, offset);
+
+    long long total = 0;
+#if defined(__linux__) && defined(RWF_NOWAIT)
+    int complete;
+    total = disk_io_read_cached(fd, buffer, length, offset, &complete);
+    if (complete)
+    {
+        metrics_inc(g_io.cached_reads);
+        return total;
+    }
+#endif
+
+    // 剩下的部分需要等待磁碟
+    DiskIoWait wait = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0};
+    uint64_t start = latency_now();
+    long long result;
+    if (disk_io_submit(fd, buffer + total, length - total, offset + total, disk_io_wake, &wait) == 0)
+    {
+        pthread_mutex_lock(&wait.mutex);
+        while (!wait.done)
+            pthread_cond_wait(&wait.done_cond, &wait.mutex);
+        pthread_mutex_unlock(&wait.mutex);
+        result = wait.result;
+        metrics_inc(g_io.disk_reads);
+    }
+    else
+    {
+        result = read_file_at(fd, buffer + total, length - total, offset + total);
+        metrics_inc(g_io.inline_reads);
+    }
+    metrics_observe(g_io.wait_time, (latency_now() - start) / 1000);
+    pthread_mutex_destroy(&wait.mutex);
+    pthread_cond_destroy(&wait.done_cond);
+
+    if (result < 0)
+        return total > 0 ? total : -1;
+    return total + result;
+}
@@ -0,0 +1,22 @@
+// disk_io.h - 檔案讀取：已在 page cache 的資料直接讀取，需要等待磁碟的部分交給背景 I/O 執行緒
+#ifndef DISK_IO_H
+#define DISK_IO_H
+
+#define DISK_IO_DEFAULT_THREADS 4
+#define DISK_IO_QUEUE_SIZE 256 // 等待中的讀取上限，佇列已滿時在呼叫者執行緒讀取
+
+// 讀取完成時在 I/O 執行緒呼叫，result 為讀到的位元組數，錯誤時為 -1
+typedef void (*DiskIoCallback)(long long result, void *ctx);
+
+// 啟動 threads 個 I/O 執行緒，成功回傳 0；threads 為 0 或未呼叫時一律在呼叫者執行緒讀取
+int disk_io_start(int threads);
+
+// 非同步讀取 fd 從 offset 起的 length 位元組（pread，fd 可共用）
+// 已排入佇列時回傳 0，完成後呼叫 callback；未啟動或佇列已滿時回傳 -1，呼叫者應自行讀取
+int disk_io_submit(int fd, char *buffer, long long length, long long offset, DiskIoCallback callback, void *ctx);
+
+// 同步介面：先以 preadv2(RWF_NOWAIT) 只從 page cache 讀取，需要等待磁碟時才交給 I/O 執行緒並等待完成
+// 等待磁碟的時間記錄在 disk_io_wait_seconds；回傳讀到的位元組數，錯誤時為 -1
+long long disk_io_read(int fd, char *buffer, long long length, long long offset);
+
+#endif // DISK_IO_H
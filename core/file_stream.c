@@ -0,0 +1,189 @@
+// file_stream.c - 檔案串流實現
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
+#include "file_stream.h"
+#include "file_utils.h"
+#include "disk_io.h"
+
+static pthread_mutex_t g_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static char *g_pool[FILE_STREAM_POOL_SIZE];
+static int g_pool_count = 0;
+
+char *file_stream_buffer_acquire(void)
+{
+    char *buffer = NULL;
+    pthread_mutex_lock(&g_pool_mutex);
+    if (g_pool_count > 0)
+        buffer = g_pool[--g_pool_count];
+    pthread_mutex_unlock(&g_pool_mutex);
+    return buffer ? buffer : malloc(FILE_STREAM_BUFFER_SIZE);
+}
+
+void file_stream_buffer_release(char *buffer)
+{
+    if (!buffer)
+        return;
+    pthread_mutex_lock(&g_pool_mutex);
+    if (g_pool_count < FILE_STREAM_POOL_SIZE)
+    {
+        g_pool[g_pool_count++] = buffer;
+        buffer = NULL;
+    }
+    pthread_mutex_unlock(&g_pool_mutex);
+    free(buffer);
+}
+
+static int stream_send_all(int socket, const char *data, size_t len)
+{
+    while (len > 0)
+    {
+        int sent = send(socket, data, len > 0x7ffff000 ? 0x7ffff000 : (int)len, 0);
+        if (sent < 0 && errno == EINTR)
+            continue;
+        if (sent <= 0)
+            return -1;
+        data += sent;
+        len -= sent;
+    }
+    return 0;
+}
+
+// 送出一段資料，chunked 時加上長度行與結尾的 CRLF；回傳送出的位元組數，失敗回傳 -1
+static long long stream_emit(int socket, const char *data, size_t len, int chunked)
+{
+    if (len == 0)
+        return 0; // 長度 0 的 chunk 代表結尾，不能在中途送出
+    if (!chunked)
+        return stream_send_all(socket, data, len) < 0 ? -1 : (long long)len;
+
+    char size_line[24];
+    int size_len = snprintf(size_line, sizeof(size_line), "%zx\r\n", len);
+#ifdef _WIN32
+    if (stream_send_all(socket, size_line, size_len) < 0 || stream_send_all(socket, data, len) < 0 ||
+        stream_send_all(socket, "\r\n", 2) < 0)
+        return -1;
+#else
+    // 三段一次送出，部分送出時剩下的逐段補送
+    struct iovec iov[3] = {{size_line, size_len}, {(void *)data, len}, {"\r\n", 2}};
+    ssize_t sent = writev(socket, iov, 3);
+    if (sent < 0)
+    {
+        if (errno != EINTR)
+            return -1;
+        sent = 0;
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        if ((size_t)sent >= iov[i].iov_len)
+        {
+            sent -= iov[i].iov_len;
+            continue;
+        }
+        if (stream_send_all(socket, (const char *)iov[i].iov_base + sent, iov[i].iov_len - sent) < 0)
+            return -1;
+        sent = 0;
+    }
+#endif
+    return size_len + (long long)len + 2;
+}
+
+// 把 in 全部交給轉換階段並送出輸出；finish 時持續呼叫直到轉換結束
+static int stream_transform(int socket, const FileStreamTransform *transform, const char *in, size_t len,
+                            int finish, char *out, int chunked, long long *total)
+{
+    int done = 0;
+    while (len > 0 || (finish && !done))
+    {
+        size_t consumed;
+        long produced = transform->process(transform->ctx, in, len, &consumed, out, FILE_STREAM_BUFFER_SIZE,
+                                           finish, &done);
+        if (produced < 0)
+            return -1;
+        long long sent = stream_emit(socket, out, (size_t)produced, chunked);
+        if (sent < 0)
+            return -1;
+        *total += sent;
+        in += consumed;
+        len -= consumed;
+    }
+    return 0;
+}
+
+long long file_stream_send(int socket, int fd, long long offset, long long length,
+                           const FileStreamTransform *transform, int chunked)
+{
+    char *in = file_stream_buffer_acquire();
+    char *out = transform ? file_stream_buffer_acquire() : NULL;
+    if (!in || (transform && !out))
+    {
+        file_stream_buffer_release(in);
+        file_stream_buffer_release(out);
+        return -1;
+    }
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, offset, length, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    long long total = 0;
+    long long position = offset;
+    long long remaining = length;
+    int failed = 0;
+    while (!failed && remaining > 0)
+    {
+        long long want = remaining > FILE_STREAM_BUFFER_SIZE ? FILE_STREAM_BUFFER_SIZE : remaining;
+        long long got = disk_io_read(fd, in, want, position);
+        if (got <= 0)
+        {
+            failed = 1; // 讀取錯誤或檔案在傳送途中被截斷
+            break;
+        }
+        position += got;
+        remaining -= got;
+#ifdef POSIX_FADV_WILLNEED
+        // 送出這一段的同時讓核心先讀入下一段
+        if (remaining > 0)
+            posix_fadvise(fd, position, remaining > FILE_STREAM_BUFFER_SIZE ? FILE_STREAM_BUFFER_SIZE : remaining,
+                          POSIX_FADV_WILLNEED);
+#endif
+
+        if (transform)
+        {
+            failed = stream_transform(socket, transform, in, (size_t)got, 0, out, chunked, &total) < 0;
+        }
+        else
+        {
+            long long sent = stream_emit(socket, in, (size_t)got, chunked);
+            failed = sent < 0;
+            if (!failed)
+                total += sent;
+        }
+    }
+
+    if (!failed && transform)
+        failed = stream_transform(socket, transform, in, 0, 1, out, chunked, &total) < 0;
+    if (!failed && chunked)
+    {
+        failed = stream_send_all(socket, "0\r\n\r\n", 5) < 0;
+        if (!failed)
+            total += 5;
+    }
+
+    file_stream_buffer_release(in);
+    file_stream_buffer_release(out);
+    if (failed && total == 0 && length > 0)
+        return -1;
+    return total;
+}
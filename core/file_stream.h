@@ -0,0 +1,32 @@
+// file_stream.h - 以固定大小的緩衝區串流送出檔案，送出前可經過轉換（例如壓縮）
+#ifndef FILE_STREAM_H
+#define FILE_STREAM_H
+
+#include <stddef.h>
+
+#define FILE_STREAM_BUFFER_SIZE (128 * 1024) // 每次 pread 的大小，也是轉換輸出的緩衝區大小
+#define FILE_STREAM_POOL_SIZE 32             // 保留重複使用的緩衝區數，超過時直接釋放
+
+// 轉換階段，介面與 compress_stream_process 相同：
+// 處理 in 並寫入 out，回傳寫入的位元組數（錯誤時為 -1），*consumed 為用掉的輸入；
+// 輸入結束後以 finish = 1 重複呼叫直到 *done 為 1
+typedef struct
+{
+    long (*process)(void *ctx, const char *in, size_t in_len, size_t *consumed,
+                    char *out, size_t out_size, int finish, int *done);
+    void *ctx;
+} FileStreamTransform;
+
+// 取得與歸還 FILE_STREAM_BUFFER_SIZE 大小的緩衝區，記憶體不足時回傳 NULL
+char *file_stream_buffer_acquire(void);
+void file_stream_buffer_release(char *buffer);
+
+// 從 fd 的 offset 讀取 length 位元組送到 socket，記憶體用量與檔案大小無關
+// 以 disk_io_read 讀取（不改變檔案位置，fd 可共用，冷資料交給 I/O 執行緒），並以 posix_fadvise 提示循序讀取與預讀下一段
+// transform 不為 NULL 時輸出經過轉換；chunked 為 1 時以 chunked 編碼分段並送出結尾的空 chunk
+// 回傳送到 socket 的位元組數（含 chunk 框架），一個位元組都沒送出且發生錯誤時回傳 -1
+// 中途失敗時不送結尾 chunk，讓用戶端知道內容不完整
+long long file_stream_send(int socket, int fd, long long offset, long long length,
+                           const FileStreamTransform *transform, int chunked);
+
+#endif // FILE_STREAM_H
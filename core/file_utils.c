@@ -1,7 +1,24 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/socket.h>
+#endif
+#ifdef __linux__
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <linux/openat2.h>
+#endif
 #include "file_utils.h"
+#include "file_stream.h"
+#include "mime.h"
 #include "logger.h"
 
 int read_file(const char *filename, char **content)
@@ -36,46 +53,168 @@ int read_file(const char *filename, char **content)
     return file_size;
 }
 
-const char *get_content_type(const char *path)
+// 檢查 fd 是一般檔案並填入資訊，否則關閉 fd
+static int stat_regular_file(int fd, FileStat *info)
 {
-    const char *ext = strrchr(path, '.');
-    if (!ext)
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
     {
-        return "application/octet-stream";
+        close(fd);
+        errno = EISDIR; // 目錄或其他非一般檔案，與不存在同樣視為 404
+        return -1;
     }
 
-    if (strcmp(ext, ".html") == 0 || strcmp(ext, ".htm") == 0)
-    {
-        return "text/html; charset=utf-8";
-    }
-    else if (strcmp(ext, ".css") == 0)
-    {
-        return "text/css";
-    }
-    else if (strcmp(ext, ".js") == 0)
-    {
-        return "application/javascript";
-    }
-    else if (strcmp(ext, ".json") == 0)
-    {
-        return "application/json";
-    }
-    else if (strcmp(ext, ".png") == 0)
+    info->size = st.st_size;
+    info->mtime = st.st_mtime;
+#if defined(__linux__)
+    info->mtime_nsec = st.st_mtim.tv_nsec;
+#elif defined(__APPLE__)
+    info->mtime_nsec = st.st_mtimespec.tv_nsec;
+#else
+    info->mtime_nsec = 0;
+#endif
+    info->inode = st.st_ino;
+    return fd;
+}
+
+int open_regular_file(const char *path, FileStat *info)
+{
+#ifdef _WIN32
+    int fd = open(path, O_RDONLY | O_BINARY);
+#else
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+#endif
+    if (fd < 0)
     {
-        return "image/png";
+        return -1;
     }
-    else if (strcmp(ext, ".jpg") == 0 || strcmp(ext, ".jpeg") == 0)
+    return stat_regular_file(fd, info);
+}
+
+int open_directory(const char *path)
+{
+#ifdef _WIN32
+    (void)path;
+    return -1;
+#else
+    return open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+#endif
+}
+
+#ifndef _WIN32
+// 以 dir_fd 為根開啟 relative，解析過程不能離開 dir_fd（見 open_regular_file_beneath）
+static int open_beneath(int dir_fd, const char *relative, int flags)
+{
+#if defined(__linux__) && defined(SYS_openat2)
+    // 核心不支援 openat2（5.6 以前）時改用 openat，只記錄一次
+    static int openat2_unsupported = 0;
+    if (!__atomic_load_n(&openat2_unsupported, __ATOMIC_RELAXED))
     {
-        return "image/jpeg";
+        struct open_how how;
+        memset(&how, 0, sizeof(how));
+        how.flags = flags;
+        how.resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS;
+        int fd = (int)syscall(SYS_openat2, dir_fd, relative, &how, sizeof(how));
+        if (fd >= 0 || errno != ENOSYS)
+            return fd;
+        __atomic_store_n(&openat2_unsupported, 1, __ATOMIC_RELAXED);
+        log_message(LOG_WARNING, "openat2 is not available, symlinks are not confined to the document root");
     }
-    else if (strcmp(ext, ".gif") == 0)
+#endif
+    return openat(dir_fd, relative, flags);
+}
+#endif
+
+int open_regular_file_beneath(int dir_fd, const char *relative, FileStat *info)
+{
+#ifdef _WIN32
+    (void)dir_fd;
+    (void)relative;
+    (void)info;
+    errno = ENOSYS;
+    return -1;
+#else
+    int fd = open_beneath(dir_fd, relative, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    return stat_regular_file(fd, info);
+#endif
+}
+
+int open_directory_beneath(int dir_fd, const char *relative)
+{
+#ifdef _WIN32
+    (void)dir_fd;
+    (void)relative;
+    errno = ENOSYS;
+    return -1;
+#else
+    return open_beneath(dir_fd, relative[0] ? relative : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+#endif
+}
+
+long long read_file_at(int fd, char *buffer, long long length, long long offset)
+{
+    long long total_read = 0;
+#ifdef _WIN32
+    if (lseek(fd, offset, SEEK_SET) < 0)
+        return -1;
+#endif
+    while (total_read < length)
     {
-        return "image/gif";
+        long long remaining = length - total_read;
+        unsigned int chunk = remaining > 0x7ffff000 ? 0x7ffff000 : (unsigned int)remaining;
+#ifdef _WIN32
+        int bytes_read = read(fd, buffer + total_read, chunk);
+#else
+        ssize_t bytes_read = pread(fd, buffer + total_read, chunk, offset + total_read);
+        if (bytes_read < 0 && errno == EINTR)
+            continue;
+#endif
+        if (bytes_read <= 0)
+            break;
+        total_read += bytes_read;
     }
-    else if (strcmp(ext, ".txt") == 0)
+    return total_read;
+}
+
+long long send_file(int socket, int fd, long long offset, long long length)
+{
+    long long total_sent = 0;
+
+#ifdef __linux__
+    // 大檔案提示核心循序讀取，加大預讀
+    if (length > FILE_STREAM_BUFFER_SIZE)
+        posix_fadvise(fd, offset, length, POSIX_FADV_SEQUENTIAL);
+    off_t file_offset = offset;
+    while (total_sent < length)
     {
-        return "text/plain; charset=utf-8";
+        // 單次最多送出約 2GB，迴圈處理較大的檔案與部分送出
+        size_t chunk = length - total_sent > 0x7ffff000 ? 0x7ffff000 : (size_t)(length - total_sent);
+        ssize_t sent = sendfile(socket, fd, &file_offset, chunk);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (sent == 0)
+            break; // 檔案在傳送途中被截斷
+        total_sent += sent;
     }
+#else
+    // 沒有 sendfile 的平台：以共用的緩衝區分段 pread 後送出
+    total_sent = file_stream_send(socket, fd, offset, length, NULL, 0);
+    if (total_sent < 0)
+        total_sent = 0;
+#endif
+
+    if (total_sent == 0 && length > 0)
+        return -1;
+    return total_sent;
+}
 
-    return "application/octet-stream";
-}
\ No newline at end of file
+const char *get_content_type(const char *path)
+{
+    return mime_lookup(path)->type;
+}
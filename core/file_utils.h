@@ -2,6 +2,41 @@
 #define FILE_UTILS_H
 
 int read_file(const char *filename, char **content);
+
+// 開啟的檔案資訊，用於 Content-Length 與 ETag / Last-Modified
+typedef struct
+{
+    long long size;
+    long long mtime;      // 秒
+    long long mtime_nsec; // 不支援時為 0
+    unsigned long long inode;
+} FileStat;
+
+// 開啟一般檔案（不含目錄、裝置等），成功回傳 fd 並填入檔案資訊
+// 失敗回傳 -1 並設定 errno；不是一般檔案時 errno 為 EISDIR
+int open_regular_file(const char *path, FileStat *info);
+
+// 以目錄 dir_fd 為根開啟 relative（不可以 '/' 開頭），解析過程不能離開 dir_fd
+// Linux 以 openat2(RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS) 由核心檢查，
+// 符號連結指向根目錄之外時失敗（errno 為 EXDEV）；其他平台以 openat 開啟，
+// 只能依賴呼叫者先去除 ".."。其餘行為與 open_regular_file 相同
+int open_regular_file_beneath(int dir_fd, const char *relative, FileStat *info);
+
+// 開啟目錄作為 open_regular_file_beneath 的根，失敗回傳 -1
+int open_directory(const char *path);
+
+// 以 dir_fd 為根開啟子目錄 relative（空字串表示 dir_fd 本身），限制與 open_regular_file_beneath 相同
+int open_directory_beneath(int dir_fd, const char *relative);
+
+// 從 offset 讀取最多 length 位元組（POSIX 使用 pread，不改變檔案位置，可在多個執行緒共用 fd），
+// 回傳實際讀取的位元組數
+long long read_file_at(int fd, char *buffer, long long length, long long offset);
+
+// 將 fd 從 offset 起的 length 位元組送到 socket（Linux 使用 sendfile 零複製），
+// 處理部分送出與 EINTR，回傳實際送出的位元組數，一個位元組都沒送出且發生錯誤時回傳 -1
+long long send_file(int socket, int fd, long long offset, long long length);
+
+// 依副檔名回傳 Content-Type（查詢 mime.h 的登錄表）
 const char *get_content_type(const char *path);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,419 @@
+// http_utils.c - HTTP 標頭解析與格式化實現
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+#include "http_utils.h"
+
+static int http_name_equals(const char *a, const char *b, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i]))
+            return 0;
+    }
+    return 1;
+}
+
+int http_find_header(const char *request, const char *name, char *value, size_t size)
+{
+    size_t name_len = strlen(name);
+
+    // 跳過請求行
+    const char *line = strstr(request, "\r\n");
+    while (line)
+    {
+        line += 2;
+        if (line[0] == '\r' || line[0] == '\0')
+            return -1; // 標頭區結束
+
+        const char *line_end = strstr(line, "\r\n");
+        if (!line_end)
+            line_end = line + strlen(line);
+
+        if ((size_t)(line_end - line) > name_len && line[name_len] == ':' &&
+            http_name_equals(line, name, name_len))
+        {
+            const char *start = line + name_len + 1;
+            while (start < line_end && (*start == ' ' || *start == '\t'))
+                start++;
+            const char *end = line_end;
+            while (end > start && (end[-1] == ' ' || end[-1] == '\t'))
+                end--;
+
+            size_t len = end - start;
+            if (len >= size)
+                len = size - 1;
+            memcpy(value, start, len);
+            value[len] = '\0';
+            return (int)len;
+        }
+
+        line = *line_end ? line_end : NULL;
+    }
+    return -1;
+}
+
+// 解析 ";q=0.8" 形式的權重，沒有 q 參數時為 1000
+static int http_parse_quality(const char *params, const char *end)
+{
+    const char *q = params;
+    while (q < end)
+    {
+        while (q < end && (*q == ';' || *q == ' ' || *q == '\t'))
+            q++;
+        if (end - q >= 2 && (q[0] == 'q' || q[0] == 'Q') && q[1] == '=')
+        {
+            q += 2;
+            int quality = 0;
+            if (q < end && *q == '1')
+                return 1000;
+            if (q < end && *q == '0')
+                q++;
+            if (q < end && *q == '.')
+            {
+                q++;
+                int scale = 100;
+                while (q < end && isdigit((unsigned char)*q) && scale > 0)
+                {
+                    quality += (*q - '0') * scale;
+                    scale /= 10;
+                    q++;
+                }
+            }
+            return quality;
+        }
+        while (q < end && *q != ';')
+            q++;
+    }
+    return 1000;
+}
+
+int http_encoding_quality(const char *accept_encoding, const char *coding)
+{
+    if (!accept_encoding)
+        return 0;
+
+    size_t coding_len = strlen(coding);
+    int wildcard = -1;
+
+    const char *item = accept_encoding;
+    while (*item)
+    {
+        while (*item == ' ' || *item == '\t' || *item == ',')
+            item++;
+        if (!*item)
+            break;
+
+        const char *item_end = strchr(item, ',');
+        if (!item_end)
+            item_end = item + strlen(item);
+
+        const char *name_end = item;
+        while (name_end < item_end && *name_end != ';' && *name_end != ' ' && *name_end != '\t')
+            name_end++;
+
+        size_t name_len = name_end - item;
+        int quality = http_parse_quality(name_end, item_end);
+        if (name_len == coding_len && http_name_equals(item, coding, coding_len))
+            return quality;
+        if (name_len == 1 && item[0] == '*')
+            wildcard = quality;
+
+        item = item_end;
+    }
+
+    return wildcard > 0 ? wildcard : 0;
+}
+
+static const char *const g_month_names[12] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                              "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+int http_format_date(char *buffer, size_t size, long long timestamp)
+{
+    time_t t = (time_t)timestamp;
+    struct tm tm_utc;
+#ifdef _WIN32
+    gmtime_s(&tm_utc, &t);
+#else
+    gmtime_r(&t, &tm_utc);
+#endif
+    return (int)strftime(buffer, size, "%a, %d %b %Y %H:%M:%S GMT", &tm_utc);
+}
+
+// 公曆日期轉換為 1970-01-01 起的天數，不依賴時區設定
+static long long http_days_from_civil(int year, int month, int day)
+{
+    year -= month <= 2;
+    long long era = (year >= 0 ? year : year - 399) / 400;
+    int year_of_era = year - (int)(era * 400);
+    int day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+long long http_parse_date(const char *value)
+{
+    int day, year, hour, minute, second;
+    char month_name[4];
+    if (sscanf(value, "%*3s, %2d %3s %4d %2d:%2d:%2d GMT", &day, month_name, &year, &hour, &minute, &second) != 6)
+        return -1;
+
+    int month = -1;
+    for (int i = 0; i < 12; i++)
+    {
+        if (strcmp(month_name, g_month_names[i]) == 0)
+        {
+            month = i + 1;
+            break;
+        }
+    }
+    if (month < 0 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60)
+        return -1;
+
+    return http_days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+}
+
+int http_etag_match(const char *if_none_match, const char *etag)
+{
+    if (!if_none_match || !etag)
+        return 0;
+
+    if (etag[0] == 'W' && etag[1] == '/')
+        etag += 2;
+    size_t etag_len = strlen(etag);
+
+    const char *item = if_none_match;
+    while (*item)
+    {
+        while (*item == ' ' || *item == '\t' || *item == ',')
+            item++;
+        if (!*item)
+            break;
+        if (*item == '*')
+            return 1;
+
+        if (item[0] == 'W' && item[1] == '/')
+            item += 2;
+        const char *item_end = item;
+        if (*item_end == '"')
+        {
+            item_end = strchr(item + 1, '"');
+            item_end = item_end ? item_end + 1 : item + strlen(item);
+        }
+        else
+        {
+            while (*item_end && *item_end != ',')
+                item_end++;
+        }
+
+        if ((size_t)(item_end - item) == etag_len && strncmp(item, etag, etag_len) == 0)
+            return 1;
+        item = item_end;
+    }
+    return 0;
+}
+
+static const char *http_skip_spaces(const char *p)
+{
+    while (*p == ' ' || *p == '\t')
+        p++;
+    return p;
+}
+
+// 解析非負整數，沒有數字或溢位時回傳 -1
+static long long http_parse_offset(const char **p)
+{
+    if (!isdigit((unsigned char)**p))
+        return -1;
+    long long value = 0;
+    while (isdigit((unsigned char)**p))
+    {
+        if (value > (0x7fffffffffffffffLL - 9) / 10)
+            return -1;
+        value = value * 10 + (**p - '0');
+        (*p)++;
+    }
+    return value;
+}
+
+int http_parse_range(const char *value, long long size, HttpRange *ranges, int max)
+{
+    const char *p = http_skip_spaces(value);
+    if (strncmp(p, "bytes", 5) != 0)
+        return -1;
+    p = http_skip_spaces(p + 5);
+    if (*p != '=')
+        return -1;
+    p++;
+
+    int count = 0;
+    int specs = 0;
+    while (1)
+    {
+        p = http_skip_spaces(p);
+        if (*p == ',')
+        {
+            p++;
+            continue;
+        }
+        if (*p == '\0')
+            break;
+        if (++specs > max)
+            return -1;
+
+        long long start, end;
+        int satisfiable = 1;
+        if (*p == '-')
+        {
+            // 最後 N 個位元組
+            p++;
+            long long suffix = http_parse_offset(&p);
+            if (suffix < 0)
+                return -1;
+            satisfiable = suffix > 0 && size > 0;
+            start = suffix >= size ? 0 : size - suffix;
+            end = size - 1;
+        }
+        else
+        {
+            start = http_parse_offset(&p);
+            if (start < 0 || *p != '-')
+                return -1;
+            p++;
+            end = size - 1;
+            if (isdigit((unsigned char)*p))
+            {
+                long long last = http_parse_offset(&p);
+                if (last < 0 || last < start)
+                    return -1;
+                if (last < end)
+                    end = last;
+            }
+            satisfiable = start < size;
+        }
+
+        if (satisfiable)
+        {
+            ranges[count].start = start;
+            ranges[count].end = end;
+            count++;
+        }
+
+        p = http_skip_spaces(p);
+        if (*p != ',' && *p != '\0')
+            return -1;
+    }
+    return specs > 0 ? count : -1;
+}
+
+static int http_hex_value(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+int http_normalize_path(const char *target, char *out, size_t size)
+{
+    if (target[0] != '/' || size < 2)
+        return -1;
+
+    size_t len = 0;
+    out[len++] = '/';
+    size_t segment = len; // 目前片段在 out 中的起點（前一個字元必定是 '/'）
+    for (const char *p = target + 1;; p++)
+    {
+        int c = (unsigned char)*p;
+        int end = c == '\0' || c == '?' || c == '#';
+        if (c == '%')
+        {
+            int high = http_hex_value(p[1]);
+            int low = high < 0 ? -1 : http_hex_value(p[2]);
+            if (low < 0)
+                return -1;
+            c = high * 16 + low;
+            if (c == 0)
+                return -1;
+            p += 2;
+        }
+#ifdef _WIN32
+        if (c == '\\' || c == ':')
+            return -1; // 避免被當成路徑分隔符號或磁碟代號
+#endif
+
+        if (!end && c != '/')
+        {
+            if (len + 1 >= size)
+                return -1;
+            out[len++] = (char)c;
+            continue;
+        }
+
+        // 片段結束：解碼後的 "." 與 ".." 也一併處理（%2e%2e 無法繞過）
+        size_t segment_len = len - segment;
+        if (segment_len == 1 && out[segment] == '.')
+        {
+            len = segment;
+        }
+        else if (segment_len == 2 && out[segment] == '.' && out[segment + 1] == '.')
+        {
+            if (segment == 1)
+                return -1; // 超出根目錄
+            len = segment - 1;
+            while (out[len - 1] != '/')
+                len--;
+        }
+        else if (segment_len > 0 && !end)
+        {
+            if (len + 1 >= size)
+                return -1;
+            out[len++] = '/';
+        }
+
+        if (end)
+            break;
+        segment = len;
+    }
+    out[len] = '\0';
+    return (int)len;
+}
+
+int http_query_param(const char *target, const char *name, char *value, size_t size)
+{
+    const char *query = strchr(target, '?');
+    if (!query)
+        return -1;
+
+    size_t name_len = strlen(name);
+    const char *item = query + 1;
+    while (*item && *item != '#')
+    {
+        const char *item_end = item;
+        while (*item_end && *item_end != '&' && *item_end != '#')
+            item_end++;
+
+        if ((size_t)(item_end - item) >= name_len && strncmp(item, name, name_len) == 0 &&
+            (item + name_len == item_end || item[name_len] == '='))
+        {
+            const char *start = item + name_len;
+            if (start < item_end)
+                start++;
+            size_t len = item_end - start;
+            if (len >= size)
+                len = size - 1;
+            memcpy(value, start, len);
+            value[len] = '\0';
+            return (int)len;
+        }
+
+        item = *item_end == '&' ? item_end + 1 : item_end;
+    }
+    return -1;
+}
@@ -0,0 +1,47 @@
+// http_utils.h - HTTP 標頭解析與格式化的共用工具
+#ifndef HTTP_UTILS_H
+#define HTTP_UTILS_H
+
+#include <stddef.h>
+
+// 在原始請求文字中尋找標頭（名稱不分大小寫，只搜尋空行之前的標頭區）
+// 找到時把去除前後空白的值複製到 value 並回傳其長度，找不到回傳 -1
+int http_find_header(const char *request, const char *name, char *value, size_t size);
+
+// 依 Accept-Encoding 回傳 coding 的權重（q 值乘以 1000，範圍 0~1000）
+// 沒有列出時依 "*" 決定；明確以 q=0 排除或完全不接受時回傳 0
+int http_encoding_quality(const char *accept_encoding, const char *coding);
+
+// 以 IMF-fixdate 格式化時間（例如 "Sun, 06 Nov 1994 08:49:37 GMT"），回傳長度
+int http_format_date(char *buffer, size_t size, long long timestamp);
+
+// 解析 IMF-fixdate，失敗時回傳 -1
+long long http_parse_date(const char *value);
+
+// If-None-Match 是否包含 etag（"*" 或清單中任一項，以弱比較忽略 W/ 前綴）
+int http_etag_match(const char *if_none_match, const char *etag);
+
+#define HTTP_MAX_RANGES 16
+
+// 位元組範圍，start 與 end 皆包含在內
+typedef struct
+{
+    long long start;
+    long long end;
+} HttpRange;
+
+// 解析 "bytes=0-99,200-,-500"，依檔案大小 size 轉換成實際範圍並寫入 ranges（最多 max 個）
+// 回傳可滿足的範圍數；沒有任何可滿足的範圍時回傳 0（416）
+// 格式錯誤、不是 bytes 單位或範圍太多時回傳 -1，應忽略 Range 送出完整內容
+int http_parse_range(const char *value, long long size, HttpRange *ranges, int max);
+
+// 將請求目標（例如 "/a//b/./%63.txt?x=1"）解碼並正規化成 "/a/b/c.txt" 寫入 out
+// 一次掃描完成：去掉查詢字串、解碼 %XX、合併重複的 '/'、處理 "." 與 ".." 片段
+// 格式錯誤、含有 %00、".." 超出根目錄或超過 size 時回傳 -1，否則回傳長度
+int http_normalize_path(const char *target, char *out, size_t size);
+
+// 從請求目標的查詢字串（"?" 之後、"#" 之前）取出參數 name 的原始值寫入 value（不解碼）
+// 找不到時回傳 -1，否則回傳長度（值過長時截斷）
+int http_query_param(const char *target, const char *name, char *value, size_t size);
+
+#endif // HTTP_UTILS_H
@@ -0,0 +1,482 @@
+// latency.c - 延遲直方圖與請求階段計時實現
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#ifndef _WIN32
+#include <unistd.h>
+#include <signal.h>
+#endif
+
+#include "latency.h"
+#include "trace.h"
+#include "logger.h"
+
+#define HDR_SUB_BUCKET_COUNT (1 << HDR_SUB_BUCKET_BITS)
+#define HDR_SUB_BUCKET_HALF (HDR_SUB_BUCKET_COUNT / 2)
+#define HDR_MAX_SHIFT (HDR_MAX_VALUE_BITS - HDR_SUB_BUCKET_BITS)
+#define HDR_SLOTS (HDR_SUB_BUCKET_COUNT + HDR_MAX_SHIFT * HDR_SUB_BUCKET_HALF)
+#define HDR_MAX_VALUE ((1ULL << HDR_MAX_VALUE_BITS) - 1)
+
+struct HdrHistogram
+{
+    // 每個分片 HDR_SLOTS 個計數 + 1 個總和，第一次寫入時才配置
+    uint64_t *shards[HDR_SHARDS];
+};
+
+static int g_next_shard = 0;
+static __thread int tls_shard = -1;
+
+static inline int current_shard(void)
+{
+    if (tls_shard < 0)
+    {
+        tls_shard = __atomic_fetch_add(&g_next_shard, 1, __ATOMIC_RELAXED) % HDR_SHARDS;
+    }
+    return tls_shard;
+}
+
+// 數值 -> bucket 索引：小於 128 線性對應，之後每個 2 的冪次切成 64 格
+static inline int hdr_index(uint64_t value)
+{
+    if (value > HDR_MAX_VALUE)
+        value = HDR_MAX_VALUE;
+    if (value < HDR_SUB_BUCKET_COUNT)
+        return (int)value;
+
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - (HDR_SUB_BUCKET_BITS - 1);
+    int sub = (int)(value >> shift) - HDR_SUB_BUCKET_HALF;
+    return HDR_SUB_BUCKET_COUNT + (shift - 1) * HDR_SUB_BUCKET_HALF + sub;
+}
+
+// bucket 索引 -> 該 bucket 可代表的最大值
+static inline uint64_t hdr_value_at(int index)
+{
+    if (index < HDR_SUB_BUCKET_COUNT)
+        return (uint64_t)index;
+
+    int offset = index - HDR_SUB_BUCKET_COUNT;
+    int shift = offset / HDR_SUB_BUCKET_HALF + 1;
+    uint64_t sub = (uint64_t)(offset % HDR_SUB_BUCKET_HALF + HDR_SUB_BUCKET_HALF);
+    return ((sub + 1) << shift) - 1;
+}
+
+HdrHistogram *hdr_create(void)
+{
+    return calloc(1, sizeof(HdrHistogram));
+}
+
+void hdr_destroy(HdrHistogram *hist)
+{
+    if (!hist)
+        return;
+    for (int s = 0; s < HDR_SHARDS; s++)
+        free(hist->shards[s]);
+    free(hist);
+}
+
+static uint64_t *hdr_shard(HdrHistogram *hist)
+{
+    int s = current_shard();
+    uint64_t *counts = __atomic_load_n(&hist->shards[s], __ATOMIC_ACQUIRE);
+    if (counts)
+        return counts;
+
+    uint64_t *fresh = calloc(HDR_SLOTS + 1, sizeof(uint64_t));
+    if (!fresh)
+        return NULL;
+
+    uint64_t *expected = NULL;
+    if (__atomic_compare_exchange_n(&hist->shards[s], &expected, fresh, 0,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        return fresh;
+    }
+
+    // 其他共用此分片的執行緒已先配置
+    free(fresh);
+    return expected;
+}
+
+void hdr_record(HdrHistogram *hist, uint64_t value)
+{
+    if (!hist)
+        return;
+
+    uint64_t *counts = hdr_shard(hist);
+    if (!counts)
+        return;
+
+    __atomic_fetch_add(&counts[hdr_index(value)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&counts[HDR_SLOTS], value, __ATOMIC_RELAXED);
+}
+
+void hdr_record_corrected(HdrHistogram *hist, uint64_t value, uint64_t expected_interval)
+{
+    hdr_record(hist, value);
+    if (expected_interval == 0 || value <= expected_interval)
+        return;
+
+    for (uint64_t missing = value - expected_interval; missing >= expected_interval;
+         missing -= expected_interval)
+    {
+        hdr_record(hist, missing);
+    }
+}
+
+// 合併所有分片，回傳總筆數
+static uint64_t hdr_merge(HdrHistogram *hist, uint64_t *merged)
+{
+    uint64_t total = 0;
+    memset(merged, 0, (HDR_SLOTS + 1) * sizeof(uint64_t));
+
+    for (int s = 0; s < HDR_SHARDS; s++)
+    {
+        uint64_t *counts = __atomic_load_n(&hist->shards[s], __ATOMIC_ACQUIRE);
+        if (!counts)
+            continue;
+        for (int i = 0; i <= HDR_SLOTS; i++)
+        {
+            uint64_t c = __atomic_load_n(&counts[i], __ATOMIC_RELAXED);
+            merged[i] += c;
+            if (i < HDR_SLOTS)
+                total += c;
+        }
+    }
+    return total;
+}
+
+static uint64_t merged_percentile(const uint64_t *merged, uint64_t total, double percentile)
+{
+    if (total == 0)
+        return 0;
+
+    uint64_t rank = (uint64_t)(percentile / 100.0 * total + 0.5);
+    if (rank < 1)
+        rank = 1;
+    if (rank > total)
+        rank = total;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < HDR_SLOTS; i++)
+    {
+        seen += merged[i];
+        if (seen >= rank)
+            return hdr_value_at(i);
+    }
+    return hdr_value_at(HDR_SLOTS - 1);
+}
+
+uint64_t hdr_percentile(HdrHistogram *hist, double percentile)
+{
+    uint64_t *merged = malloc((HDR_SLOTS + 1) * sizeof(uint64_t));
+    if (!merged)
+        return 0;
+    uint64_t total = hdr_merge(hist, merged);
+    uint64_t value = merged_percentile(merged, total, percentile);
+    free(merged);
+    return value;
+}
+
+void hdr_summarize(HdrHistogram *hist, HdrSummary *summary)
+{
+    memset(summary, 0, sizeof(*summary));
+
+    uint64_t *merged = malloc((HDR_SLOTS + 1) * sizeof(uint64_t));
+    if (!merged)
+        return;
+
+    uint64_t total = hdr_merge(hist, merged);
+    summary->count = total;
+    if (total > 0)
+    {
+        for (int i = 0; i < HDR_SLOTS; i++)
+        {
+            if (merged[i])
+            {
+                summary->min = hdr_value_at(i);
+                break;
+            }
+        }
+        for (int i = HDR_SLOTS - 1; i >= 0; i--)
+        {
+            if (merged[i])
+            {
+                summary->max = hdr_value_at(i);
+                break;
+            }
+        }
+        summary->mean = (double)merged[HDR_SLOTS] / total;
+        summary->p50 = merged_percentile(merged, total, 50.0);
+        summary->p90 = merged_percentile(merged, total, 90.0);
+        summary->p99 = merged_percentile(merged, total, 99.0);
+        summary->p999 = merged_percentile(merged, total, 99.9);
+    }
+
+    free(merged);
+}
+
+// ---- 路由與階段 ----
+
+struct LatencyRoute
+{
+    char *label;
+    HdrHistogram *stages[STAGE_COUNT];
+    LatencyRoute *next;
+};
+
+static const char *g_stage_names[STAGE_COUNT] = {
+    "queue", "parse", "route", "handler", "send", "total"};
+
+// 每個階段的起點與終點
+static const LatencyPoint g_stage_bounds[STAGE_COUNT][2] = {
+    {LAT_ACCEPT, LAT_FIRST_BYTE},
+    {LAT_FIRST_BYTE, LAT_PARSED},
+    {LAT_PARSED, LAT_ROUTED},
+    {LAT_ROUTED, LAT_HANDLED},
+    {LAT_HANDLED, LAT_SENT},
+    {LAT_ACCEPT, LAT_SENT}};
+
+static LatencyRoute *g_routes = NULL;
+static pthread_mutex_t g_routes_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+LatencyRoute *latency_route(const char *label)
+{
+    pthread_mutex_lock(&g_routes_mutex);
+
+    LatencyRoute **tail = &g_routes;
+    for (LatencyRoute *r = g_routes; r; r = r->next)
+    {
+        if (strcmp(r->label, label) == 0)
+        {
+            pthread_mutex_unlock(&g_routes_mutex);
+            return r;
+        }
+        tail = &r->next;
+    }
+
+    LatencyRoute *route = calloc(1, sizeof(LatencyRoute));
+    if (route)
+    {
+        route->label = strdup(label);
+        for (int i = 0; i < STAGE_COUNT; i++)
+            route->stages[i] = hdr_create();
+        *tail = route;
+    }
+
+    pthread_mutex_unlock(&g_routes_mutex);
+    return route;
+}
+
+uint64_t latency_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// 目前執行緒正在處理的請求
+typedef struct
+{
+    uint64_t marks[LAT_POINT_COUNT];
+    LatencyRoute *route;
+} RequestTiming;
+
+static __thread RequestTiming tls_request;
+
+void latency_begin(uint64_t accept_ns)
+{
+    memset(&tls_request, 0, sizeof(tls_request));
+    tls_request.marks[LAT_ACCEPT] = accept_ns ? accept_ns : latency_now();
+}
+
+void latency_mark(LatencyPoint point)
+{
+    tls_request.marks[point] = latency_now();
+}
+
+void latency_set_route(LatencyRoute *route)
+{
+    tls_request.route = route;
+}
+
+void latency_finish(void)
+{
+    static LatencyRoute *unmatched = NULL;
+
+    RequestTiming *req = &tls_request;
+    if (!req->marks[LAT_FIRST_BYTE])
+        return; // 連線沒有送出任何請求
+
+    if (!req->marks[LAT_SENT])
+        req->marks[LAT_SENT] = latency_now();
+
+    LatencyRoute *route = req->route;
+    if (!route)
+    {
+        route = __atomic_load_n(&unmatched, __ATOMIC_ACQUIRE);
+        if (!route)
+        {
+            route = latency_route("unmatched");
+            __atomic_store_n(&unmatched, route, __ATOMIC_RELEASE);
+        }
+    }
+    if (!route)
+        return;
+
+    if (trace_enabled())
+        trace_record_request(route->label, req->marks);
+
+    // 沒有標記的時間點（例如靜態伺服器沒有路由）對應的階段不記錄
+    for (int i = 0; i < STAGE_COUNT; i++)
+    {
+        uint64_t start = req->marks[g_stage_bounds[i][0]];
+        uint64_t end = req->marks[g_stage_bounds[i][1]];
+        if (start && end && end >= start)
+            hdr_record(route->stages[i], end - start);
+    }
+}
+
+// ---- 報表 ----
+
+typedef struct
+{
+    char *data;
+    size_t size;
+    size_t capacity;
+} ReportBuffer;
+
+static void report_appendf(ReportBuffer *buf, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int needed = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+
+    if (needed < 0)
+        return;
+
+    if (buf->size + needed + 1 > buf->capacity)
+    {
+        size_t capacity = buf->capacity ? buf->capacity : 4096;
+        while (buf->size + needed + 1 > capacity)
+            capacity *= 2;
+        char *data = realloc(buf->data, capacity);
+        if (!data)
+            return;
+        buf->data = data;
+        buf->capacity = capacity;
+    }
+
+    va_start(args, format);
+    vsnprintf(buf->data + buf->size, buf->capacity - buf->size, format, args);
+    va_end(args);
+    buf->size += needed;
+}
+
+char *latency_report_json(void)
+{
+    ReportBuffer buf = {0};
+    report_appendf(&buf, "{\"unit\":\"us\",\"routes\":[");
+
+    pthread_mutex_lock(&g_routes_mutex);
+    for (LatencyRoute *r = g_routes; r; r = r->next)
+    {
+        report_appendf(&buf, "%s{\"route\":\"%s\",\"stages\":{", r == g_routes ? "" : ",", r->label);
+        for (int i = 0; i < STAGE_COUNT; i++)
+        {
+            HdrSummary s;
+            hdr_summarize(r->stages[i], &s);
+            report_appendf(&buf,
+                           "%s\"%s\":{\"count\":%llu,\"mean\":%.3f,\"p50\":%.3f,"
+                           "\"p99\":%.3f,\"p999\":%.3f,\"max\":%.3f}",
+                           i ? "," : "", g_stage_names[i], (unsigned long long)s.count,
+                           s.mean / 1000.0, s.p50 / 1000.0, s.p99 / 1000.0,
+                           s.p999 / 1000.0, s.max / 1000.0);
+        }
+        report_appendf(&buf, "}}");
+    }
+    pthread_mutex_unlock(&g_routes_mutex);
+
+    report_appendf(&buf, "]}");
+    return buf.data;
+}
+
+void latency_dump(void)
+{
+    pthread_mutex_lock(&g_routes_mutex);
+    log_info("Latency report (us):");
+    for (LatencyRoute *r = g_routes; r; r = r->next)
+    {
+        for (int i = 0; i < STAGE_COUNT; i++)
+        {
+            HdrSummary s;
+            hdr_summarize(r->stages[i], &s);
+            if (s.count == 0)
+                continue;
+            log_info("  %-32s %-8s count=%llu p50=%.1f p99=%.1f p999=%.1f max=%.1f",
+                     r->label, g_stage_names[i], (unsigned long long)s.count,
+                     s.p50 / 1000.0, s.p99 / 1000.0, s.p999 / 1000.0, s.max / 1000.0);
+        }
+    }
+    pthread_mutex_unlock(&g_routes_mutex);
+}
+
+#ifndef _WIN32
+// 信號處理函數只寫入 pipe，實際輸出在專用執行緒中進行
+static int g_dump_pipe[2] = {-1, -1};
+
+static void dump_signal_handler(int sig)
+{
+    (void)sig;
+    int saved_errno = errno;
+    char c = 1;
+    if (write(g_dump_pipe[1], &c, 1) < 0)
+    {
+        // pipe 已滿時忽略，下一次信號仍會觸發輸出
+    }
+    errno = saved_errno;
+}
+
+static void *dump_thread(void *arg)
+{
+    (void)arg;
+    char c;
+    while (read(g_dump_pipe[0], &c, 1) > 0)
+    {
+        latency_dump();
+    }
+    return NULL;
+}
+#endif
+
+int latency_install_dump_signal(void)
+{
+#ifdef _WIN32
+    return -1;
+#else
+    if (g_dump_pipe[0] >= 0)
+        return 0;
+
+    if (pipe(g_dump_pipe) != 0)
+    {
+        log_error("Failed to create latency dump pipe");
+        return -1;
+    }
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, dump_thread, NULL) != 0)
+    {
+        log_error("Failed to create latency dump thread");
+        return -1;
+    }
+    pthread_detach(thread);
+
+    signal(SIGUSR1, dump_signal_handler);
+    return 0;
+#endif
+}
@@ -0,0 +1,81 @@
+// latency.h - 請求延遲分佈（HDR 風格的對數線性直方圖），依路由與處理階段分類
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define HDR_SUB_BUCKET_BITS 7  // 每個 2 的冪次區間切成 64 個子 bucket（誤差 < 1.6%）
+#define HDR_MAX_VALUE_BITS 36  // 可記錄的最大值約 2^36 ns（約 68 秒），超過者計入最後一格
+#define HDR_SHARDS 8           // 每個直方圖的執行緒分片數
+
+// 對數線性直方圖（單位由呼叫者決定，請求延遲一律使用奈秒）
+typedef struct HdrHistogram HdrHistogram;
+
+typedef struct
+{
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    double mean;
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t p999;
+} HdrSummary;
+
+HdrHistogram *hdr_create(void);
+void hdr_destroy(HdrHistogram *hist);
+void hdr_record(HdrHistogram *hist, uint64_t value);
+// 補償 coordinated omission：依預期間隔補記被延遲遮蔽的樣本
+void hdr_record_corrected(HdrHistogram *hist, uint64_t value, uint64_t expected_interval);
+uint64_t hdr_percentile(HdrHistogram *hist, double percentile);
+void hdr_summarize(HdrHistogram *hist, HdrSummary *summary);
+
+// 請求生命週期中的時間點
+typedef enum
+{
+    LAT_ACCEPT,     // accept() 回傳
+    LAT_FIRST_BYTE, // 收到第一批資料
+    LAT_PARSED,     // 請求行/標頭解析完成
+    LAT_ROUTED,     // 找到對應的路由（或檔案）
+    LAT_HANDLED,    // 處理函數完成
+    LAT_SENT,       // 回應最後一個位元組送出
+    LAT_POINT_COUNT
+} LatencyPoint;
+
+// 兩個時間點之間的階段
+typedef enum
+{
+    STAGE_QUEUE,   // accept -> first byte
+    STAGE_PARSE,   // first byte -> parsed
+    STAGE_ROUTE,   // parsed -> routed (router_handle 比對)
+    STAGE_HANDLER, // routed -> handled
+    STAGE_SEND,    // handled -> sent
+    STAGE_TOTAL,   // accept -> sent
+    STAGE_COUNT
+} LatencyStage;
+
+// 每個路由一組各階段的直方圖
+typedef struct LatencyRoute LatencyRoute;
+
+// 取得（或建立）指定標籤的路由，標籤通常為 "GET /api/users/:id"
+LatencyRoute *latency_route(const char *label);
+
+// 單調時鐘（奈秒）
+uint64_t latency_now(void);
+
+// 以下函數只操作目前執行緒正在處理的請求
+void latency_begin(uint64_t accept_ns);
+void latency_mark(LatencyPoint point);
+void latency_set_route(LatencyRoute *route);
+void latency_finish(void);
+
+// 輸出 p50/p99/p999 報表（JSON 字串需由呼叫者 free）
+char *latency_report_json(void);
+void latency_dump(void);
+
+// 收到 SIGUSR1 時將報表寫入日誌（Windows 上不支援）
+int latency_install_dump_signal(void);
+
+#endif // LATENCY_H
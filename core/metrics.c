@@ -0,0 +1,378 @@
+// metrics.c - 指標註冊與分片計數實現
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <pthread.h>
+
+#include "metrics.h"
+
+struct Metric
+{
+    char *name;
+    char *help;
+    char *labels;
+    MetricType type;
+    uint64_t bounds[METRICS_MAX_BUCKETS];
+    int bound_count;
+    double unit;
+    int stride;     // 每個分片佔用的 int64 數量（對齊快取行）
+    int64_t *cells; // METRICS_MAX_SHARDS * stride，依快取行對齊
+    void *raw;      // cells 的原始配置位址
+    Metric *next;
+};
+
+static Metric *g_metrics = NULL;
+static Metric *g_metrics_tail = NULL;
+static pthread_mutex_t g_metrics_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// 每個執行緒第一次更新時取得分片編號
+static int g_next_shard = 0;
+static __thread int tls_shard = -1;
+
+static inline int current_shard(void)
+{
+    if (tls_shard < 0)
+    {
+        tls_shard = __atomic_fetch_add(&g_next_shard, 1, __ATOMIC_RELAXED) % METRICS_MAX_SHARDS;
+    }
+    return tls_shard;
+}
+
+static int same_labels(const char *a, const char *b)
+{
+    if (!a || !b)
+        return a == b;
+    return strcmp(a, b) == 0;
+}
+
+static Metric *register_metric(MetricType type, const char *name, const char *help,
+                               const char *labels, const uint64_t *bounds,
+                               int bound_count, double unit)
+{
+    if (labels && labels[0] == '\0')
+        labels = NULL;
+
+    pthread_mutex_lock(&g_metrics_mutex);
+
+    for (Metric *m = g_metrics; m; m = m->next)
+    {
+        if (strcmp(m->name, name) == 0 && same_labels(m->labels, labels))
+        {
+            pthread_mutex_unlock(&g_metrics_mutex);
+            return m->type == type ? m : NULL;
+        }
+    }
+
+    Metric *metric = calloc(1, sizeof(Metric));
+    if (!metric)
+    {
+        pthread_mutex_unlock(&g_metrics_mutex);
+        return NULL;
+    }
+
+    metric->name = strdup(name);
+    metric->help = strdup(help ? help : "");
+    metric->labels = labels ? strdup(labels) : NULL;
+    metric->type = type;
+    metric->unit = unit;
+
+    int slots = 1;
+    if (type == METRIC_HISTOGRAM)
+    {
+        if (bound_count > METRICS_MAX_BUCKETS)
+            bound_count = METRICS_MAX_BUCKETS;
+        memcpy(metric->bounds, bounds, bound_count * sizeof(uint64_t));
+        metric->bound_count = bound_count;
+        slots = bound_count + 2; // 各 bucket + +Inf + sum
+    }
+
+    // 每個分片至少獨佔一條快取行，避免 false sharing
+    int per_line = METRICS_CACHE_LINE / sizeof(int64_t);
+    metric->stride = (slots + per_line - 1) / per_line * per_line;
+
+    size_t bytes = (size_t)metric->stride * METRICS_MAX_SHARDS * sizeof(int64_t);
+    metric->raw = calloc(1, bytes + METRICS_CACHE_LINE);
+    if (!metric->raw)
+    {
+        free(metric->name);
+        free(metric->help);
+        free(metric->labels);
+        free(metric);
+        pthread_mutex_unlock(&g_metrics_mutex);
+        return NULL;
+    }
+    metric->cells = (int64_t *)(((uintptr_t)metric->raw + METRICS_CACHE_LINE - 1) &
+                                ~(uintptr_t)(METRICS_CACHE_LINE - 1));
+
+    if (g_metrics_tail)
+        g_metrics_tail->next = metric;
+    else
+        g_metrics = metric;
+    g_metrics_tail = metric;
+
+    pthread_mutex_unlock(&g_metrics_mutex);
+    return metric;
+}
+
+Metric *metrics_counter(const char *name, const char *help, const char *labels)
+{
+    return register_metric(METRIC_COUNTER, name, help, labels, NULL, 0, 1.0);
+}
+
+Metric *metrics_gauge(const char *name, const char *help, const char *labels)
+{
+    return register_metric(METRIC_GAUGE, name, help, labels, NULL, 0, 1.0);
+}
+
+Metric *metrics_histogram(const char *name, const char *help, const char *labels,
+                          const uint64_t *bounds, int bound_count, double unit)
+{
+    return register_metric(METRIC_HISTOGRAM, name, help, labels, bounds, bound_count, unit);
+}
+
+static inline int64_t *shard_cells(Metric *metric)
+{
+    return metric->cells + (size_t)current_shard() * metric->stride;
+}
+
+void metrics_inc(Metric *metric)
+{
+    metrics_add(metric, 1);
+}
+
+void metrics_add(Metric *metric, int64_t delta)
+{
+    if (!metric)
+        return;
+    __atomic_fetch_add(&shard_cells(metric)[0], delta, __ATOMIC_RELAXED);
+}
+
+void metrics_observe(Metric *metric, uint64_t value)
+{
+    if (!metric || metric->type != METRIC_HISTOGRAM)
+        return;
+
+    int bucket = 0;
+    while (bucket < metric->bound_count && value > metric->bounds[bucket])
+        bucket++;
+
+    int64_t *cells = shard_cells(metric);
+    __atomic_fetch_add(&cells[bucket], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&cells[metric->bound_count + 1], (int64_t)value, __ATOMIC_RELAXED);
+}
+
+// 合併所有分片中的某個欄位
+static int64_t sum_slot(Metric *metric, int slot)
+{
+    int64_t total = 0;
+    for (int s = 0; s < METRICS_MAX_SHARDS; s++)
+    {
+        total += __atomic_load_n(&metric->cells[(size_t)s * metric->stride + slot], __ATOMIC_RELAXED);
+    }
+    return total;
+}
+
+int64_t metrics_value(Metric *metric)
+{
+    if (!metric)
+        return 0;
+
+    if (metric->type != METRIC_HISTOGRAM)
+        return sum_slot(metric, 0);
+
+    int64_t count = 0;
+    for (int i = 0; i <= metric->bound_count; i++)
+        count += sum_slot(metric, i);
+    return count;
+}
+
+// 輸出緩衝區
+typedef struct
+{
+    char *data;
+    size_t size;
+    size_t capacity;
+} RenderBuffer;
+
+static void buffer_appendf(RenderBuffer *buf, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int needed = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+
+    if (needed < 0)
+        return;
+
+    if (buf->size + needed + 1 > buf->capacity)
+    {
+        size_t capacity = buf->capacity ? buf->capacity : 4096;
+        while (buf->size + needed + 1 > capacity)
+            capacity *= 2;
+        char *data = realloc(buf->data, capacity);
+        if (!data)
+            return;
+        buf->data = data;
+        buf->capacity = capacity;
+    }
+
+    va_start(args, format);
+    vsnprintf(buf->data + buf->size, buf->capacity - buf->size, format, args);
+    va_end(args);
+    buf->size += needed;
+}
+
+static const char *type_name(MetricType type)
+{
+    switch (type)
+    {
+    case METRIC_COUNTER:
+        return "counter";
+    case METRIC_GAUGE:
+        return "gauge";
+    case METRIC_HISTOGRAM:
+        return "histogram";
+    default:
+        return "untyped";
+    }
+}
+
+static void render_series(RenderBuffer *buf, Metric *m)
+{
+    const char *labels = m->labels ? m->labels : "";
+    const char *open = m->labels ? "{" : "";
+    const char *close = m->labels ? "}" : "";
+
+    if (m->type != METRIC_HISTOGRAM)
+    {
+        buffer_appendf(buf, "%s%s%s%s %lld\n", m->name, open, labels, close,
+                       (long long)sum_slot(m, 0));
+        return;
+    }
+
+    const char *sep = m->labels ? "," : "";
+    int64_t cumulative = 0;
+    for (int i = 0; i < m->bound_count; i++)
+    {
+        cumulative += sum_slot(m, i);
+        buffer_appendf(buf, "%s_bucket{%s%sle=\"%.15g\"} %lld\n", m->name, labels, sep,
+                       (double)m->bounds[i] * m->unit, (long long)cumulative);
+    }
+    cumulative += sum_slot(m, m->bound_count);
+    buffer_appendf(buf, "%s_bucket{%s%sle=\"+Inf\"} %lld\n", m->name, labels, sep,
+                   (long long)cumulative);
+    buffer_appendf(buf, "%s_sum%s%s%s %.15g\n", m->name, open, labels, close,
+                   (double)sum_slot(m, m->bound_count + 1) * m->unit);
+    buffer_appendf(buf, "%s_count%s%s%s %lld\n", m->name, open, labels, close,
+                   (long long)cumulative);
+}
+
+char *metrics_render(size_t *length)
+{
+    RenderBuffer buf = {0};
+
+    pthread_mutex_lock(&g_metrics_mutex);
+
+    // 同名的序列必須集中輸出在同一組 HELP/TYPE 之下
+    for (Metric *m = g_metrics; m; m = m->next)
+    {
+        int seen = 0;
+        for (Metric *prev = g_metrics; prev != m; prev = prev->next)
+        {
+            if (strcmp(prev->name, m->name) == 0)
+            {
+                seen = 1;
+                break;
+            }
+        }
+        if (seen)
+            continue;
+
+        buffer_appendf(&buf, "# HELP %s %s\n", m->name, m->help);
+        buffer_appendf(&buf, "# TYPE %s %s\n", m->name, type_name(m->type));
+        for (Metric *series = m; series; series = series->next)
+        {
+            if (strcmp(series->name, m->name) == 0)
+                render_series(&buf, series);
+        }
+    }
+
+    pthread_mutex_unlock(&g_metrics_mutex);
+
+    if (!buf.data)
+        buf.data = strdup("");
+    if (length)
+        *length = buf.size;
+    return buf.data;
+}
+
+// HTTP 便捷函數：第一次使用時註冊，之後只讀取快取的指標
+static Metric *cached_metric(Metric **slot, Metric *(*create)(void))
+{
+    Metric *metric = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+    if (!metric)
+    {
+        metric = create();
+        __atomic_store_n(slot, metric, __ATOMIC_RELEASE);
+    }
+    return metric;
+}
+
+static Metric *create_requests_total(void)
+{
+    return metrics_counter("http_requests_total", "Total HTTP requests received", NULL);
+}
+
+static Metric *create_received_bytes(void)
+{
+    return metrics_counter("http_received_bytes_total", "Total bytes read from HTTP clients", NULL);
+}
+
+static Metric *create_sent_bytes(void)
+{
+    return metrics_counter("http_sent_bytes_total", "Total bytes written to HTTP clients", NULL);
+}
+
+static Metric *create_response_size(void)
+{
+    static const uint64_t bounds[] = {256, 1024, 4096, 16384, 65536, 262144,
+                                      1048576, 4194304, 16777216, 67108864};
+    return metrics_histogram("http_response_size_bytes", "HTTP response size in bytes", NULL,
+                             bounds, sizeof(bounds) / sizeof(bounds[0]), 1.0);
+}
+
+void metrics_http_request(size_t bytes_received)
+{
+    static Metric *requests = NULL;
+    static Metric *received = NULL;
+
+    metrics_inc(cached_metric(&requests, create_requests_total));
+    metrics_add(cached_metric(&received, create_received_bytes), (int64_t)bytes_received);
+}
+
+void metrics_http_response(int status_code, size_t bytes_sent)
+{
+    static Metric *by_status[600];
+    static Metric *sent = NULL;
+    static Metric *sizes = NULL;
+
+    if (status_code < 100 || status_code >= 600)
+        status_code = 0;
+
+    Metric *status = __atomic_load_n(&by_status[status_code], __ATOMIC_ACQUIRE);
+    if (!status)
+    {
+        char labels[32];
+        if (status_code)
+            snprintf(labels, sizeof(labels), "code=\"%d\"", status_code);
+        else
+            snprintf(labels, sizeof(labels), "code=\"unknown\"");
+        status = metrics_counter("http_responses_total", "HTTP responses by status code", labels);
+        __atomic_store_n(&by_status[status_code], status, __ATOMIC_RELEASE);
+    }
+
+    metrics_inc(status);
+    metrics_add(cached_metric(&sent, create_sent_bytes), (int64_t)bytes_sent);
+    metrics_observe(cached_metric(&sizes, create_response_size), bytes_sent);
+}
@@ -0,0 +1,46 @@
+// metrics.h - 執行期指標 (counter / gauge / histogram)，以 Prometheus 文字格式輸出
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define METRICS_CACHE_LINE 64
+#define METRICS_MAX_SHARDS 32   // 每個指標的執行緒分片數（超過時多個執行緒共用分片）
+#define METRICS_MAX_BUCKETS 16  // histogram 最多的 bucket 數（不含 +Inf）
+
+typedef enum
+{
+    METRIC_COUNTER,
+    METRIC_GAUGE,
+    METRIC_HISTOGRAM
+} MetricType;
+
+typedef struct Metric Metric;
+
+// 註冊指標；相同 name + labels 重複註冊會回傳同一個指標
+// labels 為 Prometheus 標籤內容，例如 "code=\"200\""，沒有標籤時傳 NULL
+Metric *metrics_counter(const char *name, const char *help, const char *labels);
+Metric *metrics_gauge(const char *name, const char *help, const char *labels);
+
+// bounds 為遞增的 bucket 上限（原始單位），unit 為輸出時的換算倍率
+// 例如以微秒記錄、以秒輸出時 unit = 1e-6
+Metric *metrics_histogram(const char *name, const char *help, const char *labels,
+                          const uint64_t *bounds, int bound_count, double unit);
+
+// 熱路徑更新：只寫入目前執行緒的分片，不上鎖
+void metrics_inc(Metric *metric);
+void metrics_add(Metric *metric, int64_t delta);
+void metrics_observe(Metric *metric, uint64_t value);
+
+// 合併所有分片後的數值（histogram 回傳觀測次數）
+int64_t metrics_value(Metric *metric);
+
+// 產生文字格式輸出，回傳的字串需由呼叫者 free
+char *metrics_render(size_t *length);
+
+// HTTP 伺服器共用的便捷函數
+void metrics_http_request(size_t bytes_received);
+void metrics_http_response(int status_code, size_t bytes_sent);
+
+#endif // METRICS_H
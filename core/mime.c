@@ -0,0 +1,428 @@
+// mime.c - MIME 類型登錄表實現
+//
+// 以 hash-and-displace 建立完美雜湊：副檔名先雜湊到桶，每個桶找一個位移值 d，
+// 讓桶內所有副檔名以 hash(d, ext) 落在互不衝突的槽位。查詢時計算兩次雜湊，
+// 只讀一個槽位並以 strcmp 確認。
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <pthread.h>
+
+#include "mime.h"
+#include "logger.h"
+
+#define MIME_MAX_DISPLACEMENT 65535
+
+typedef struct
+{
+    MimeType *slots;
+    uint32_t slot_mask;
+    uint16_t *displacements;
+    uint32_t bucket_count;
+    char **strings; // 所有 malloc 的字串，釋放用
+    int string_count;
+} MimeTable;
+
+typedef struct
+{
+    char *extension;
+    char *type;
+} MimeMapping;
+
+typedef struct
+{
+    MimeMapping *items;
+    int count;
+    int capacity;
+} MimeList;
+
+static const char *const g_default_types[][2] = {
+    {"html", "text/html"}, {"htm", "text/html"}, {"css", "text/css"}, {"txt", "text/plain"},
+    {"csv", "text/csv"}, {"md", "text/markdown"}, {"xml", "application/xml"}, {"ics", "text/calendar"},
+    {"vtt", "text/vtt"}, {"js", "application/javascript"}, {"mjs", "application/javascript"},
+    {"json", "application/json"}, {"map", "application/json"}, {"webmanifest", "application/manifest+json"},
+    {"xhtml", "application/xhtml+xml"}, {"rss", "application/rss+xml"}, {"atom", "application/atom+xml"},
+    {"wasm", "application/wasm"}, {"pdf", "application/pdf"}, {"zip", "application/zip"},
+    {"gz", "application/gzip"}, {"tar", "application/x-tar"}, {"7z", "application/x-7z-compressed"},
+    {"png", "image/png"}, {"apng", "image/apng"}, {"jpg", "image/jpeg"}, {"jpeg", "image/jpeg"},
+    {"gif", "image/gif"}, {"svg", "image/svg+xml"}, {"ico", "image/x-icon"}, {"webp", "image/webp"},
+    {"avif", "image/avif"}, {"bmp", "image/bmp"}, {"tif", "image/tiff"}, {"tiff", "image/tiff"},
+    {"woff", "font/woff"}, {"woff2", "font/woff2"}, {"ttf", "font/ttf"}, {"otf", "font/otf"},
+    {"eot", "application/vnd.ms-fontobject"}, {"mp4", "video/mp4"}, {"m4v", "video/mp4"},
+    {"webm", "video/webm"}, {"ogv", "video/ogg"}, {"mov", "video/quicktime"}, {"mkv", "video/x-matroska"},
+    {"mp3", "audio/mpeg"}, {"ogg", "audio/ogg"}, {"oga", "audio/ogg"}, {"wav", "audio/wav"},
+    {"m4a", "audio/mp4"}, {"flac", "audio/flac"}, {"aac", "audio/aac"}, {"opus", "audio/opus"}};
+
+static MimeType g_fallback = {NULL, "application/octet-stream",
+                              "Content-Type: application/octet-stream\r\n", 40};
+
+static MimeTable *g_table = NULL;
+static pthread_once_t g_default_once = PTHREAD_ONCE_INIT;
+
+static uint32_t mime_hash(uint32_t seed, const char *key)
+{
+    uint32_t hash = 2166136261u ^ (seed * 0x9e3779b9u);
+    for (const unsigned char *p = (const unsigned char *)key; *p; p++)
+    {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    // 混合高低位元，讓不同 seed 的結果彼此獨立
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+// 複製並轉成小寫，太長或空字串時回傳 0
+static int mime_lower(char *out, const char *extension, size_t len)
+{
+    if (len == 0 || len > MIME_MAX_EXTENSION)
+        return 0;
+    for (size_t i = 0; i < len; i++)
+        out[i] = (char)tolower((unsigned char)extension[i]);
+    out[len] = '\0';
+    return 1;
+}
+
+// 加入對應，相同副檔名以後加入者為準
+static int mime_list_add(MimeList *list, const char *extension, size_t extension_len, const char *type)
+{
+    char lower[MIME_MAX_EXTENSION + 1];
+    if (!mime_lower(lower, extension, extension_len))
+        return 0;
+
+    for (int i = 0; i < list->count; i++)
+    {
+        if (strcmp(list->items[i].extension, lower) == 0)
+        {
+            char *copy = strdup(type);
+            if (!copy)
+                return -1;
+            free(list->items[i].type);
+            list->items[i].type = copy;
+            return 0;
+        }
+    }
+
+    if (list->count == list->capacity)
+    {
+        int capacity = list->capacity ? list->capacity * 2 : 128;
+        MimeMapping *items = realloc(list->items, capacity * sizeof(MimeMapping));
+        if (!items)
+            return -1;
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count].extension = strdup(lower);
+    list->items[list->count].type = strdup(type);
+    if (!list->items[list->count].extension || !list->items[list->count].type)
+    {
+        free(list->items[list->count].extension);
+        free(list->items[list->count].type);
+        return -1;
+    }
+    list->count++;
+    return 0;
+}
+
+static void mime_list_free(MimeList *list)
+{
+    for (int i = 0; i < list->count; i++)
+    {
+        free(list->items[i].extension);
+        free(list->items[i].type);
+    }
+    free(list->items);
+}
+
+static void mime_list_defaults(MimeList *list)
+{
+    for (size_t i = 0; i < sizeof(g_default_types) / sizeof(g_default_types[0]); i++)
+        mime_list_add(list, g_default_types[i][0], strlen(g_default_types[i][0]), g_default_types[i][1]);
+}
+
+static void mime_table_free(MimeTable *table)
+{
+    if (!table)
+        return;
+    for (int i = 0; i < table->string_count; i++)
+        free(table->strings[i]);
+    free(table->strings);
+    free(table->slots);
+    free(table->displacements);
+    free(table);
+}
+
+// 嘗試以 slot_count 個槽位建立完美雜湊，成功時填入 slot_of 並回傳 1
+static int mime_table_place(MimeTable *table, const MimeList *list, uint32_t slot_count, int *slot_of)
+{
+    uint32_t bucket_count = list->count / 4 + 1;
+    int *bucket_start = calloc(bucket_count + 1, sizeof(int));
+    int *members = malloc((list->count + 1) * sizeof(int)); // 依桶排列的副檔名索引
+    uint32_t *bucket_of = malloc((list->count + 1) * sizeof(uint32_t));
+    uint32_t *order = malloc(bucket_count * sizeof(uint32_t));
+    int *fill = malloc(bucket_count * sizeof(int));
+    uint16_t *displacements = calloc(bucket_count, sizeof(uint16_t));
+    char *taken = calloc(slot_count, 1);
+    int ok = bucket_start && members && bucket_of && order && fill && displacements && taken;
+
+    if (ok)
+    {
+        // 計數排序：bucket_start[b]..bucket_start[b + 1] 為桶 b 的成員
+        for (int i = 0; i < list->count; i++)
+        {
+            bucket_of[i] = mime_hash(0, list->items[i].extension) % bucket_count;
+            bucket_start[bucket_of[i] + 1]++;
+        }
+        for (uint32_t b = 0; b < bucket_count; b++)
+            bucket_start[b + 1] += bucket_start[b];
+        for (uint32_t b = 0; b < bucket_count; b++)
+            fill[b] = bucket_start[b];
+        for (int i = 0; i < list->count; i++)
+            members[fill[bucket_of[i]]++] = i;
+
+        // 大的桶先放，越後面空槽位越少
+        for (uint32_t b = 0; b < bucket_count; b++)
+            order[b] = b;
+        for (uint32_t i = 1; i < bucket_count; i++)
+        {
+            uint32_t b = order[i];
+            int size = bucket_start[b + 1] - bucket_start[b];
+            uint32_t j = i;
+            while (j > 0 && bucket_start[order[j - 1] + 1] - bucket_start[order[j - 1]] < size)
+            {
+                order[j] = order[j - 1];
+                j--;
+            }
+            order[j] = b;
+        }
+
+        for (uint32_t n = 0; ok && n < bucket_count; n++)
+        {
+            uint32_t bucket = order[n];
+            int first = bucket_start[bucket];
+            int last = bucket_start[bucket + 1];
+            if (first == last)
+                break;
+
+            int placed = 0;
+            for (uint32_t d = 1; d <= MIME_MAX_DISPLACEMENT && !placed; d++)
+            {
+                placed = 1;
+                for (int m = first; m < last && placed; m++)
+                {
+                    uint32_t slot = mime_hash(d, list->items[members[m]].extension) & (slot_count - 1);
+                    if (taken[slot])
+                        placed = 0;
+                    for (int k = first; k < m && placed; k++)
+                    {
+                        if (slot_of[members[k]] == (int)slot)
+                            placed = 0;
+                    }
+                    slot_of[members[m]] = slot;
+                }
+                if (placed)
+                {
+                    displacements[bucket] = (uint16_t)d;
+                    for (int m = first; m < last; m++)
+                        taken[slot_of[members[m]]] = 1;
+                }
+            }
+            ok = placed;
+        }
+    }
+
+    free(bucket_start);
+    free(members);
+    free(bucket_of);
+    free(order);
+    free(fill);
+    free(taken);
+    if (!ok)
+    {
+        free(displacements);
+        return 0;
+    }
+    table->displacements = displacements;
+    table->bucket_count = bucket_count;
+    table->slot_mask = slot_count - 1;
+    return 1;
+}
+
+static char *mime_table_keep(MimeTable *table, char *string)
+{
+    if (string)
+        table->strings[table->string_count++] = string;
+    return string;
+}
+
+// 文字類型預設為 UTF-8
+static char *mime_format_type(const char *type)
+{
+    int add_charset = strncmp(type, "text/", 5) == 0 && !strstr(type, "charset");
+    size_t len = strlen(type) + (add_charset ? 15 : 0) + 1;
+    char *result = malloc(len);
+    if (result)
+        snprintf(result, len, "%s%s", type, add_charset ? "; charset=utf-8" : "");
+    return result;
+}
+
+static MimeTable *mime_table_build(const MimeList *list)
+{
+    MimeTable *table = calloc(1, sizeof(MimeTable));
+    if (!table)
+        return NULL;
+
+    uint32_t slot_count = 16;
+    while (slot_count < (uint32_t)list->count * 2)
+        slot_count *= 2;
+
+    int *slot_of = malloc((list->count + 1) * sizeof(int));
+    table->strings = malloc((list->count * 3 + 1) * sizeof(char *));
+    if (!slot_of || !table->strings)
+    {
+        free(slot_of);
+        mime_table_free(table);
+        return NULL;
+    }
+
+    while (!mime_table_place(table, list, slot_count, slot_of))
+    {
+        slot_count *= 2;
+        if (slot_count > (1u << 20))
+        {
+            free(slot_of);
+            mime_table_free(table);
+            return NULL;
+        }
+    }
+
+    table->slots = calloc(slot_count, sizeof(MimeType));
+    if (!table->slots)
+    {
+        free(slot_of);
+        mime_table_free(table);
+        return NULL;
+    }
+
+    for (int i = 0; i < list->count; i++)
+    {
+        MimeType *entry = &table->slots[slot_of[i]];
+        char *type = mime_table_keep(table, mime_format_type(list->items[i].type));
+        size_t header_len = type ? strlen(type) + 16 : 0;
+        char *header = mime_table_keep(table, type ? malloc(header_len + 1) : NULL);
+        char *extension = mime_table_keep(table, strdup(list->items[i].extension));
+        if (!type || !header || !extension)
+            continue;
+        snprintf(header, header_len + 1, "Content-Type: %s\r\n", type);
+        entry->extension = extension;
+        entry->type = type;
+        entry->header = header;
+        entry->header_len = header_len;
+    }
+
+    free(slot_of);
+    return table;
+}
+
+static void mime_init_defaults(void)
+{
+    if (__atomic_load_n(&g_table, __ATOMIC_ACQUIRE))
+        return;
+    MimeList list = {0};
+    mime_list_defaults(&list);
+    __atomic_store_n(&g_table, mime_table_build(&list), __ATOMIC_RELEASE);
+    mime_list_free(&list);
+}
+
+int mime_load(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return -1;
+
+    MimeList list = {0};
+    mime_list_defaults(&list);
+
+    char line[1024];
+    while (fgets(line, sizeof(line), file))
+    {
+        char *comment = strchr(line, '#');
+        if (comment)
+            *comment = '\0';
+
+        // 第一個欄位是類型，其餘為副檔名
+        const char *type = NULL;
+        char *p = line;
+        while (*p)
+        {
+            while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n' || *p == ';')
+                p++;
+            if (!*p)
+                break;
+            char *token = p;
+            while (*p && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n' && *p != ';')
+                p++;
+            if (*p)
+                *p++ = '\0';
+
+            if (!type)
+            {
+                if (!strchr(token, '/'))
+                    break;
+                type = token;
+            }
+            else
+            {
+                mime_list_add(&list, token, strlen(token), type);
+            }
+        }
+    }
+    fclose(file);
+
+    MimeTable *table = mime_table_build(&list);
+    int count = list.count;
+    mime_list_free(&list);
+    if (!table)
+        return -1;
+
+    // 只在啟動時呼叫，此時沒有其他執行緒在查詢
+    pthread_once(&g_default_once, mime_init_defaults);
+    MimeTable *old = __atomic_exchange_n(&g_table, table, __ATOMIC_ACQ_REL);
+    mime_table_free(old);
+
+    log_message(LOG_INFO, "Loaded MIME types from %s (%d extensions)", path, count);
+    return count;
+}
+
+const MimeType *mime_lookup(const char *path)
+{
+    MimeTable *table = __atomic_load_n(&g_table, __ATOMIC_ACQUIRE);
+    if (!table)
+    {
+        pthread_once(&g_default_once, mime_init_defaults);
+        table = __atomic_load_n(&g_table, __ATOMIC_ACQUIRE);
+        if (!table)
+            return &g_fallback;
+    }
+
+    const char *dot = strrchr(path, '.');
+    if (!dot || strchr(dot, '/'))
+        return &g_fallback;
+
+    char extension[MIME_MAX_EXTENSION + 1];
+    if (!mime_lower(extension, dot + 1, strlen(dot + 1)))
+        return &g_fallback;
+
+    uint32_t bucket = mime_hash(0, extension) % table->bucket_count;
+    uint32_t slot = mime_hash(table->displacements[bucket], extension) & table->slot_mask;
+    const MimeType *entry = &table->slots[slot];
+    if (entry->extension && strcmp(entry->extension, extension) == 0)
+        return entry;
+    return &g_fallback;
+}
@@ -0,0 +1,25 @@
+// mime.h - 副檔名對應 MIME 類型的登錄表（完美雜湊，查詢只需一次探測）
+#ifndef MIME_H
+#define MIME_H
+
+#include <stddef.h>
+
+#define MIME_MAX_EXTENSION 15 // 更長的副檔名一律視為 application/octet-stream
+
+typedef struct
+{
+    const char *extension; // 小寫、不含 '.'；NULL 表示空槽位
+    const char *type;      // 例如 "text/html; charset=utf-8"
+    const char *header;    // 預先組好的 "Content-Type: ...\r\n"
+    size_t header_len;
+} MimeType;
+
+// 從 mime.types 格式的檔案載入（每行 "類型 副檔名..."，# 開頭為註解），
+// 檔案中的設定覆蓋內建預設值；應在 start_server 之前呼叫
+// 回傳登錄的副檔名數量，無法開啟檔案時回傳 -1（保留原本的表）
+int mime_load(const char *path);
+
+// 依路徑的副檔名（不分大小寫）查詢，找不到時回傳 application/octet-stream
+const MimeType *mime_lookup(const char *path);
+
+#endif // MIME_H
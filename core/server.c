@@ -16,6 +16,18 @@ typedef int socklen_t;
 #include "server.h"
 #include "http_handler.h"
 #include "logger.h"
+#include "metrics.h"
+#include "latency.h"
+
+static Metric *g_connections_total = NULL;
+static Metric *g_connections_active = NULL;
+
+// 交給處理執行緒的連線資訊
+typedef struct
+{
+    int client_socket;
+    uint64_t accept_ns; // accept() 回傳的時間，用於計算排隊延遲
+} ClientTask;
 
 #ifdef _WIN32
 DWORD WINAPI handle_client_thread(LPVOID arg)
@@ -24,10 +36,15 @@ DWORD WINAPI handle_client_thread(LPVOID arg)
 void *handle_client_thread(void *arg)
 {
 #endif
-    int client_socket = *(int *)arg;
-    free(arg);
+    ClientTask *task = (ClientTask *)arg;
+    int client_socket = task->client_socket;
+    latency_begin(task->accept_ns);
+    free(task);
 
+    metrics_add(g_connections_active, 1);
     handle_client(client_socket);
+    latency_finish();
+    metrics_add(g_connections_active, -1);
 
 #ifdef _WIN32
     closesocket(client_socket);
@@ -91,6 +108,9 @@ int start_server(int port)
         return -1;
     }
 
+    g_connections_total = metrics_counter("http_connections_total", "Total accepted connections", NULL);
+    g_connections_active = metrics_gauge("http_connections_active", "Connections currently being handled", NULL);
+
     return server_socket;
 }
 
@@ -102,6 +122,7 @@ void run_server(int server_socket)
     while (1)
     {
         int client_socket = accept(server_socket, (struct sockaddr *)&client_addr, &client_len);
+        uint64_t accept_ns = latency_now();
         if (client_socket < 0)
         {
             log_message(LOG_ERROR, "Failed to accept connection");
@@ -111,17 +132,19 @@ void run_server(int server_socket)
         char client_ip[INET_ADDRSTRLEN];
         inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN);
         log_message(LOG_INFO, "New connection from %s", client_ip);
+        metrics_inc(g_connections_total);
 
         // 建立新執行緒處理客戶端
-        int *client_socket_ptr = malloc(sizeof(int));
-        *client_socket_ptr = client_socket;
+        ClientTask *task = malloc(sizeof(ClientTask));
+        task->client_socket = client_socket;
+        task->accept_ns = accept_ns;
 
 #ifdef _WIN32
-        HANDLE thread = CreateThread(NULL, 0, handle_client_thread, client_socket_ptr, 0, NULL);
+        HANDLE thread = CreateThread(NULL, 0, handle_client_thread, task, 0, NULL);
         if (thread == NULL)
         {
             log_message(LOG_ERROR, "Failed to create thread");
-            free(client_socket_ptr);
+            free(task);
             closesocket(client_socket);
         }
         else
@@ -130,10 +153,10 @@ void run_server(int server_socket)
         }
 #else
         pthread_t thread;
-        if (pthread_create(&thread, NULL, handle_client_thread, client_socket_ptr) != 0)
+        if (pthread_create(&thread, NULL, handle_client_thread, task) != 0)
         {
             log_message(LOG_ERROR, "Failed to create thread");
-            free(client_socket_ptr);
+            free(task);
             close(client_socket);
         }
         else
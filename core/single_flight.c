@@ -0,0 +1,138 @@
+// single_flight.c - 並行載入合併實現
+//
+// 熱門檔案剛失效（或冷啟動）時，同時到達的數百個請求都會未命中，各自開檔、讀取、壓縮，
+// 最後只有一份結果留在快取中。這裡讓每個鍵同時只有一個載入者，其餘請求等它完成後從快取取得結果。
+// 進行中的載入以分片雜湊表記錄，每個分片一把鎖與一個條件變數；載入通常只需數百微秒，
+// 等待者被喚醒後只重查一次快取，不會排成第二輪等待。
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "single_flight.h"
+#include "metrics.h"
+
+struct SingleFlightCall
+{
+    char *key;
+    uint32_t hash;
+    int done;
+    int refcount; // 載入者與等待者各持有一個
+    struct SingleFlightCall *next;
+};
+
+typedef struct
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    SingleFlightCall *calls; // 進行中的載入（通常只有幾個）
+} SingleFlightShard;
+
+struct SingleFlight
+{
+    SingleFlightShard shards[SINGLE_FLIGHT_SHARDS];
+    Metric *loads;
+    Metric *waits;
+};
+
+static uint32_t single_flight_hash(const char *key)
+{
+    uint32_t hash = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)key; *p; p++)
+    {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+SingleFlight *single_flight_create(const char *name)
+{
+    SingleFlight *group = calloc(1, sizeof(SingleFlight));
+    if (!group)
+        return NULL;
+    for (int i = 0; i < SINGLE_FLIGHT_SHARDS; i++)
+    {
+        pthread_mutex_init(&group->shards[i].mutex, NULL);
+        pthread_cond_init(&group->shards[i].cond, NULL);
+    }
+
+    char labels[128];
+    snprintf(labels, sizeof(labels), "group=\"%s\"", name);
+    group->loads = metrics_counter("single_flight_loads_total", "Loads started after a cache miss", labels);
+    group->waits = metrics_counter("single_flight_waits_total",
+                                   "Cache misses that waited for a concurrent load instead of loading", labels);
+    return group;
+}
+
+static void single_flight_unref(SingleFlightCall *call)
+{
+    if (--call->refcount == 0)
+    {
+        free(call->key);
+        free(call);
+    }
+}
+
+SingleFlightCall *single_flight_begin(SingleFlight *group, const char *key)
+{
+    if (!group)
+        return NULL;
+
+    uint32_t hash = single_flight_hash(key);
+    SingleFlightShard *shard = &group->shards[hash & (SINGLE_FLIGHT_SHARDS - 1)];
+
+    pthread_mutex_lock(&shard->mutex);
+    SingleFlightCall *call = shard->calls;
+    while (call && (call->hash != hash || strcmp(call->key, key) != 0))
+        call = call->next;
+
+    if (call)
+    {
+        call->refcount++;
+        metrics_inc(group->waits);
+        while (!call->done)
+            pthread_cond_wait(&shard->cond, &shard->mutex);
+        single_flight_unref(call);
+        pthread_mutex_unlock(&shard->mutex);
+        return NULL;
+    }
+
+    call = malloc(sizeof(SingleFlightCall));
+    if (call && !(call->key = strdup(key)))
+    {
+        free(call);
+        call = NULL;
+    }
+    if (call)
+    {
+        call->hash = hash;
+        call->done = 0;
+        call->refcount = 1;
+        call->next = shard->calls;
+        shard->calls = call;
+        metrics_inc(group->loads);
+    }
+    pthread_mutex_unlock(&shard->mutex);
+    return call;
+}
+
+void single_flight_end(SingleFlight *group, SingleFlightCall *call)
+{
+    if (!group || !call)
+        return;
+
+    SingleFlightShard *shard = &group->shards[call->hash & (SINGLE_FLIGHT_SHARDS - 1)];
+    pthread_mutex_lock(&shard->mutex);
+    SingleFlightCall **link = &shard->calls;
+    while (*link != call)
+        link = &(*link)->next;
+    *link = call->next;
+    call->done = 1;
+
+    // 分片內所有等待者共用一個條件變數，各自檢查自己等待的 done
+    pthread_cond_broadcast(&shard->cond);
+    single_flight_unref(call);
+    pthread_mutex_unlock(&shard->mutex);
+}
@@ -0,0 +1,19 @@
+// single_flight.h - 合併同一個鍵的並行載入：第一個未命中的請求負責載入，其餘等待它完成後重查快取
+#ifndef SINGLE_FLIGHT_H
+#define SINGLE_FLIGHT_H
+
+#define SINGLE_FLIGHT_SHARDS 16
+
+typedef struct SingleFlight SingleFlight;
+typedef struct SingleFlightCall SingleFlightCall;
+
+// name 作為指標標籤（例如 "static"）
+SingleFlight *single_flight_create(const char *name);
+
+// 開始載入 key：沒有其他執行緒在載入時回傳非 NULL，呼叫者負責載入並在完成後（無論成敗）
+// 呼叫 single_flight_end；已有執行緒在載入時等待它完成並回傳 NULL，呼叫者應重查快取，
+// 仍未命中（載入失敗或結果已失效）時自行載入，不再等待。記憶體不足時也回傳 NULL
+SingleFlightCall *single_flight_begin(SingleFlight *group, const char *key);
+void single_flight_end(SingleFlight *group, SingleFlightCall *call);
+
+#endif // SINGLE_FLIGHT_H
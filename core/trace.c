@@ -0,0 +1,232 @@
+// trace.c - 請求追蹤環形緩衝區與 Chrome trace-event 匯出
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <pthread.h>
+
+#include "trace.h"
+
+int g_trace_enabled = 0;
+
+// 一筆請求紀錄；seq 為 0 表示正在寫入，讀取端用它偵測被覆寫的紀錄
+typedef struct
+{
+    uint64_t seq;
+    const char *label;
+    uint64_t marks[LAT_POINT_COUNT];
+} TraceRecord;
+
+// 環形緩衝區只有擁有它的執行緒會寫入；執行緒結束後交給下一個執行緒沿用
+typedef struct
+{
+    TraceRecord records[TRACE_RING_SIZE];
+    uint64_t head; // 已寫入的紀錄總數
+    int id;
+    int in_use;
+} TraceRing;
+
+static TraceRing *g_rings[TRACE_MAX_RINGS];
+static int g_ring_count = 0;
+static pthread_mutex_t g_rings_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t g_ring_key;
+static pthread_once_t g_ring_key_once = PTHREAD_ONCE_INIT;
+static uint64_t g_trace_since = 0; // 最近一次開啟追蹤的時間
+static uint64_t g_trace_dropped = 0;
+
+static __thread TraceRing *tls_ring;
+
+// 每對相鄰時間點之間的區段名稱（與 latency.c 的階段一致）
+static const char *g_point_names[LAT_POINT_COUNT] = {
+    "accept", "first_byte", "parsed", "routed", "handled", "sent"};
+static const char *g_span_names[LAT_POINT_COUNT] = {
+    NULL, "queue", "parse", "route", "handler", "send"};
+
+static void trace_release_ring(void *arg)
+{
+    TraceRing *ring = arg;
+    pthread_mutex_lock(&g_rings_mutex);
+    ring->in_use = 0;
+    pthread_mutex_unlock(&g_rings_mutex);
+}
+
+static void trace_create_key(void)
+{
+    pthread_key_create(&g_ring_key, trace_release_ring);
+}
+
+static TraceRing *trace_acquire_ring(void)
+{
+    pthread_once(&g_ring_key_once, trace_create_key);
+
+    TraceRing *ring = NULL;
+    pthread_mutex_lock(&g_rings_mutex);
+    for (int i = 0; i < g_ring_count; i++)
+    {
+        if (!g_rings[i]->in_use)
+        {
+            ring = g_rings[i];
+            break;
+        }
+    }
+    if (!ring && g_ring_count < TRACE_MAX_RINGS)
+    {
+        ring = calloc(1, sizeof(TraceRing));
+        if (ring)
+        {
+            ring->id = g_ring_count;
+            __atomic_store_n(&g_rings[g_ring_count], ring, __ATOMIC_RELEASE);
+            g_ring_count++;
+        }
+    }
+    if (ring)
+        ring->in_use = 1;
+    pthread_mutex_unlock(&g_rings_mutex);
+
+    if (ring)
+        pthread_setspecific(g_ring_key, ring);
+    return ring;
+}
+
+void trace_set_enabled(int enabled)
+{
+    if (enabled)
+        __atomic_store_n(&g_trace_since, latency_now(), __ATOMIC_RELAXED);
+    __atomic_store_n(&g_trace_enabled, enabled ? 1 : 0, __ATOMIC_RELAXED);
+}
+
+void trace_record_request(const char *label, const uint64_t marks[LAT_POINT_COUNT])
+{
+    TraceRing *ring = tls_ring;
+    if (!ring)
+    {
+        ring = tls_ring = trace_acquire_ring();
+        if (!ring)
+        {
+            __atomic_fetch_add(&g_trace_dropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+    }
+
+    uint64_t head = ring->head;
+    TraceRecord *rec = &ring->records[head & (TRACE_RING_SIZE - 1)];
+
+    __atomic_store_n(&rec->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    rec->label = label;
+    memcpy(rec->marks, marks, sizeof(rec->marks));
+    __atomic_store_n(&rec->seq, head + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+// ---- 匯出 ----
+
+typedef struct
+{
+    char *data;
+    size_t size;
+    size_t capacity;
+} TraceBuffer;
+
+static void trace_appendf(TraceBuffer *buf, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int needed = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+
+    if (needed < 0)
+        return;
+
+    if (buf->size + needed + 1 > buf->capacity)
+    {
+        size_t capacity = buf->capacity ? buf->capacity : 65536;
+        while (buf->size + needed + 1 > capacity)
+            capacity *= 2;
+        char *data = realloc(buf->data, capacity);
+        if (!data)
+            return;
+        buf->data = data;
+        buf->capacity = capacity;
+    }
+
+    va_start(args, format);
+    vsnprintf(buf->data + buf->size, buf->capacity - buf->size, format, args);
+    va_end(args);
+    buf->size += needed;
+}
+
+// 以 "X"（complete）事件輸出整個請求，以及每對相鄰、且都有標記的時間點之間的區段
+static void trace_append_request(TraceBuffer *buf, int tid, const TraceRecord *rec)
+{
+    uint64_t start = rec->marks[LAT_ACCEPT];
+    uint64_t end = rec->marks[LAT_SENT];
+    const char *label = rec->label ? rec->label : "request";
+
+    trace_appendf(buf,
+                  ",\n{\"name\":\"%s\",\"cat\":\"request\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                  "\"ts\":%.3f,\"dur\":%.3f}",
+                  label, tid, start / 1000.0, (end - start) / 1000.0);
+
+    int prev = LAT_ACCEPT;
+    for (int i = LAT_FIRST_BYTE; i < LAT_POINT_COUNT; i++)
+    {
+        if (!rec->marks[i] || rec->marks[i] < rec->marks[prev])
+            continue;
+        trace_appendf(buf,
+                      ",\n{\"name\":\"%s\",\"cat\":\"stage\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                      "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"from\":\"%s\",\"to\":\"%s\"}}",
+                      g_span_names[i], tid, rec->marks[prev] / 1000.0,
+                      (rec->marks[i] - rec->marks[prev]) / 1000.0,
+                      g_point_names[prev], g_point_names[i]);
+        prev = i;
+    }
+}
+
+char *trace_export_json(void)
+{
+    TraceBuffer buf = {0};
+    uint64_t since = __atomic_load_n(&g_trace_since, __ATOMIC_RELAXED);
+
+    trace_appendf(&buf, "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"enabled\":%s,\"dropped\":%llu},"
+                        "\"traceEvents\":[\n"
+                        "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"c-web-server\"}}",
+                  trace_enabled() ? "true" : "false",
+                  (unsigned long long)__atomic_load_n(&g_trace_dropped, __ATOMIC_RELAXED));
+
+    pthread_mutex_lock(&g_rings_mutex);
+    int ring_count = g_ring_count;
+    pthread_mutex_unlock(&g_rings_mutex);
+
+    for (int r = 0; r < ring_count; r++)
+    {
+        TraceRing *ring = __atomic_load_n(&g_rings[r], __ATOMIC_ACQUIRE);
+        trace_appendf(&buf, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                            "\"args\":{\"name\":\"worker-%d\"}}",
+                      ring->id, ring->id);
+
+        uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        uint64_t first = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+        for (uint64_t n = first; n < head; n++)
+        {
+            const TraceRecord *slot = &ring->records[n & (TRACE_RING_SIZE - 1)];
+            TraceRecord copy;
+
+            // 讀取期間被寫入端覆寫的紀錄直接略過
+            uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+            if (seq != n + 1)
+                continue;
+            memcpy(&copy, slot, sizeof(copy));
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq)
+                continue;
+
+            if (copy.marks[LAT_ACCEPT] < since || copy.marks[LAT_SENT] < copy.marks[LAT_ACCEPT])
+                continue;
+            trace_append_request(&buf, ring->id, &copy);
+        }
+    }
+
+    trace_appendf(&buf, "\n]}\n");
+    return buf.data;
+}
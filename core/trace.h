@@ -0,0 +1,29 @@
+// trace.h - 請求生命週期追蹤：每個執行緒一個環形緩衝區，輸出 Chrome trace-event JSON
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include "latency.h"
+
+#define TRACE_RING_SIZE 2048 // 每個環形緩衝區保留的請求數（需為 2 的冪次）
+#define TRACE_MAX_RINGS 64   // 最多同時追蹤的執行緒數，超過者的請求不記錄
+
+extern int g_trace_enabled;
+
+// 關閉時只有這一次讀取與分支的成本
+static inline int trace_enabled(void)
+{
+    return __atomic_load_n(&g_trace_enabled, __ATOMIC_RELAXED);
+}
+
+// 開啟時會捨棄先前的紀錄，匯出內容只包含這次開啟之後完成的請求
+void trace_set_enabled(int enabled);
+
+// 記錄一個已完成的請求（由 latency_finish 呼叫），沒有標記的時間點為 0
+void trace_record_request(const char *label, const uint64_t marks[LAT_POINT_COUNT]);
+
+// 匯出所有環形緩衝區內容為 Chrome trace-event JSON（需由呼叫者 free）
+// 可直接載入 chrome://tracing 或 https://ui.perfetto.dev
+char *trace_export_json(void);
+
+#endif // TRACE_H
@@ -1,5 +1,6 @@
 // forward_cli.c - Port Forwarding CLI 界面
 #include "port_forward.h"
+#include "admin.h"
 #include <signal.h>
 #include <ctype.h>
 
@@ -38,6 +39,8 @@ void show_help()
     printf("      - Save rules to config file\n");
     printf("  load [filename]\n");
     printf("      - Load rules from config file\n");
+    printf("  metrics <port> [bind_address]\n");
+    printf("      - Serve Prometheus metrics on the given port (default 127.0.0.1)\n");
     printf("  help\n");
     printf("      - Show this help message\n");
     printf("  quit/exit\n");
@@ -196,6 +199,25 @@ void process_command(char *input)
             printf("Failed to load configuration\n");
         }
     }
+    else if (strcmp(command, "metrics") == 0)
+    {
+        if (args >= 2)
+        {
+            int port = atoi(arg1);
+            if (admin_start(args >= 3 ? arg2 : NULL, port) == 0)
+            {
+                printf("Metrics available at http://localhost:%d/metrics\n", port);
+            }
+            else
+            {
+                printf("Failed to start metrics endpoint on port %d\n", port);
+            }
+        }
+        else
+        {
+            printf("Usage: metrics <port> [bind_address]\n");
+        }
+    }
     else if (strcmp(command, "help") == 0)
     {
         show_help();
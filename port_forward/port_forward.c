@@ -1,9 +1,13 @@
 // port_forward.c - Port Forwarding 功能實現
 #include "port_forward.h"
 #include "logger.h"
+#include "metrics.h"
 
 // 全局變數
 static int g_logger_initialized = 0;
+static Metric *g_conn_total = NULL;
+static Metric *g_conn_active = NULL;
+static Metric *g_connect_failures = NULL;
 
 // 前向聲明所有內部函數
 static void *handle_forward_connection(void *arg);
@@ -39,6 +43,10 @@ ForwardManager *forward_manager_init(void)
     manager->running = false;
     pthread_mutex_init(&manager->rules_mutex, NULL);
 
+    g_conn_total = metrics_counter("forward_connections_total", "Total forwarded connections accepted", NULL);
+    g_conn_active = metrics_gauge("forward_connections_active", "Forwarded connections currently open", NULL);
+    g_connect_failures = metrics_counter("forward_connect_failures_total", "Failed connections to forward targets", NULL);
+
     log_info("Port forwarding manager initialized");
     return manager;
 }
@@ -206,6 +214,10 @@ static void *pipe_data(void *arg)
     char buffer[FORWARD_BUFFER_SIZE];
     int bytes_read;
 
+    char labels[64];
+    snprintf(labels, sizeof(labels), "direction=\"%s\"", pipe->direction);
+    Metric *bytes_metric = metrics_counter("forward_bytes_total", "Bytes forwarded per direction", labels);
+
     while ((bytes_read = recv(pipe->from_socket, buffer, sizeof(buffer), 0)) > 0)
     {
         int total_sent = 0;
@@ -220,6 +232,7 @@ static void *pipe_data(void *arg)
             }
             total_sent += sent;
         }
+        metrics_add(bytes_metric, bytes_read);
         log_debug("Forwarded %d bytes %s", bytes_read, pipe->direction);
     }
 
@@ -249,12 +262,14 @@ static void *handle_forward_connection(void *arg)
     {
         log_error("Failed to connect to target for rule: %s",
                   conn->rule->description);
+        metrics_inc(g_connect_failures);
         close(conn->client_socket);
         free(conn);
         return NULL;
     }
 
     log_info("Established forward connection: %s", conn->rule->description);
+    metrics_add(g_conn_active, 1);
 
     // 創建雙向數據管道
     PipeData *client_to_target = (PipeData *)malloc(sizeof(PipeData));
@@ -280,6 +295,7 @@ static void *handle_forward_connection(void *arg)
     close(conn->client_socket);
     close(conn->target_socket);
     free(conn);
+    metrics_add(g_conn_active, -1);
 
     log_info("Forward connection closed");
     return NULL;
@@ -365,6 +381,8 @@ static void *forward_listener_thread(void *arg)
                  rule->listen_port,
                  inet_ntoa(client_addr.sin_addr));
 
+        metrics_inc(g_conn_total);
+
         // 創建連接處理結構
         ForwardConnection *conn = (ForwardConnection *)malloc(sizeof(ForwardConnection));
         conn->client_socket = client_sock;
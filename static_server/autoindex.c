@@ -0,0 +1,535 @@
+// autoindex.c - 目錄列表實現
+//
+// 目錄只在第一次請求或 inotify 通知變更後掃描一次，排序後的結果以參考計數共用，
+// 之後的請求（含分頁）只需要產生輸出。掃描在鎖外進行，期間若有失效通知
+// （generation 改變）就不放入快取，避免留下過期的列表。
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "autoindex.h"
+#include "../core/file_utils.h"
+#include "../core/http_utils.h"
+#include "../core/metrics.h"
+
+typedef struct AutoindexDir
+{
+    char *path;
+    uint32_t hash;
+    AutoindexListing *listing;
+    struct AutoindexDir *next;
+} AutoindexDir;
+
+struct AutoindexCache
+{
+    pthread_mutex_t mutex;
+    AutoindexDir *buckets[AUTOINDEX_BUCKETS];
+    int count;
+    int max_dirs;
+    uint64_t generation;
+    Metric *scans;
+    Metric *hits;
+};
+
+static uint32_t autoindex_hash(const char *path, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= (unsigned char)path[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+AutoindexCache *autoindex_create(int max_dirs)
+{
+    AutoindexCache *cache = calloc(1, sizeof(AutoindexCache));
+    if (!cache)
+        return NULL;
+    pthread_mutex_init(&cache->mutex, NULL);
+    cache->max_dirs = max_dirs > 0 ? max_dirs : AUTOINDEX_DEFAULT_MAX_DIRS;
+    cache->scans = metrics_counter("static_autoindex_scans_total", "Directories scanned for autoindex listings", NULL);
+    cache->hits = metrics_counter("static_autoindex_hits_total", "Autoindex listings served from the cache", NULL);
+    return cache;
+}
+
+void autoindex_release(AutoindexListing *listing)
+{
+    if (!listing || __atomic_sub_fetch(&listing->refcount, 1, __ATOMIC_ACQ_REL) != 0)
+        return;
+    free(listing->entries);
+    free(listing->names);
+    free(listing);
+}
+
+static int autoindex_compare(const void *a, const void *b)
+{
+    const AutoindexEntry *x = a;
+    const AutoindexEntry *y = b;
+    if (x->is_dir != y->is_dir)
+        return y->is_dir - x->is_dir;
+    return strcmp(x->name, y->name);
+}
+
+// 加入一個項目；名稱先以位移量記錄，掃描結束後再換成指標（names 可能被 realloc）
+static int autoindex_add(AutoindexListing *listing, int *capacity, size_t *names_len, size_t *names_capacity,
+                         const char *name, const struct stat *st)
+{
+    if (listing->count == *capacity)
+    {
+        int new_capacity = *capacity ? *capacity * 2 : 64;
+        AutoindexEntry *entries = realloc(listing->entries, new_capacity * sizeof(AutoindexEntry));
+        if (!entries)
+            return -1;
+        listing->entries = entries;
+        *capacity = new_capacity;
+    }
+
+    size_t name_len = strlen(name) + 1;
+    if (*names_len + name_len > *names_capacity)
+    {
+        size_t new_capacity = *names_capacity ? *names_capacity * 2 : 4096;
+        while (new_capacity < *names_len + name_len)
+            new_capacity *= 2;
+        char *names = realloc(listing->names, new_capacity);
+        if (!names)
+            return -1;
+        listing->names = names;
+        *names_capacity = new_capacity;
+    }
+    memcpy(listing->names + *names_len, name, name_len);
+
+    AutoindexEntry *entry = &listing->entries[listing->count++];
+    entry->name = (const char *)(uintptr_t)*names_len;
+    entry->is_dir = S_ISDIR(st->st_mode);
+    entry->size = entry->is_dir ? 0 : (long long)st->st_size;
+    entry->mtime = (long long)st->st_mtime;
+    *names_len += name_len;
+    return 0;
+}
+
+#ifndef _WIN32
+static int autoindex_open(int root_fd, const char *dir_path, size_t root_len)
+{
+    if (root_fd < 0)
+        return open_directory(dir_path);
+    const char *relative = dir_path + root_len;
+    while (*relative == '/')
+        relative++;
+    return open_directory_beneath(root_fd, relative);
+}
+#endif
+
+int autoindex_is_directory(int root_fd, const char *dir_path, size_t root_len)
+{
+#ifdef _WIN32
+    (void)root_fd;
+    (void)root_len;
+    struct stat st;
+    return stat(dir_path, &st) == 0 && S_ISDIR(st.st_mode);
+#else
+    int fd = autoindex_open(root_fd, dir_path, root_len);
+    if (fd < 0)
+        return 0;
+    close(fd);
+    return 1;
+#endif
+}
+
+// 讀取目錄內容；略過隱藏檔以及不是一般檔案或目錄的項目
+static AutoindexListing *autoindex_scan(int root_fd, const char *dir_path, size_t root_len)
+{
+    DIR *dir;
+#ifdef _WIN32
+    (void)root_fd;
+    (void)root_len;
+    dir = opendir(dir_path);
+#else
+    int fd = autoindex_open(root_fd, dir_path, root_len);
+    if (fd < 0)
+        return NULL;
+    dir = fdopendir(fd);
+    if (!dir)
+        close(fd);
+#endif
+    if (!dir)
+        return NULL;
+
+    AutoindexListing *listing = calloc(1, sizeof(AutoindexListing));
+    if (!listing)
+    {
+        closedir(dir);
+        return NULL;
+    }
+    listing->refcount = 1;
+
+    int capacity = 0;
+    size_t names_len = 0;
+    size_t names_capacity = 0;
+    int failed = 0;
+    struct dirent *item;
+    while (!failed && (item = readdir(dir)) != NULL)
+    {
+        if (item->d_name[0] == '.')
+            continue;
+
+        struct stat st;
+#ifdef _WIN32
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s", dir_path, item->d_name);
+        if (stat(path, &st) != 0)
+            continue;
+#else
+        if (fstatat(dirfd(dir), item->d_name, &st, 0) != 0)
+            continue;
+#endif
+        if (!S_ISDIR(st.st_mode) && !S_ISREG(st.st_mode))
+            continue;
+        failed = autoindex_add(listing, &capacity, &names_len, &names_capacity, item->d_name, &st) != 0;
+    }
+    closedir(dir);
+
+    if (failed)
+    {
+        autoindex_release(listing);
+        return NULL;
+    }
+    for (int i = 0; i < listing->count; i++)
+        listing->entries[i].name = listing->names + (uintptr_t)listing->entries[i].name;
+    qsort(listing->entries, listing->count, sizeof(AutoindexEntry), autoindex_compare);
+    return listing;
+}
+
+static void autoindex_clear(AutoindexCache *cache)
+{
+    for (int b = 0; b < AUTOINDEX_BUCKETS; b++)
+    {
+        AutoindexDir *dir = cache->buckets[b];
+        while (dir)
+        {
+            AutoindexDir *next = dir->next;
+            autoindex_release(dir->listing);
+            free(dir->path);
+            free(dir);
+            dir = next;
+        }
+        cache->buckets[b] = NULL;
+    }
+    cache->count = 0;
+}
+
+static AutoindexDir *autoindex_find(AutoindexCache *cache, uint32_t hash, const char *path)
+{
+    AutoindexDir *dir = cache->buckets[hash % AUTOINDEX_BUCKETS];
+    while (dir && (dir->hash != hash || strcmp(dir->path, path) != 0))
+        dir = dir->next;
+    return dir;
+}
+
+AutoindexListing *autoindex_get(AutoindexCache *cache, int root_fd, const char *dir_path, size_t root_len)
+{
+    if (!cache)
+        return autoindex_scan(root_fd, dir_path, root_len);
+
+    uint32_t hash = autoindex_hash(dir_path, strlen(dir_path));
+    pthread_mutex_lock(&cache->mutex);
+    AutoindexDir *dir = autoindex_find(cache, hash, dir_path);
+    if (dir)
+    {
+        AutoindexListing *listing = dir->listing;
+        __atomic_add_fetch(&listing->refcount, 1, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&cache->mutex);
+        metrics_inc(cache->hits);
+        return listing;
+    }
+    uint64_t generation = cache->generation;
+    pthread_mutex_unlock(&cache->mutex);
+
+    // 大目錄的掃描可能需要一段時間，不持有鎖
+    AutoindexListing *listing = autoindex_scan(root_fd, dir_path, root_len);
+    if (!listing)
+        return NULL;
+    metrics_inc(cache->scans);
+
+    pthread_mutex_lock(&cache->mutex);
+    if (cache->generation == generation && !autoindex_find(cache, hash, dir_path))
+    {
+        if (cache->count >= cache->max_dirs)
+            autoindex_clear(cache);
+        dir = malloc(sizeof(AutoindexDir));
+        if (dir && (dir->path = strdup(dir_path)) != NULL)
+        {
+            dir->hash = hash;
+            dir->listing = listing;
+            listing->refcount++;
+            dir->next = cache->buckets[hash % AUTOINDEX_BUCKETS];
+            cache->buckets[hash % AUTOINDEX_BUCKETS] = dir;
+            cache->count++;
+        }
+        else
+        {
+            free(dir);
+        }
+    }
+    pthread_mutex_unlock(&cache->mutex);
+    return listing;
+}
+
+static void autoindex_remove(AutoindexCache *cache, const char *path, size_t len, int is_prefix)
+{
+    for (int b = 0; b < AUTOINDEX_BUCKETS; b++)
+    {
+        AutoindexDir **link = &cache->buckets[b];
+        while (*link)
+        {
+            AutoindexDir *dir = *link;
+            int match = strncmp(dir->path, path, len) == 0 &&
+                        (dir->path[len] == '\0' || (is_prefix && dir->path[len] == '/'));
+            if (match)
+            {
+                *link = dir->next;
+                autoindex_release(dir->listing);
+                free(dir->path);
+                free(dir);
+                cache->count--;
+            }
+            else
+            {
+                link = &dir->next;
+            }
+        }
+    }
+}
+
+void autoindex_invalidate(AutoindexCache *cache, const char *path, int is_prefix)
+{
+    if (!cache)
+        return;
+
+    pthread_mutex_lock(&cache->mutex);
+    cache->generation++;
+    if (cache->count > 0)
+    {
+        // 新增、刪除或修改檔案都會改變所在目錄的列表（名稱、大小或修改時間）
+        const char *slash = strrchr(path, '/');
+        if (slash && slash > path)
+            autoindex_remove(cache, path, slash - path, 0);
+        if (is_prefix)
+            autoindex_remove(cache, path, strlen(path), 1);
+    }
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+// 輸出用的可成長緩衝區，配置失敗後忽略後續內容
+typedef struct
+{
+    char *data;
+    size_t len;
+    size_t capacity;
+    int failed;
+} AutoindexBuffer;
+
+static void buffer_append(AutoindexBuffer *buffer, const char *data, size_t len)
+{
+    if (buffer->failed)
+        return;
+    if (buffer->len + len + 1 > buffer->capacity)
+    {
+        size_t capacity = buffer->capacity ? buffer->capacity * 2 : 8192;
+        while (capacity < buffer->len + len + 1)
+            capacity *= 2;
+        char *data_new = realloc(buffer->data, capacity);
+        if (!data_new)
+        {
+            buffer->failed = 1;
+            return;
+        }
+        buffer->data = data_new;
+        buffer->capacity = capacity;
+    }
+    memcpy(buffer->data + buffer->len, data, len);
+    buffer->len += len;
+    buffer->data[buffer->len] = '\0';
+}
+
+static void buffer_puts(AutoindexBuffer *buffer, const char *text)
+{
+    buffer_append(buffer, text, strlen(text));
+}
+
+static void buffer_printf(AutoindexBuffer *buffer, const char *format, ...)
+{
+    char text[256];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (len > 0)
+        buffer_append(buffer, text, len < (int)sizeof(text) ? (size_t)len : sizeof(text) - 1);
+}
+
+static void buffer_html(AutoindexBuffer *buffer, const char *text)
+{
+    for (const char *p = text; *p; p++)
+    {
+        switch (*p)
+        {
+        case '<':
+            buffer_puts(buffer, "&lt;");
+            break;
+        case '>':
+            buffer_puts(buffer, "&gt;");
+            break;
+        case '&':
+            buffer_puts(buffer, "&amp;");
+            break;
+        case '"':
+            buffer_puts(buffer, "&quot;");
+            break;
+        case '\'':
+            buffer_puts(buffer, "&#39;");
+            break;
+        default:
+            buffer_append(buffer, p, 1);
+        }
+    }
+}
+
+// 連結中的名稱：保留非保留字元，其餘（含 UTF-8 位元組）以 %XX 表示
+static void buffer_url(AutoindexBuffer *buffer, const char *text)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    for (const unsigned char *p = (const unsigned char *)text; *p; p++)
+    {
+        if ((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z') || (*p >= '0' && *p <= '9') || *p == '-' ||
+            *p == '_' || *p == '.' || *p == '~')
+        {
+            buffer_append(buffer, (const char *)p, 1);
+        }
+        else
+        {
+            char escaped[3] = {'%', hex[*p >> 4], hex[*p & 0xf]};
+            buffer_append(buffer, escaped, 3);
+        }
+    }
+}
+
+static void buffer_json(AutoindexBuffer *buffer, const char *text)
+{
+    buffer_puts(buffer, "\"");
+    for (const unsigned char *p = (const unsigned char *)text; *p; p++)
+    {
+        if (*p == '"' || *p == '\\')
+        {
+            char escaped[2] = {'\\', (char)*p};
+            buffer_append(buffer, escaped, 2);
+        }
+        else if (*p < 0x20)
+        {
+            buffer_printf(buffer, "\\u%04x", *p);
+        }
+        else
+        {
+            buffer_append(buffer, (const char *)p, 1);
+        }
+    }
+    buffer_puts(buffer, "\"");
+}
+
+static void render_json(AutoindexBuffer *buffer, const AutoindexListing *listing, const char *url_path, int offset,
+                        int end, int limit)
+{
+    buffer_puts(buffer, "{\"path\":");
+    buffer_json(buffer, url_path);
+    buffer_printf(buffer, ",\"total\":%d,\"offset\":%d,\"limit\":%d,\"entries\":[", listing->count, offset, limit);
+    for (int i = offset; i < end; i++)
+    {
+        const AutoindexEntry *entry = &listing->entries[i];
+        buffer_puts(buffer, i > offset ? ",{\"name\":" : "{\"name\":");
+        buffer_json(buffer, entry->name);
+        buffer_printf(buffer, ",\"type\":\"%s\",\"size\":%lld,\"mtime\":%lld}", entry->is_dir ? "directory" : "file",
+                      entry->size, entry->mtime);
+    }
+    buffer_puts(buffer, "]}");
+}
+
+static void render_html(AutoindexBuffer *buffer, const AutoindexListing *listing, const char *url_path, int offset,
+                        int end, int limit)
+{
+    buffer_puts(buffer, "<!DOCTYPE html>\n<html>\n<head>\n<meta charset=\"utf-8\">\n<title>Index of ");
+    buffer_html(buffer, url_path);
+    buffer_puts(buffer, "</title>\n</head>\n<body>\n<h1>Index of ");
+    buffer_html(buffer, url_path);
+    buffer_puts(buffer, "</h1>\n<table>\n<tr><th>Name</th><th>Size</th><th>Last modified</th></tr>\n");
+    if (strcmp(url_path, "/") != 0)
+        buffer_puts(buffer, "<tr><td><a href=\"../\">../</a></td><td></td><td></td></tr>\n");
+
+    for (int i = offset; i < end; i++)
+    {
+        const AutoindexEntry *entry = &listing->entries[i];
+        const char *suffix = entry->is_dir ? "/" : "";
+        char date[64];
+        http_format_date(date, sizeof(date), entry->mtime);
+
+        buffer_puts(buffer, "<tr><td><a href=\"");
+        buffer_url(buffer, entry->name);
+        buffer_puts(buffer, suffix);
+        buffer_puts(buffer, "\">");
+        buffer_html(buffer, entry->name);
+        buffer_puts(buffer, suffix);
+        if (entry->is_dir)
+            buffer_printf(buffer, "</a></td><td>-</td><td>%s</td></tr>\n", date);
+        else
+            buffer_printf(buffer, "</a></td><td>%lld</td><td>%s</td></tr>\n", entry->size, date);
+    }
+    buffer_puts(buffer, "</table>\n");
+
+    // 超過一頁時加上分頁連結（頁碼從 1 開始）
+    if (listing->count > limit)
+    {
+        int page = offset / limit + 1;
+        buffer_printf(buffer, "<p>%d-%d of %d", listing->count ? offset + 1 : 0, end, listing->count);
+        if (page > 1)
+            buffer_printf(buffer, " <a href=\"?page=%d&amp;limit=%d\">Previous</a>", page - 1, limit);
+        if (end < listing->count)
+            buffer_printf(buffer, " <a href=\"?page=%d&amp;limit=%d\">Next</a>", page + 1, limit);
+        buffer_puts(buffer, "</p>\n");
+    }
+    buffer_puts(buffer, "</body>\n</html>\n");
+}
+
+char *autoindex_render(const AutoindexListing *listing, const char *url_path, int offset, int limit, int json,
+                       size_t *len)
+{
+    if (limit <= 0)
+        limit = AUTOINDEX_PAGE_SIZE;
+    if (limit > AUTOINDEX_MAX_PAGE_SIZE)
+        limit = AUTOINDEX_MAX_PAGE_SIZE;
+    if (offset < 0 || offset > listing->count)
+        offset = listing->count;
+    int end = listing->count - offset > limit ? offset + limit : listing->count;
+
+    AutoindexBuffer buffer = {NULL, 0, 0, 0};
+    if (json)
+        render_json(&buffer, listing, url_path, offset, end, limit);
+    else
+        render_html(&buffer, listing, url_path, offset, end, limit);
+
+    if (buffer.failed)
+    {
+        free(buffer.data);
+        return NULL;
+    }
+    *len = buffer.len;
+    return buffer.data;
+}
@@ -0,0 +1,50 @@
+// autoindex.h - 目錄列表（HTML / JSON），掃描結果快取並由 inotify 失效
+#ifndef AUTOINDEX_H
+#define AUTOINDEX_H
+
+#include <stddef.h>
+
+#define AUTOINDEX_BUCKETS 256
+#define AUTOINDEX_DEFAULT_MAX_DIRS 256 // 快取的目錄數上限，超過時清空
+#define AUTOINDEX_PAGE_SIZE 1000       // 每頁預設項目數
+#define AUTOINDEX_MAX_PAGE_SIZE 10000
+
+typedef struct AutoindexCache AutoindexCache;
+
+typedef struct
+{
+    const char *name;
+    int is_dir;
+    long long size;
+    long long mtime;
+} AutoindexEntry;
+
+// 一次掃描的結果（已排序：目錄在前，其餘依名稱），以參考計數共用，內容不會再改變
+typedef struct
+{
+    AutoindexEntry *entries;
+    int count;
+    int refcount;
+    char *names; // 所有名稱存放在同一塊記憶體
+} AutoindexListing;
+
+AutoindexCache *autoindex_create(int max_dirs);
+
+// 取得目錄 dir_path（完整路徑，不含結尾 '/'）的列表，失敗回傳 NULL
+// 前 root_len 個字元是根目錄；root_fd 不為 -1 時以 open_directory_beneath 開啟其餘部分
+// cache 為 NULL 時每次都重新掃描；使用完畢需呼叫 autoindex_release
+AutoindexListing *autoindex_get(AutoindexCache *cache, int root_fd, const char *dir_path, size_t root_len);
+void autoindex_release(AutoindexListing *listing);
+
+// dir_path 是否為根目錄底下的目錄（參數同 autoindex_get），用於把 "/dir" 重新導向到 "/dir/"
+int autoindex_is_directory(int root_fd, const char *dir_path, size_t root_len);
+
+// 檔案變更通知：path 所在目錄的列表失效；is_prefix 為 1 時 path 底下的列表也一併失效
+void autoindex_invalidate(AutoindexCache *cache, const char *path, int is_prefix);
+
+// 產生第 offset 項起最多 limit 項的 HTML（json 為 0）或 JSON，url_path 為目錄的網址（以 '/' 結尾）
+// 回傳 malloc 配置的內容，長度寫入 len
+char *autoindex_render(const AutoindexListing *listing, const char *url_path, int offset, int limit, int json,
+                       size_t *len);
+
+#endif // AUTOINDEX_H
@@ -0,0 +1,368 @@
+// cache_arena.c - 檔案快取記憶體區實現
+//
+// 數 GB 的快取以 malloc 配置時散布在 4KB 頁面上，每次送出快取內容都可能 TLB 未命中。
+// 這裡一次預留一段以 2MB 對齊的連續位址空間，優先向 hugetlbfs 取得預留的大頁面，
+// 沒有預留時以 MADV_HUGEPAGE 要求透明大頁面。每個 2MB 頁面只切成同一種大小（slab），
+// 大小級距每級約 1.25 倍並以 64 位元組對齊；頁面在所有空位都歸還後回到共用的閒置頁面，
+// 可以改給其他級距使用，避免快取內容的大小分布改變後記憶體卡在舊的級距中。
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#include "cache_arena.h"
+#include "../core/logger.h"
+#include "../core/metrics.h"
+
+typedef struct
+{
+    int class_index; // -1 表示閒置
+    int used;        // 已配置的空位數
+    int in_partial;  // 是否在所屬級距的「尚有空位」串列中
+    int prev;
+    int next;
+    size_t carved;   // 尚未切出的起始偏移量，空位依需要才切出
+    void *free_list; // 已歸還的空位（以空位開頭存放下一個指標）
+} ArenaPage;
+
+typedef struct
+{
+    pthread_mutex_t mutex;
+    size_t chunk_size;
+    int partial; // 尚有空位的頁面串列，-1 表示沒有
+    int pages;   // 分配給此級距的頁面數
+} ArenaClass;
+
+struct CacheArena
+{
+    char *base;
+    size_t size;
+    int page_count;
+    ArenaPage *pages;
+    ArenaClass classes[CACHE_ARENA_MAX_CLASSES];
+    int class_count;
+
+    pthread_mutex_t pool_mutex; // 保護以下閒置頁面
+    int *free_pages;
+    int free_count;
+    int next_page; // 從未使用過的第一個頁面
+    int active_classes; // 擁有頁面的級距數（原子操作）
+
+    const char *page_type;
+    Metric *bytes;
+    Metric *fallbacks;
+};
+
+#ifdef __linux__
+// 透明大頁面被設為 never 時 MADV_HUGEPAGE 沒有作用
+static int arena_thp_available(void)
+{
+    FILE *file = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+    if (!file)
+        return 0;
+    char line[128] = "";
+    char *result = fgets(line, sizeof(line), file);
+    fclose(file);
+    return result && !strstr(line, "[never]");
+}
+
+// 預留 size 位元組並以 CACHE_ARENA_PAGE_SIZE 對齊，失敗時回傳 NULL
+static char *arena_map(size_t size, CacheArenaMode mode, const char **page_type)
+{
+#ifdef MAP_HUGETLB
+    if (mode == CACHE_ARENA_HUGE_PAGES)
+    {
+        // hugetlbfs 頁面本身即為 2MB 對齊；預留的大頁面不足時 mmap 直接失敗，不會在使用時才 SIGBUS
+        void *region = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (region != MAP_FAILED)
+        {
+            *page_type = "hugetlbfs";
+            return region;
+        }
+    }
+#endif
+
+    size_t reserve = size + CACHE_ARENA_PAGE_SIZE;
+    char *region = mmap(NULL, reserve, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (region == MAP_FAILED)
+        return NULL;
+
+    // 去掉頭尾多出的部分，讓每個 slab 頁面剛好對應一個大頁面
+    uintptr_t start = ((uintptr_t)region + CACHE_ARENA_PAGE_SIZE - 1) & ~(uintptr_t)(CACHE_ARENA_PAGE_SIZE - 1);
+    size_t head = start - (uintptr_t)region;
+    if (head > 0)
+        munmap(region, head);
+    if (reserve - head > size)
+        munmap((char *)start + size, reserve - head - size);
+
+    *page_type = "regular pages";
+#ifdef MADV_HUGEPAGE
+    if (mode == CACHE_ARENA_HUGE_PAGES && arena_thp_available() && madvise((void *)start, size, MADV_HUGEPAGE) == 0)
+        *page_type = "transparent huge pages";
+#endif
+#ifdef MADV_NOHUGEPAGE
+    if (mode == CACHE_ARENA_SMALL_PAGES)
+        madvise((void *)start, size, MADV_NOHUGEPAGE);
+#endif
+    return (char *)start;
+}
+#endif
+
+CacheArena *cache_arena_create(const char *name, size_t bytes, CacheArenaMode mode)
+{
+#ifdef __linux__
+    if (mode == CACHE_ARENA_OFF || bytes == 0)
+        return NULL;
+
+    CacheArena *arena = calloc(1, sizeof(CacheArena));
+    if (!arena)
+        return NULL;
+
+    // 級距：從 CACHE_ARENA_MIN_CHUNK 開始每級約 1.25 倍，以 64 位元組對齊
+    size_t chunk = CACHE_ARENA_MIN_CHUNK;
+    while (arena->class_count < CACHE_ARENA_MAX_CLASSES)
+    {
+        if (chunk > CACHE_ARENA_MAX_CHUNK || arena->class_count == CACHE_ARENA_MAX_CLASSES - 1)
+            chunk = CACHE_ARENA_MAX_CHUNK;
+        ArenaClass *class = &arena->classes[arena->class_count++];
+        pthread_mutex_init(&class->mutex, NULL);
+        class->chunk_size = chunk;
+        class->partial = -1;
+        if (chunk == CACHE_ARENA_MAX_CHUNK)
+            break;
+        chunk = (chunk + chunk / 4 + 63) & ~(size_t)63;
+    }
+
+    // 只預留快取容量本身（hugetlbfs 在 mmap 時就預留大頁面）：項目以 slab 大小計入容量，
+    // 各級距未填滿的頁面由快取以 cache_arena_headroom 從容量中扣除
+    size_t pages = (bytes + CACHE_ARENA_PAGE_SIZE - 1) / CACHE_ARENA_PAGE_SIZE;
+    arena->size = pages * CACHE_ARENA_PAGE_SIZE;
+    arena->page_count = (int)pages;
+    arena->pages = calloc(pages, sizeof(ArenaPage));
+    arena->free_pages = malloc(pages * sizeof(int));
+    arena->base = arena->pages && arena->free_pages ? arena_map(arena->size, mode, &arena->page_type) : NULL;
+    if (!arena->base)
+    {
+        free(arena->pages);
+        free(arena->free_pages);
+        free(arena);
+        log_message(LOG_WARNING, "[%s] Cannot reserve %zu MB for the cache arena, using malloc", name,
+                    (size_t)(pages * (CACHE_ARENA_PAGE_SIZE / (1024 * 1024))));
+        return NULL;
+    }
+    pthread_mutex_init(&arena->pool_mutex, NULL);
+
+    char labels[128];
+    snprintf(labels, sizeof(labels), "cache=\"%s\"", name);
+    arena->bytes = metrics_gauge("static_cache_arena_bytes", "Bytes of cache arena pages assigned to a slab class",
+                                 labels);
+    arena->fallbacks = metrics_counter("static_cache_arena_fallbacks_total",
+                                       "Cache entries allocated with malloc because the arena had no room", labels);
+    return arena;
+#else
+    (void)name;
+    (void)bytes;
+    (void)mode;
+    return NULL;
+#endif
+}
+
+void cache_arena_destroy(CacheArena *arena)
+{
+    if (!arena)
+        return;
+#ifdef __linux__
+    munmap(arena->base, arena->size);
+#endif
+    for (int i = 0; i < arena->class_count; i++)
+        pthread_mutex_destroy(&arena->classes[i].mutex);
+    pthread_mutex_destroy(&arena->pool_mutex);
+    free(arena->pages);
+    free(arena->free_pages);
+    free(arena);
+}
+
+const char *cache_arena_page_type(const CacheArena *arena)
+{
+    return arena ? arena->page_type : "malloc";
+}
+
+static ArenaClass *arena_class_for(CacheArena *arena, size_t size)
+{
+    for (int i = 0; i < arena->class_count; i++)
+    {
+        if (arena->classes[i].chunk_size >= size)
+            return &arena->classes[i];
+    }
+    return NULL;
+}
+
+size_t cache_arena_headroom(const CacheArena *arena)
+{
+    if (!arena)
+        return 0;
+    size_t headroom = (size_t)__atomic_load_n(&arena->active_classes, __ATOMIC_RELAXED) * CACHE_ARENA_PAGE_SIZE;
+    return headroom < arena->size / 2 ? headroom : arena->size / 2;
+}
+
+char *cache_arena_sparsest_page(CacheArena *arena)
+{
+    if (!arena)
+        return NULL;
+    // 只是挑選淘汰對象，頁面狀態不需要一致的快照
+    int best = -1;
+    int best_used = 0;
+    for (int i = 0; i < arena->page_count; i++)
+    {
+        ArenaPage *page = &arena->pages[i];
+        if (__atomic_load_n(&page->class_index, __ATOMIC_RELAXED) < 0)
+            continue;
+        int used = __atomic_load_n(&page->used, __ATOMIC_RELAXED);
+        if (used > 0 && (best < 0 || used < best_used))
+        {
+            best = i;
+            best_used = used;
+        }
+    }
+    return best >= 0 ? arena->base + (size_t)best * CACHE_ARENA_PAGE_SIZE : NULL;
+}
+
+void cache_arena_count_fallback(CacheArena *arena)
+{
+    if (arena)
+        metrics_inc(arena->fallbacks);
+}
+
+size_t cache_arena_chunk_size(const CacheArena *arena, size_t size)
+{
+    for (int i = 0; arena && i < arena->class_count; i++)
+    {
+        if (arena->classes[i].chunk_size >= size)
+            return arena->classes[i].chunk_size;
+    }
+    return size;
+}
+
+// 以下串列操作需持有所屬級距的鎖
+static void arena_partial_push(CacheArena *arena, ArenaClass *class, int index)
+{
+    ArenaPage *page = &arena->pages[index];
+    page->prev = -1;
+    page->next = class->partial;
+    if (class->partial >= 0)
+        arena->pages[class->partial].prev = index;
+    class->partial = index;
+    page->in_partial = 1;
+}
+
+static void arena_partial_remove(CacheArena *arena, ArenaClass *class, int index)
+{
+    ArenaPage *page = &arena->pages[index];
+    if (page->prev >= 0)
+        arena->pages[page->prev].next = page->next;
+    else
+        class->partial = page->next;
+    if (page->next >= 0)
+        arena->pages[page->next].prev = page->prev;
+    page->in_partial = 0;
+}
+
+// 取得一個閒置頁面，沒有時回傳 -1
+static int arena_take_page(CacheArena *arena)
+{
+    int index = -1;
+    pthread_mutex_lock(&arena->pool_mutex);
+    if (arena->free_count > 0)
+        index = arena->free_pages[--arena->free_count];
+    else if (arena->next_page < arena->page_count)
+        index = arena->next_page++;
+    pthread_mutex_unlock(&arena->pool_mutex);
+    if (index >= 0)
+        metrics_add(arena->bytes, CACHE_ARENA_PAGE_SIZE);
+    return index;
+}
+
+void *cache_arena_alloc(CacheArena *arena, size_t size)
+{
+    if (!arena)
+        return NULL;
+    ArenaClass *class = arena_class_for(arena, size);
+    if (!class)
+        return NULL;
+
+    pthread_mutex_lock(&class->mutex);
+    int index = class->partial;
+    if (index < 0)
+    {
+        index = arena_take_page(arena);
+        if (index < 0)
+        {
+            pthread_mutex_unlock(&class->mutex);
+            return NULL;
+        }
+        ArenaPage *page = &arena->pages[index];
+        page->class_index = (int)(class - arena->classes);
+        page->used = 0;
+        page->carved = 0;
+        page->free_list = NULL;
+        arena_partial_push(arena, class, index);
+        if (class->pages++ == 0)
+            __atomic_add_fetch(&arena->active_classes, 1, __ATOMIC_RELAXED);
+    }
+
+    ArenaPage *page = &arena->pages[index];
+    void *chunk = page->free_list;
+    if (chunk)
+    {
+        page->free_list = *(void **)chunk;
+    }
+    else
+    {
+        chunk = arena->base + (size_t)index * CACHE_ARENA_PAGE_SIZE + page->carved;
+        page->carved += class->chunk_size;
+    }
+    page->used++;
+    if (!page->free_list && page->carved + class->chunk_size > CACHE_ARENA_PAGE_SIZE)
+        arena_partial_remove(arena, class, index);
+    pthread_mutex_unlock(&class->mutex);
+    return chunk;
+}
+
+void cache_arena_free(CacheArena *arena, void *ptr)
+{
+    if (!arena || !ptr)
+        return;
+
+    int index = (int)(((char *)ptr - arena->base) / CACHE_ARENA_PAGE_SIZE);
+    ArenaPage *page = &arena->pages[index];
+    // 頁面仍有已配置的空位（ptr），所屬級距不會改變
+    ArenaClass *class = &arena->classes[page->class_index];
+
+    pthread_mutex_lock(&class->mutex);
+    *(void **)ptr = page->free_list;
+    page->free_list = ptr;
+    if (--page->used > 0)
+    {
+        if (!page->in_partial)
+            arena_partial_push(arena, class, index);
+        pthread_mutex_unlock(&class->mutex);
+        return;
+    }
+
+    // 整頁都已歸還：交回閒置頁面，之後可分給任何級距
+    if (page->in_partial)
+        arena_partial_remove(arena, class, index);
+    page->class_index = -1;
+    if (--class->pages == 0)
+        __atomic_sub_fetch(&arena->active_classes, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&class->mutex);
+
+    pthread_mutex_lock(&arena->pool_mutex);
+    arena->free_pages[arena->free_count++] = index;
+    pthread_mutex_unlock(&arena->pool_mutex);
+    metrics_add(arena->bytes, -(int64_t)CACHE_ARENA_PAGE_SIZE);
+}
@@ -0,0 +1,50 @@
+// cache_arena.h - 檔案快取專用的記憶體區：以 2MB 大頁面為單位的 slab 配置，減少大容量快取的 TLB 未命中
+#ifndef CACHE_ARENA_H
+#define CACHE_ARENA_H
+
+#include <stddef.h>
+
+#define CACHE_ARENA_PAGE_SIZE (2 * 1024 * 1024) // slab 頁面大小，與 x86-64 / arm64 的大頁面相同
+#define CACHE_ARENA_MIN_CHUNK 256               // 最小的 slab 大小
+#define CACHE_ARENA_MAX_CHUNK (512 * 1024)      // 超過此大小的配置不使用 arena
+#define CACHE_ARENA_MAX_CLASSES 48
+
+typedef enum
+{
+    CACHE_ARENA_OFF,         // 不使用 arena，每個項目以 malloc 配置
+    CACHE_ARENA_SMALL_PAGES, // arena 使用一般頁面（MADV_NOHUGEPAGE），用於比較
+    CACHE_ARENA_HUGE_PAGES   // 優先使用 hugetlbfs 預留的大頁面，否則以 MADV_HUGEPAGE 要求透明大頁面
+} CacheArenaMode;
+
+typedef struct CacheArena CacheArena;
+
+// 預留 bytes 位元組（進位到 2MB 頁面）的位址空間，使用 hugetlbfs 時預留的大頁面數與快取容量相同，
+// 其他情況實際用到時才配置記憶體；name 用於日誌與指標標籤；平台不支援或 mode 為 CACHE_ARENA_OFF 時回傳 NULL
+CacheArena *cache_arena_create(const char *name, size_t bytes, CacheArenaMode mode);
+
+// 從大小最接近的 slab 配置；太大或 arena 已滿時回傳 NULL（呼叫者可騰出空間後重試，或改用 malloc）
+// 可由任何執行緒呼叫，釋放時需使用 cache_arena_free
+void *cache_arena_alloc(CacheArena *arena, size_t size);
+void cache_arena_free(CacheArena *arena, void *ptr);
+
+// 呼叫者放棄 arena 改用 malloc 時呼叫，計入 static_cache_arena_fallbacks_total
+void cache_arena_count_fallback(CacheArena *arena);
+
+// 從 arena 配置 size 位元組時實際佔用的空間（所屬 slab 的大小），超過最大 slab 時回傳 size
+size_t cache_arena_chunk_size(const CacheArena *arena, size_t size);
+
+// 快取容量中需保留給 slab 頁面的空間：每個使用中的級距一個頁面（其最後一個頁面可能只填了一部分），
+// 最多為 arena 的一半
+size_t cache_arena_headroom(const CacheArena *arena);
+
+// 已配置空位最少的頁面的起始位址（釋放其上的配置最快能讓整頁交回閒置），沒有分配出去的頁面時回傳 NULL；
+// 保留空間不足以涵蓋碎片、arena 沒有空位時，呼叫者釋放這個頁面上的配置後重試
+char *cache_arena_sparsest_page(CacheArena *arena);
+
+// 歸還整段位址空間，呼叫前需已釋放所有配置
+void cache_arena_destroy(CacheArena *arena);
+
+// 實際使用的頁面類型："hugetlbfs"、"transparent huge pages" 或 "regular pages"
+const char *cache_arena_page_type(const CacheArena *arena);
+
+#endif // CACHE_ARENA_H
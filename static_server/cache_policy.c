@@ -0,0 +1,94 @@
+// cache_policy.c - Cache-Control 規則實現
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "cache_policy.h"
+
+typedef struct
+{
+    char *pattern;
+    char *value; // NULL 表示不送 Cache-Control
+} CachePolicyRule;
+
+// 內建預設：每次重新驗證。檔案回應都有 ETag 與 Last-Modified，未變更時只需一個 304，
+// 部署後也不會送出過期的資源；要長時間快取（例如帶雜湊的檔名）時以規則指定 max-age
+#define CACHE_POLICY_DEFAULT "no-cache"
+
+static CachePolicyRule g_rules[CACHE_POLICY_MAX_RULES];
+static int g_rule_count = 0;
+
+int cache_policy_add(const char *rule)
+{
+    const char *eq = strchr(rule, '=');
+    if (!eq || eq == rule || g_rule_count >= CACHE_POLICY_MAX_RULES || strlen(eq + 1) > CACHE_POLICY_MAX_VALUE)
+        return -1;
+    if (rule[0] != '/' && rule[0] != '.' && !(rule[0] == '*' && eq == rule + 1))
+        return -1;
+
+    CachePolicyRule *entry = &g_rules[g_rule_count];
+    entry->pattern = malloc(eq - rule + 1);
+    if (!entry->pattern)
+        return -1;
+    memcpy(entry->pattern, rule, eq - rule);
+    entry->pattern[eq - rule] = '\0';
+    entry->value = strcmp(eq + 1, "none") == 0 ? NULL : strdup(eq + 1);
+
+    g_rule_count++;
+    return 0;
+}
+
+static int cache_policy_has_extension(const char *path, size_t path_len, const char *extension)
+{
+    size_t ext_len = strlen(extension);
+    if (ext_len > path_len)
+        return 0;
+    const char *tail = path + path_len - ext_len;
+    for (size_t i = 0; i < ext_len; i++)
+    {
+        if (tolower((unsigned char)tail[i]) != tolower((unsigned char)extension[i]))
+            return 0;
+    }
+    return 1;
+}
+
+const char *cache_policy_lookup(const char *path)
+{
+    size_t path_len = strlen(path);
+    const CachePolicyRule *prefix = NULL;
+    const CachePolicyRule *extension = NULL;
+    const CachePolicyRule *fallback = NULL;
+    size_t prefix_len = 0;
+
+    for (int i = 0; i < g_rule_count; i++)
+    {
+        const CachePolicyRule *rule = &g_rules[i];
+        if (rule->pattern[0] == '/')
+        {
+            size_t len = strlen(rule->pattern);
+            if (len > prefix_len && strncmp(path, rule->pattern, len) == 0)
+            {
+                prefix = rule;
+                prefix_len = len;
+            }
+        }
+        else if (rule->pattern[0] == '.')
+        {
+            if (!extension && cache_policy_has_extension(path, path_len, rule->pattern))
+                extension = rule;
+        }
+        else if (!fallback)
+        {
+            fallback = rule;
+        }
+    }
+
+    if (prefix)
+        return prefix->value;
+    if (extension)
+        return extension->value;
+    if (fallback)
+        return fallback->value;
+    return CACHE_POLICY_DEFAULT;
+}
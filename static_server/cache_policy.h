@@ -0,0 +1,18 @@
+// cache_policy.h - 依網址路徑前綴或副檔名決定 Cache-Control
+#ifndef CACHE_POLICY_H
+#define CACHE_POLICY_H
+
+#define CACHE_POLICY_MAX_RULES 32
+#define CACHE_POLICY_MAX_VALUE 256 // Cache-Control 值的長度上限，讓回應標頭有固定的大小上限
+
+// 規則格式（應在 start_server 之前加入，成功回傳 0）：
+//   "/assets/=public, max-age=31536000, immutable"  路徑前綴，最長者優先
+//   ".html=no-cache"                                副檔名（不分大小寫）
+//   "*=public, max-age=60"                          其餘檔案
+// 值為 "none" 時不送 Cache-Control；沒有符合的規則時使用內建的 "no-cache"
+int cache_policy_add(const char *rule);
+
+// 查詢網址路徑的 Cache-Control 值，符合的規則為 "none" 時回傳 NULL
+const char *cache_policy_lookup(const char *path);
+
+#endif // CACHE_POLICY_H
@@ -0,0 +1,281 @@
+// embed_gen.c - 將 www/ 打包成 C 原始碼，由 build embed 編譯並執行
+//
+// 用法: embed_gen <www 目錄> <輸出.c>
+// 每個檔案產生原始內容與 gzip 版本（可壓縮且壓縮後變小時），連同預先組好的標頭與 ETag；
+// 路徑依 strcmp 排序，執行期以 embedded_lookup 二分搜尋。
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <dirent.h>
+
+#include "../core/mime.h"
+#include "../core/compress.h"
+#include "../core/http_utils.h"
+#include "embedded_assets.h"
+
+#define MAX_ASSETS 4096
+
+typedef struct
+{
+    char path[512]; // 網址路徑
+    char *data;
+    size_t len;
+    long long mtime;
+} Asset;
+
+static Asset g_assets[MAX_ASSETS];
+static int g_asset_count = 0;
+
+static int has_suffix(const char *name, const char *suffix)
+{
+    size_t name_len = strlen(name);
+    size_t suffix_len = strlen(suffix);
+    return name_len > suffix_len && strcmp(name + name_len - suffix_len, suffix) == 0;
+}
+
+static int load_asset(const char *file_path, const char *url_path, long long mtime)
+{
+    if (g_asset_count >= MAX_ASSETS)
+    {
+        fprintf(stderr, "Too many files, skipping %s\n", file_path);
+        return 0;
+    }
+
+    FILE *file = fopen(file_path, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "Cannot open %s\n", file_path);
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    long len = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    Asset *asset = &g_assets[g_asset_count];
+    asset->data = malloc(len > 0 ? len : 1);
+    if (!asset->data || (len > 0 && fread(asset->data, 1, len, file) != (size_t)len))
+    {
+        fprintf(stderr, "Cannot read %s\n", file_path);
+        free(asset->data);
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+
+    snprintf(asset->path, sizeof(asset->path), "%s", url_path);
+    asset->len = len;
+    asset->mtime = mtime;
+    g_asset_count++;
+    return 0;
+}
+
+// 遞迴載入目錄；略過隱藏檔與 .gz / .br 壓縮檔（gzip 版本由這裡產生）
+static int load_dir(const char *dir_path, const char *url_prefix)
+{
+    DIR *dir = opendir(dir_path);
+    if (!dir)
+    {
+        fprintf(stderr, "Cannot open directory %s\n", dir_path);
+        return -1;
+    }
+
+    int result = 0;
+    struct dirent *entry;
+    while (result == 0 && (entry = readdir(dir)) != NULL)
+    {
+        if (entry->d_name[0] == '.' || has_suffix(entry->d_name, ".gz") || has_suffix(entry->d_name, ".br"))
+            continue;
+
+        char file_path[1024];
+        char url_path[512];
+        snprintf(file_path, sizeof(file_path), "%s/%s", dir_path, entry->d_name);
+        snprintf(url_path, sizeof(url_path), "%s/%s", url_prefix, entry->d_name);
+
+        struct stat st;
+        if (stat(file_path, &st) != 0)
+            continue;
+        if (S_ISDIR(st.st_mode))
+            result = load_dir(file_path, url_path);
+        else if (S_ISREG(st.st_mode))
+            result = load_asset(file_path, url_path, (long long)st.st_mtime);
+    }
+    closedir(dir);
+    return result;
+}
+
+static int compare_assets(const void *a, const void *b)
+{
+    return strcmp(((const Asset *)a)->path, ((const Asset *)b)->path);
+}
+
+// 以 C 字串常值輸出（跳脫引號、反斜線與不可列印字元）
+static void write_string(FILE *out, const char *s, size_t len)
+{
+    fputc('"', out);
+    for (size_t i = 0; i < len; i++)
+    {
+        unsigned char c = (unsigned char)s[i];
+        if (c == '"' || c == '\\')
+            fprintf(out, "\\%c", c);
+        else if (c == '\r')
+            fputs("\\r", out);
+        else if (c == '\n')
+            fputs("\\n", out);
+        else if (c < 0x20 || c >= 0x7f)
+            fprintf(out, "\\%03o", c);
+        else
+            fputc(c, out);
+    }
+    fputc('"', out);
+}
+
+static void write_bytes(FILE *out, const char *name, const char *data, size_t len)
+{
+    fprintf(out, "static const unsigned char %s[] = {", name);
+    if (len == 0)
+        fputs("0", out); // 不允許空的初始值
+    for (size_t i = 0; i < len; i++)
+        fprintf(out, "%s0x%02x,", i % 16 == 0 ? "\n    " : "", (unsigned char)data[i]);
+    fputs("\n};\n\n", out);
+}
+
+// 組出一種表示法的標頭（與 http_handler_static.c 的 format_entity_headers 相同的順序）
+static int format_header(char *buffer, size_t size, const MimeType *mime, size_t length, const char *encoding,
+                         const char *etag, long long mtime, int vary)
+{
+    char date[64];
+    http_format_date(date, sizeof(date), mtime);
+    // 一次格式化，超過 size 時回傳的長度也不會讓後續寫入越界
+    return snprintf(buffer, size, "%sContent-Length: %zu\r\n%s%s%sETag: %s\r\nLast-Modified: %s\r\n%s", mime->header,
+                    length, encoding ? "Content-Encoding: " : "Accept-Ranges: bytes\r\n", encoding ? encoding : "",
+                    encoding ? "\r\n" : "", etag, date, vary ? "Vary: Accept-Encoding\r\n" : "");
+}
+
+static void write_variant(FILE *out, const char *header, int header_len, const char *body_name, size_t body_len,
+                          const char *etag)
+{
+    fputs("{", out);
+    write_string(out, header, header_len);
+    fprintf(out, ", %d, %s, %zu, ", header_len, body_name, body_len);
+    write_string(out, etag, strlen(etag));
+    fputs("}", out);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3)
+    {
+        fprintf(stderr, "Usage: %s <www directory> <output.c>\n", argv[0]);
+        return 1;
+    }
+
+    // 與伺服器相同：目前目錄有 mime.types 時覆蓋內建的對應
+    mime_load("mime.types");
+
+    if (load_dir(argv[1], "") != 0)
+        return 1;
+    qsort(g_assets, g_asset_count, sizeof(Asset), compare_assets);
+
+    FILE *out = fopen(argv[2], "w");
+    if (!out)
+    {
+        fprintf(stderr, "Cannot write %s\n", argv[2]);
+        return 1;
+    }
+    fprintf(out, "// %s - generated by embed_gen from %s, do not edit\n", argv[2], argv[1]);
+    fputs("#include <stddef.h>\n#include \"embedded_assets.h\"\n\n", out);
+
+    // 先輸出內容，gzip 版本的長度記在 gzip_len（0 表示沒有）
+    size_t *gzip_len = calloc(g_asset_count > 0 ? g_asset_count : 1, sizeof(size_t));
+    size_t total_bytes = 0;
+    size_t total_gzip = 0;
+    for (int i = 0; i < g_asset_count; i++)
+    {
+        Asset *asset = &g_assets[i];
+        char name[32];
+        snprintf(name, sizeof(name), "asset_%d", i);
+        write_bytes(out, name, asset->data, asset->len);
+        total_bytes += asset->len;
+
+        const MimeType *mime = mime_lookup(asset->path);
+        if (asset->len >= COMPRESS_MIN_SIZE && compress_is_compressible(mime->type))
+        {
+            size_t compressed_len;
+            char *compressed = compress_buffer(COMPRESS_GZIP, COMPRESS_LEVEL_STATIC, asset->data, asset->len,
+                                               &compressed_len);
+            if (compressed)
+            {
+                snprintf(name, sizeof(name), "asset_%d_gzip", i);
+                write_bytes(out, name, compressed, compressed_len);
+                gzip_len[i] = compressed_len;
+                total_gzip += compressed_len;
+                free(compressed);
+            }
+        }
+    }
+
+    // 伺服器直接複製預先組好的標頭，過長（例如自訂的 Content-Type 很長）時讓建置失敗，而不是送出不完整的標頭
+    const char *oversized = NULL;
+    fputs("const EmbeddedAsset embedded_assets[] = {\n", out);
+    for (int i = 0; i < g_asset_count; i++)
+    {
+        Asset *asset = &g_assets[i];
+        const MimeType *mime = mime_lookup(asset->path);
+        int vary = gzip_len[i] > 0;
+
+        char etag[64];
+        char header[1024];
+        char name[32];
+        snprintf(etag, sizeof(etag), "\"%llx-%llx\"", (unsigned long long)asset->len, (unsigned long long)asset->mtime);
+
+        fputs("    {", out);
+        write_string(out, asset->path, strlen(asset->path));
+        fprintf(out, ", %zu, %lld,\n     ", strlen(asset->path), asset->mtime);
+        int header_len = format_header(header, sizeof(header), mime, asset->len, NULL, etag, asset->mtime, vary);
+        if (header_len >= EMBEDDED_HEADER_MAX)
+        {
+            oversized = asset->path;
+            break;
+        }
+        snprintf(name, sizeof(name), "asset_%d", i);
+        write_variant(out, header, header_len, name, asset->len, etag);
+        fputs(",\n     ", out);
+        if (gzip_len[i] > 0)
+        {
+            char gzip_etag[80];
+            snprintf(gzip_etag, sizeof(gzip_etag), "%.*s-gzip\"", (int)strlen(etag) - 1, etag);
+            header_len = format_header(header, sizeof(header), mime, gzip_len[i], "gzip", gzip_etag, asset->mtime, 1);
+            if (header_len >= EMBEDDED_HEADER_MAX)
+            {
+                oversized = asset->path;
+                break;
+            }
+            snprintf(name, sizeof(name), "asset_%d_gzip", i);
+            write_variant(out, header, header_len, name, gzip_len[i], gzip_etag);
+        }
+        else
+        {
+            fputs("{NULL, 0, NULL, 0, NULL}", out);
+        }
+        fputs("},\n", out);
+    }
+    if (oversized)
+    {
+        fprintf(stderr, "Entity headers for %s exceed %d bytes\n", oversized, EMBEDDED_HEADER_MAX);
+        fclose(out);
+        remove(argv[2]);
+        return 1;
+    }
+    if (g_asset_count == 0)
+        fputs("    {\"\", 0, 0, {NULL, 0, NULL, 0, NULL}, {NULL, 0, NULL, 0, NULL}},\n", out); // 不允許空陣列
+    fprintf(out, "};\n\nconst int embedded_asset_count = %d;\n", g_asset_count);
+    fclose(out);
+
+    printf("Embedded %d files from %s (%zu bytes, %zu bytes gzip variants)\n", g_asset_count, argv[1], total_bytes,
+           total_gzip);
+    for (int i = 0; i < g_asset_count; i++)
+        free(g_assets[i].data);
+    free(gzip_len);
+    return 0;
+}
@@ -0,0 +1,22 @@
+// embedded_assets.c - 內嵌資源查詢
+#include <string.h>
+
+#include "embedded_assets.h"
+
+const EmbeddedAsset *embedded_lookup(const char *path)
+{
+    int low = 0;
+    int high = embedded_asset_count - 1;
+    while (low <= high)
+    {
+        int mid = low + (high - low) / 2;
+        int cmp = strcmp(path, embedded_assets[mid].path);
+        if (cmp == 0)
+            return &embedded_assets[mid];
+        if (cmp < 0)
+            high = mid - 1;
+        else
+            low = mid + 1;
+    }
+    return NULL;
+}
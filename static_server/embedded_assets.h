@@ -0,0 +1,35 @@
+// embedded_assets.h - 編譯進執行檔的 www/ 內容（由 build embed 以 embed_gen 產生 embedded_www.c）
+#ifndef EMBEDDED_ASSETS_H
+#define EMBEDDED_ASSETS_H
+
+#include <stddef.h>
+
+#define EMBEDDED_HEADER_MAX 768 // 預先組好的實體標頭上限，超過時 embed_gen 失敗
+
+// 一種表示法（原始內容或 gzip）：預先組好的實體標頭與內容
+// 標頭從 Content-Type 到 Vary（小於 EMBEDDED_HEADER_MAX），不含依執行期設定而定的 Cache-Control 與 Connection
+typedef struct
+{
+    const char *header;
+    unsigned int header_len;
+    const unsigned char *body;
+    unsigned long long body_len;
+    const char *etag;
+} EmbeddedVariant;
+
+typedef struct
+{
+    const char *path; // 網址路徑，例如 "/css/site.css"，依 strcmp 排序
+    unsigned int path_len;
+    long long mtime;
+    EmbeddedVariant identity;
+    EmbeddedVariant gzip; // header 為 NULL 表示沒有 gzip 版本（不可壓縮或壓縮後沒有變小）
+} EmbeddedAsset;
+
+extern const EmbeddedAsset embedded_assets[];
+extern const int embedded_asset_count;
+
+// 以二分搜尋查詢 path（已正規化），找不到時回傳 NULL
+const EmbeddedAsset *embedded_lookup(const char *path);
+
+#endif // EMBEDDED_ASSETS_H
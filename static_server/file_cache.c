@@ -0,0 +1,416 @@
+// file_cache.c - 靜態檔案記憶體快取實現
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "file_cache.h"
+#include "../core/metrics.h"
+
+typedef struct
+{
+    pthread_mutex_t mutex;
+    FileCacheEntry *buckets[FILE_CACHE_BUCKETS];
+    FileCacheEntry **clock; // CLOCK 環，依加入順序存放項目
+    int clock_count;
+    int clock_capacity;
+    int clock_hand;
+    size_t bytes;
+    uint64_t generation; // 每次失效加一
+} FileCacheShard;
+
+struct FileCache
+{
+    FileCacheShard shards[FILE_CACHE_SHARDS];
+    size_t shard_budget;
+    size_t max_entry;
+    CacheArena *arena; // NULL 表示項目以 malloc 配置
+    Metric *hits;
+    Metric *misses;
+    Metric *evictions;
+    Metric *invalidations;
+    Metric *bytes;
+    Metric *entries;
+};
+
+static uint32_t file_cache_hash(const char *path)
+{
+    uint32_t hash = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)path; *p; p++)
+    {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static FileCacheShard *file_cache_shard(FileCache *cache, uint32_t hash)
+{
+    return &cache->shards[hash & (FILE_CACHE_SHARDS - 1)];
+}
+
+static FileCacheEntry **file_cache_bucket(FileCacheShard *shard, uint32_t hash)
+{
+    return &shard->buckets[(hash >> 4) % FILE_CACHE_BUCKETS];
+}
+
+FileCache *file_cache_create(const char *name, size_t max_bytes, size_t max_entry, CacheArenaMode arena_mode)
+{
+    FileCache *cache = calloc(1, sizeof(FileCache));
+    if (!cache)
+        return NULL;
+
+    for (int i = 0; i < FILE_CACHE_SHARDS; i++)
+        pthread_mutex_init(&cache->shards[i].mutex, NULL);
+
+    cache->shard_budget = max_bytes / FILE_CACHE_SHARDS;
+    cache->max_entry = max_entry < cache->shard_budget ? max_entry : cache->shard_budget;
+    cache->arena = cache_arena_create(name, max_bytes, arena_mode);
+
+    char labels[128];
+    snprintf(labels, sizeof(labels), "cache=\"%s\"", name);
+    cache->hits = metrics_counter("static_cache_hits_total", "Static file cache hits", labels);
+    cache->misses = metrics_counter("static_cache_misses_total", "Static file cache misses", labels);
+    cache->evictions = metrics_counter("static_cache_evictions_total", "Entries evicted to stay within the size budget", labels);
+    cache->invalidations = metrics_counter("static_cache_invalidations_total", "Entries dropped because the file changed", labels);
+    cache->bytes = metrics_gauge("static_cache_bytes", "Bytes held by the static file cache", labels);
+    cache->entries = metrics_gauge("static_cache_entries", "Entries held by the static file cache", labels);
+    return cache;
+}
+
+const char *file_cache_page_type(FileCache *cache)
+{
+    return cache_arena_page_type(cache->arena);
+}
+
+static void file_cache_entry_free(FileCacheEntry *entry)
+{
+    if (entry->arena)
+        cache_arena_free(entry->arena, entry);
+    else
+        free(entry);
+}
+
+void file_cache_release(FileCacheEntry *entry)
+{
+    if (entry && __atomic_sub_fetch(&entry->refcount, 1, __ATOMIC_ACQ_REL) == 0)
+        file_cache_entry_free(entry);
+}
+
+// 從雜湊表與 CLOCK 環移除項目（需持有分片鎖），並釋放快取持有的參考
+static void file_cache_unlink(FileCache *cache, FileCacheShard *shard, FileCacheEntry *entry)
+{
+    FileCacheEntry **link = file_cache_bucket(shard, entry->hash);
+    while (*link && *link != entry)
+        link = &(*link)->next;
+    if (*link)
+        *link = entry->next;
+
+    int index = entry->clock_index;
+    shard->clock_count--;
+    if (index != shard->clock_count)
+    {
+        shard->clock[index] = shard->clock[shard->clock_count];
+        shard->clock[index]->clock_index = index;
+    }
+    if (shard->clock_hand >= shard->clock_count)
+        shard->clock_hand = 0;
+
+    shard->bytes -= entry->charge;
+    metrics_add(cache->bytes, -(int64_t)entry->charge);
+    metrics_add(cache->entries, -1);
+    file_cache_release(entry);
+}
+
+void file_cache_destroy(FileCache *cache)
+{
+    if (!cache)
+        return;
+    for (int i = 0; i < FILE_CACHE_SHARDS; i++)
+    {
+        FileCacheShard *shard = &cache->shards[i];
+        while (shard->clock_count > 0)
+            file_cache_unlink(cache, shard, shard->clock[0]);
+        free(shard->clock);
+        pthread_mutex_destroy(&shard->mutex);
+    }
+    cache_arena_destroy(cache->arena);
+    free(cache);
+}
+
+FileCacheEntry *file_cache_get(FileCache *cache, const char *path)
+{
+    uint32_t hash = file_cache_hash(path);
+    FileCacheShard *shard = file_cache_shard(cache, hash);
+
+    pthread_mutex_lock(&shard->mutex);
+    FileCacheEntry *entry = *file_cache_bucket(shard, hash);
+    while (entry && (entry->hash != hash || strcmp(entry->path, path) != 0))
+        entry = entry->next;
+    if (entry)
+    {
+        entry->referenced = 1;
+        __atomic_add_fetch(&entry->refcount, 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&shard->mutex);
+
+    metrics_inc(entry ? cache->hits : cache->misses);
+    return entry;
+}
+
+uint64_t file_cache_generation(FileCache *cache, const char *path)
+{
+    FileCacheShard *shard = file_cache_shard(cache, file_cache_hash(path));
+    pthread_mutex_lock(&shard->mutex);
+    uint64_t generation = shard->generation;
+    pthread_mutex_unlock(&shard->mutex);
+    return generation;
+}
+
+// CLOCK 淘汰：跳過最近被存取過的項目（並清除其參考位元），直到分片的用量加上 needed 不超過 budget
+static void file_cache_make_room(FileCache *cache, FileCacheShard *shard, size_t needed, size_t budget)
+{
+    while (shard->clock_count > 0 && shard->bytes + needed > budget)
+    {
+        FileCacheEntry *entry = shard->clock[shard->clock_hand];
+        if (entry->referenced)
+        {
+            entry->referenced = 0;
+            shard->clock_hand = (shard->clock_hand + 1) % shard->clock_count;
+            continue;
+        }
+        file_cache_unlink(cache, shard, entry);
+        metrics_inc(cache->evictions);
+    }
+}
+
+// 需持有分片鎖
+static FileCacheEntry *file_cache_find(FileCacheShard *shard, uint32_t hash, const char *path)
+{
+    FileCacheEntry *entry = *file_cache_bucket(shard, hash);
+    while (entry && (entry->hash != hash || strcmp(entry->path, path) != 0))
+        entry = entry->next;
+    return entry;
+}
+
+// arena 沒有這個大小的空位時（空位都在其他級距未填滿的頁面上），淘汰一個同級距的項目讓出空位。
+// 從 start 所在的分片開始找，回傳是否淘汰了項目
+static int file_cache_evict_chunk(FileCache *cache, uint32_t start, size_t charge)
+{
+    for (int i = 0; i < FILE_CACHE_SHARDS; i++)
+    {
+        FileCacheShard *shard = &cache->shards[(start + i) & (FILE_CACHE_SHARDS - 1)];
+        pthread_mutex_lock(&shard->mutex);
+        for (int n = 0; n < shard->clock_count; n++)
+        {
+            FileCacheEntry *entry = shard->clock[(shard->clock_hand + n) % shard->clock_count];
+            if (entry->arena && entry->charge == charge)
+            {
+                file_cache_unlink(cache, shard, entry);
+                metrics_inc(cache->evictions);
+                pthread_mutex_unlock(&shard->mutex);
+                return 1;
+            }
+        }
+        pthread_mutex_unlock(&shard->mutex);
+    }
+    return 0;
+}
+
+// 淘汰位於 arena 頁面 page 上的所有項目，讓整頁交回閒置後分給需要的級距，回傳是否淘汰了項目
+static int file_cache_evict_page(FileCache *cache, const char *page)
+{
+    int evicted = 0;
+    for (int i = 0; page && i < FILE_CACHE_SHARDS; i++)
+    {
+        FileCacheShard *shard = &cache->shards[i];
+        pthread_mutex_lock(&shard->mutex);
+        for (int n = shard->clock_count - 1; n >= 0; n--)
+        {
+            const char *address = (const char *)shard->clock[n];
+            if (n < shard->clock_count && address >= page && address < page + CACHE_ARENA_PAGE_SIZE)
+            {
+                file_cache_unlink(cache, shard, shard->clock[n]);
+                metrics_inc(cache->evictions);
+                evicted = 1;
+            }
+        }
+        pthread_mutex_unlock(&shard->mutex);
+    }
+    return evicted;
+}
+
+FileCacheEntry *file_cache_put(FileCache *cache, const char *path, uint64_t generation,
+                               const char *header, size_t header_len,
+                               const char *body, size_t body_len,
+                               const FileCacheValidator *validator)
+{
+    // 項目、路徑與內容放在同一塊記憶體中，送出時只需碰觸相鄰的頁面
+    // 以所屬 slab 的大小計入容量，arena 的內部碎片也算在快取容量內
+    size_t size = header_len + body_len;
+    size_t path_len = strlen(path);
+    size_t total = sizeof(FileCacheEntry) + path_len + 1 + size;
+    size_t charge = cache_arena_chunk_size(cache->arena, total);
+    if (body_len > cache->max_entry || charge > cache->shard_budget)
+        return NULL;
+
+    // 各級距未填滿的頁面佔用的空間也從容量中扣除，arena 才不會在快取用滿之前先用完
+    size_t headroom = cache_arena_headroom(cache->arena) / FILE_CACHE_SHARDS;
+    size_t budget = headroom < cache->shard_budget ? cache->shard_budget - headroom : 0;
+
+    uint32_t hash = file_cache_hash(path);
+    FileCacheShard *shard = file_cache_shard(cache, hash);
+
+    // 先淘汰再配置：arena 與快取容量一樣大，快取已滿時先配置會找不到空位而改用 malloc，
+    // 淘汰釋放的空位也就用不到。騰出的空間先計入分片用量，配置與複製內容時不持有鎖
+    int reserved = 0;
+    pthread_mutex_lock(&shard->mutex);
+    if (shard->generation == generation)
+    {
+        FileCacheEntry *existing = file_cache_find(shard, hash, path);
+        if (existing)
+            file_cache_unlink(cache, shard, existing);
+        file_cache_make_room(cache, shard, charge, budget);
+        shard->bytes += charge;
+        reserved = 1;
+    }
+    pthread_mutex_unlock(&shard->mutex);
+
+    // arena 的空位都在其他級距的頁面上時，先淘汰一個同級距的項目，沒有的話淘汰最空的頁面上的項目；
+    // 被淘汰的項目若還在送出中，空位要等送完才釋放，所以最多重試幾次
+    CacheArena *arena = cache->arena;
+    FileCacheEntry *entry = cache_arena_alloc(arena, total);
+    for (int tries = 0; !entry && arena && total <= CACHE_ARENA_MAX_CHUNK && tries < 4; tries++)
+    {
+        if (!file_cache_evict_chunk(cache, hash, charge) &&
+            !file_cache_evict_page(cache, cache_arena_sparsest_page(arena)))
+            break;
+        entry = cache_arena_alloc(arena, total);
+    }
+    if (!entry)
+    {
+        cache_arena_count_fallback(arena);
+        arena = NULL;
+        entry = malloc(total);
+    }
+    if (!entry)
+    {
+        if (reserved)
+        {
+            pthread_mutex_lock(&shard->mutex);
+            shard->bytes -= charge;
+            pthread_mutex_unlock(&shard->mutex);
+        }
+        return NULL;
+    }
+    memset(entry, 0, sizeof(FileCacheEntry));
+    entry->arena = arena;
+    entry->charge = charge;
+    entry->path = (char *)(entry + 1);
+    memcpy(entry->path, path, path_len + 1);
+    entry->data = entry->path + path_len + 1;
+    memcpy(entry->data, header, header_len);
+    memcpy(entry->data + header_len, body, body_len);
+    entry->header_len = header_len;
+    entry->body_len = body_len;
+    if (validator)
+        entry->validator = *validator;
+    entry->hash = hash;
+    entry->refcount = 2; // 快取一份，呼叫者一份
+
+    pthread_mutex_lock(&shard->mutex);
+
+    // 讀取或複製期間檔案已變更：不放入快取，但仍可用於這次回應
+    int inserted = 0;
+    if (reserved && shard->generation == generation)
+    {
+        // 其他執行緒可能已先放入相同路徑
+        FileCacheEntry *existing = file_cache_find(shard, hash, path);
+        if (existing)
+            file_cache_unlink(cache, shard, existing);
+
+        FileCacheEntry **clock = shard->clock;
+        if (shard->clock_count == shard->clock_capacity)
+        {
+            int capacity = shard->clock_capacity ? shard->clock_capacity * 2 : 64;
+            clock = realloc(shard->clock, capacity * sizeof(FileCacheEntry *));
+            if (clock)
+            {
+                shard->clock = clock;
+                shard->clock_capacity = capacity;
+            }
+        }
+        if (clock)
+        {
+            FileCacheEntry **bucket = file_cache_bucket(shard, hash);
+            entry->next = *bucket;
+            *bucket = entry;
+            entry->clock_index = shard->clock_count;
+            shard->clock[shard->clock_count++] = entry;
+            inserted = 1;
+        }
+    }
+    if (reserved && !inserted)
+        shard->bytes -= charge;
+
+    pthread_mutex_unlock(&shard->mutex);
+
+    if (!inserted)
+    {
+        entry->refcount = 1;
+        return entry;
+    }
+    metrics_add(cache->bytes, (int64_t)charge);
+    metrics_add(cache->entries, 1);
+    return entry;
+}
+
+static int file_cache_path_under(const char *path, const char *prefix, size_t prefix_len)
+{
+    return strncmp(path, prefix, prefix_len) == 0 && (path[prefix_len] == '/' || path[prefix_len] == '\0');
+}
+
+void file_cache_invalidate(FileCache *cache, const char *path, int is_prefix)
+{
+    if (!is_prefix)
+    {
+        uint32_t hash = file_cache_hash(path);
+        FileCacheShard *shard = file_cache_shard(cache, hash);
+
+        pthread_mutex_lock(&shard->mutex);
+        shard->generation++;
+        FileCacheEntry *entry = *file_cache_bucket(shard, hash);
+        while (entry && (entry->hash != hash || strcmp(entry->path, path) != 0))
+            entry = entry->next;
+        if (entry)
+        {
+            file_cache_unlink(cache, shard, entry);
+            metrics_inc(cache->invalidations);
+        }
+        pthread_mutex_unlock(&shard->mutex);
+        return;
+    }
+
+    // 目錄被刪除或移動：逐一檢查所有分片
+    size_t prefix_len = strlen(path);
+    for (int i = 0; i < FILE_CACHE_SHARDS; i++)
+    {
+        FileCacheShard *shard = &cache->shards[i];
+        pthread_mutex_lock(&shard->mutex);
+        shard->generation++;
+        for (int n = shard->clock_count - 1; n >= 0; n--)
+        {
+            if (n < shard->clock_count && file_cache_path_under(shard->clock[n]->path, path, prefix_len))
+            {
+                file_cache_unlink(cache, shard, shard->clock[n]);
+                metrics_inc(cache->invalidations);
+            }
+        }
+        pthread_mutex_unlock(&shard->mutex);
+    }
+}
+
+size_t file_cache_max_entry(FileCache *cache)
+{
+    return cache->max_entry;
+}
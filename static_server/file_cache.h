@@ -0,0 +1,70 @@
+// file_cache.h - 靜態檔案記憶體快取（分片、容量上限、CLOCK 淘汰）
+#ifndef FILE_CACHE_H
+#define FILE_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cache_arena.h"
+
+#define FILE_CACHE_SHARDS 16         // 分片數（需為 2 的冪次），各自有鎖與容量上限
+#define FILE_CACHE_BUCKETS 1024      // 每個分片的雜湊桶數
+#define FILE_CACHE_MAX_ENTRY 262144  // 預設只快取 256KB 以下的檔案
+
+// 條件式請求（If-None-Match / If-Modified-Since）所需的驗證資訊
+typedef struct
+{
+    char etag[64];       // 含引號的強 ETag
+    long long mtime;     // Last-Modified（秒）
+} FileCacheValidator;
+
+// 快取項目：data 為預先組好的標頭區塊（狀態列與 Date 之後的部分）緊接著檔案內容
+// 項目本身、path 與 data 位於同一塊配置中（優先來自 arena）
+// 取得的項目在 file_cache_release 之前不會被釋放，即使已被淘汰或失效
+typedef struct FileCacheEntry
+{
+    char *path;
+    uint32_t hash;
+    char *data;
+    size_t header_len;
+    size_t body_len;
+    size_t charge; // 計入容量的位元組數：有 arena 時為所屬 slab 的大小（改用 malloc 時也一樣），否則為整塊配置的大小
+    FileCacheValidator validator;
+    int refcount;   // 快取本身持有一份，每次取得再加一
+    int referenced; // CLOCK 的參考位元
+    int clock_index;
+    CacheArena *arena; // 配置來源，NULL 表示 malloc
+    struct FileCacheEntry *next;
+} FileCacheEntry;
+
+typedef struct FileCache FileCache;
+
+// name 用於指標標籤，max_bytes 為總容量上限（包含 arena 的頁面），max_entry 為單一檔案的大小上限
+// arena_mode 決定項目的記憶體來源，arena 無法建立時退回 malloc
+FileCache *file_cache_create(const char *name, size_t max_bytes, size_t max_entry, CacheArenaMode arena_mode);
+void file_cache_destroy(FileCache *cache); // 呼叫前需釋放所有取得的項目
+
+// 項目記憶體實際使用的頁面類型（見 cache_arena_page_type），沒有 arena 時為 "malloc"
+const char *file_cache_page_type(FileCache *cache);
+
+// 查詢快取，命中時回傳已加參考計數的項目，使用完需呼叫 file_cache_release
+FileCacheEntry *file_cache_get(FileCache *cache, const char *path);
+void file_cache_release(FileCacheEntry *entry);
+
+// 讀取檔案前取得 path 所屬分片的世代值；讀取期間若發生失效，
+// file_cache_put 會拒絕寫入，避免把舊內容放回快取
+uint64_t file_cache_generation(FileCache *cache, const char *path);
+
+// 加入項目（必要時淘汰其他項目），回傳已加參考計數的項目；檔案太大或記憶體不足時回傳 NULL
+// 世代已變更時回傳的項目不會放入快取，但仍可用於這次回應；validator 可為 NULL
+FileCacheEntry *file_cache_put(FileCache *cache, const char *path, uint64_t generation,
+                               const char *header, size_t header_len,
+                               const char *body, size_t body_len,
+                               const FileCacheValidator *validator);
+
+// 讓 path 失效；is_prefix 為 1 時讓所有以 path 為目錄前綴的項目失效
+void file_cache_invalidate(FileCache *cache, const char *path, int is_prefix);
+
+size_t file_cache_max_entry(FileCache *cache);
+
+#endif // FILE_CACHE_H
@@ -0,0 +1,272 @@
+// fs_watch.c - inotify 監看實現
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fs_watch.h"
+#include "../core/logger.h"
+
+typedef struct
+{
+    FsWatchCallback callback;
+    void *ctx;
+} FsWatchSubscriber;
+
+static FsWatchSubscriber g_subscribers[FS_WATCH_MAX_SUBSCRIBERS];
+static int g_subscriber_count = 0;
+
+int fs_watch_subscribe(FsWatchCallback callback, void *ctx)
+{
+    if (g_subscriber_count >= FS_WATCH_MAX_SUBSCRIBERS)
+        return -1;
+    g_subscribers[g_subscriber_count].callback = callback;
+    g_subscribers[g_subscriber_count].ctx = ctx;
+    g_subscriber_count++;
+    return 0;
+}
+
+static void fs_watch_notify(const char *path, int is_dir)
+{
+    for (int i = 0; i < g_subscriber_count; i++)
+        g_subscribers[i].callback(path, is_dir, g_subscribers[i].ctx);
+}
+
+#ifndef __linux__
+
+int fs_watch_start(const char *root)
+{
+    (void)root;
+    (void)fs_watch_notify;
+    log_message(LOG_WARNING, "File change notifications are not supported on this platform");
+    return -1;
+}
+
+#else
+
+#include <errno.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+
+#define FS_WATCH_EVENTS (IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE | \
+                         IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF)
+
+// watch descriptor 對應的目錄路徑
+typedef struct
+{
+    int wd;
+    char *path;
+} FsWatchDir;
+
+// 目錄表同時被監看執行緒（新增子目錄）與 fs_watch_start（新增根目錄）修改
+static pthread_mutex_t g_watch_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int g_inotify_fd = -1;
+static char g_roots[FS_WATCH_MAX_ROOTS][512];
+static int g_root_count = 0;
+static FsWatchDir *g_dirs = NULL;
+static int g_dir_count = 0;
+static int g_dir_capacity = 0;
+
+static const char *fs_watch_dir_path(int wd)
+{
+    for (int i = 0; i < g_dir_count; i++)
+    {
+        if (g_dirs[i].wd == wd)
+            return g_dirs[i].path;
+    }
+    return NULL;
+}
+
+// 加入目錄與其子目錄，path 本身無法監看時回傳 -1
+static int fs_watch_add_dir(const char *path)
+{
+    int wd = inotify_add_watch(g_inotify_fd, path, FS_WATCH_EVENTS | IN_ONLYDIR);
+    if (wd < 0)
+    {
+        log_message(LOG_WARNING, "inotify_add_watch failed for %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    // 同一目錄重新加入時 inotify 會回傳相同的 wd
+    for (int i = 0; i < g_dir_count; i++)
+    {
+        if (g_dirs[i].wd == wd)
+        {
+            free(g_dirs[i].path);
+            g_dirs[i].path = strdup(path);
+            return 0;
+        }
+    }
+
+    if (g_dir_count == g_dir_capacity)
+    {
+        int capacity = g_dir_capacity ? g_dir_capacity * 2 : 16;
+        FsWatchDir *dirs = realloc(g_dirs, capacity * sizeof(FsWatchDir));
+        if (!dirs)
+            return -1;
+        g_dirs = dirs;
+        g_dir_capacity = capacity;
+    }
+    g_dirs[g_dir_count].wd = wd;
+    g_dirs[g_dir_count].path = strdup(path);
+    g_dir_count++;
+
+    // 加入子目錄
+    DIR *dir = opendir(path);
+    if (!dir)
+        return 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+
+        char child[1024];
+        snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+        struct stat st;
+        if (lstat(child, &st) == 0 && S_ISDIR(st.st_mode))
+            fs_watch_add_dir(child);
+    }
+    closedir(dir);
+    return 0;
+}
+
+static void fs_watch_remove_dir(int wd)
+{
+    for (int i = 0; i < g_dir_count; i++)
+    {
+        if (g_dirs[i].wd == wd)
+        {
+            free(g_dirs[i].path);
+            g_dirs[i] = g_dirs[g_dir_count - 1];
+            g_dir_count--;
+            return;
+        }
+    }
+}
+
+static void *fs_watch_thread(void *arg)
+{
+    (void)arg;
+    char buffer[16384] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+    while (1)
+    {
+        ssize_t len = read(g_inotify_fd, buffer, sizeof(buffer));
+        if (len < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            log_message(LOG_ERROR, "inotify read failed: %s", strerror(errno));
+            return NULL;
+        }
+
+        pthread_mutex_lock(&g_watch_mutex);
+        for (char *p = buffer; p < buffer + len;)
+        {
+            struct inotify_event *event = (struct inotify_event *)p;
+            p += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                // 遺失部分事件，所有根目錄都視為失效
+                log_message(LOG_WARNING, "inotify queue overflow, invalidating all watched roots");
+                for (int i = 0; i < g_root_count; i++)
+                    fs_watch_notify(g_roots[i], 1);
+                continue;
+            }
+
+            const char *dir_path = fs_watch_dir_path(event->wd);
+            if (!dir_path)
+                continue;
+
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED))
+            {
+                fs_watch_notify(dir_path, 1);
+                if (event->mask & IN_IGNORED)
+                    fs_watch_remove_dir(event->wd);
+                continue;
+            }
+
+            char path[1024];
+            if (event->len > 0)
+                snprintf(path, sizeof(path), "%s/%s", dir_path, event->name);
+            else
+                snprintf(path, sizeof(path), "%s", dir_path);
+
+            int is_dir = (event->mask & IN_ISDIR) != 0;
+            if (is_dir && (event->mask & (IN_CREATE | IN_MOVED_TO)))
+                fs_watch_add_dir(path);
+
+            fs_watch_notify(path, is_dir);
+        }
+        pthread_mutex_unlock(&g_watch_mutex);
+    }
+    return NULL;
+}
+
+int fs_watch_start(const char *root)
+{
+    pthread_mutex_lock(&g_watch_mutex);
+    for (int i = 0; i < g_root_count; i++)
+    {
+        if (strcmp(g_roots[i], root) == 0)
+        {
+            pthread_mutex_unlock(&g_watch_mutex);
+            return 0; // 多個虛擬主機共用同一個根目錄
+        }
+    }
+    if (g_root_count >= FS_WATCH_MAX_ROOTS)
+    {
+        pthread_mutex_unlock(&g_watch_mutex);
+        log_message(LOG_ERROR, "Too many watched roots, not watching %s", root);
+        return -1;
+    }
+
+    int first = g_inotify_fd < 0;
+    if (first)
+    {
+        g_inotify_fd = inotify_init1(IN_CLOEXEC);
+        if (g_inotify_fd < 0)
+        {
+            pthread_mutex_unlock(&g_watch_mutex);
+            log_message(LOG_ERROR, "inotify_init1 failed: %s", strerror(errno));
+            return -1;
+        }
+    }
+
+    // 巢狀的根目錄（例如某個虛擬主機位於另一個的子目錄）可能已在監看中，added 為 0
+    int dir_count = g_dir_count;
+    if (fs_watch_add_dir(root) != 0)
+    {
+        if (first)
+        {
+            close(g_inotify_fd);
+            g_inotify_fd = -1;
+        }
+        pthread_mutex_unlock(&g_watch_mutex);
+        return -1;
+    }
+    int added = g_dir_count - dir_count;
+    snprintf(g_roots[g_root_count], sizeof(g_roots[0]), "%s", root);
+    g_root_count++;
+    pthread_mutex_unlock(&g_watch_mutex);
+
+    if (first)
+    {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, fs_watch_thread, NULL) != 0)
+        {
+            log_message(LOG_ERROR, "Failed to create file watch thread");
+            return -1;
+        }
+        pthread_detach(thread);
+    }
+
+    log_message(LOG_INFO, "Watching %s for changes (%d directories)", root, added);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,19 @@
+// fs_watch.h - 以 inotify 監看文件根目錄，檔案變更時通知各快取失效
+#ifndef FS_WATCH_H
+#define FS_WATCH_H
+
+#define FS_WATCH_MAX_SUBSCRIBERS 8
+#define FS_WATCH_MAX_ROOTS 64
+
+// path 為變更的完整路徑（以 fs_watch_start 傳入的 root 開頭）
+// is_dir 為 1 時表示整個目錄（含子目錄）都應視為失效；佇列溢位時會以每個 root 通知
+typedef void (*FsWatchCallback)(const char *path, int is_dir, void *ctx);
+
+// 訂閱變更通知，應在 fs_watch_start 之前呼叫，成功回傳 0
+int fs_watch_subscribe(FsWatchCallback callback, void *ctx);
+
+// 遞迴監看 root，第一次呼叫時啟動背景執行緒，成功回傳 0；可對多個根目錄各呼叫一次
+// 不支援 inotify 的平台回傳 -1，快取內容不會自動失效
+int fs_watch_start(const char *root);
+
+#endif // FS_WATCH_H
@@ -4,40 +4,1103 @@
 #include <time.h>
 #ifdef _WIN32
 #include <winsock2.h>
-#include <direct.h>
-#define getcwd _getcwd
+#include <io.h>
 #else
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #endif
 
 #include "../core/http_handler.h"
 #include "../core/server.h"
 #include "../core/logger.h"
 #include "../core/file_utils.h"
+#include "../core/metrics.h"
+#include "../core/latency.h"
+#include "../core/http_utils.h"
+#include "../core/compress.h"
+#include "../core/mime.h"
+#include "../core/file_stream.h"
+#include "../core/disk_io.h"
+#include "../core/single_flight.h"
+#include "static_handler.h"
+#include "file_cache.h"
+#include "fs_watch.h"
+#include "precompressed.h"
+#include "open_file_cache.h"
+#include "autoindex.h"
+#include "vhost.h"
+#include "warmup.h"
+#ifdef HAVE_EMBEDDED_ASSETS
+#include "embedded_assets.h"
+#endif
+#include "cache_policy.h"
 
-void send_response(int client_socket, const char *status, const char *content_type, const char *body, int body_len)
+// Host 標頭不符合任何虛擬主機（或沒有設定虛擬主機）時使用的網站
+static VirtualHost g_default_host;
+static int g_autoindex_enabled = 0;
+static CacheArenaMode g_cache_pages = CACHE_ARENA_HUGE_PAGES;
+
+// 同一個檔案（或壓縮版本）同時未命中時只載入一次，鍵為完整路徑，各主機共用
+static SingleFlight *g_loads;
+
+// 檔案回應的實體標頭
+typedef struct
+{
+    const char *content_type;
+    const char *content_encoding; // NULL 表示未壓縮
+    int vary_encoding;            // 有壓縮版本時加上 Vary: Accept-Encoding
+    const char *cache_control;    // NULL 表示不送
+    FileCacheValidator validator; // etag 為空字串時不送 ETag / Last-Modified
+    const MimeType *mime;         // 不為 NULL 時直接使用預先組好的 Content-Type 標頭
+} EntityInfo;
+
+// 請求的條件式標頭
+typedef struct
+{
+    char if_none_match[512];     // 空字串表示沒有
+    long long if_modified_since; // -1 表示沒有
+    char range[256];             // 空字串表示沒有 Range
+    char if_range[128];
+    int head_only;               // HEAD：標頭與 GET 相同，但不讀取也不送出內容
+} Preconditions;
+
+// 靜態檔案伺服器支援的方法；OPTIONS 與 405 的回應除了狀態列與 Date 之外都是固定的
+#define STATIC_ALLOWED_METHODS "GET, HEAD, OPTIONS"
+static const char g_options_response[] = "Server: Simple C Server\r\n"
+                                         "Allow: " STATIC_ALLOWED_METHODS "\r\n"
+                                         "Connection: close\r\n\r\n";
+static const char g_method_not_allowed_response[] = "Server: Simple C Server\r\n"
+                                                    "Allow: " STATIC_ALLOWED_METHODS "\r\n"
+                                                    "Content-Type: text/plain\r\n"
+                                                    "Content-Length: 18\r\n"
+                                                    "Connection: close\r\n\r\n"
+                                                    "Method Not Allowed";
+
+static void host_on_change(VirtualHost *host, const char *path, int is_dir)
+{
+    // 先更新壓縮檔查詢結果，再讓快取失效（handle_client 以相反順序讀取）
+    precompressed_invalidate(host->precompressed, path, is_dir);
+    open_file_cache_invalidate(host->open_file_cache, path, is_dir);
+    autoindex_invalidate(host->autoindex, path, is_dir);
+    if (!host->file_cache)
+        return;
+    file_cache_invalidate(host->file_cache, path, is_dir);
+
+    // 即時壓縮的結果以 "路徑#編碼" 為鍵
+    if (!is_dir)
+    {
+        char key[1100];
+        snprintf(key, sizeof(key), "%s#%s", path, compress_encoding_name(COMPRESS_GZIP));
+        file_cache_invalidate(host->file_cache, key, 0);
+        snprintf(key, sizeof(key), "%s#%s", path, compress_encoding_name(COMPRESS_ZSTD));
+        file_cache_invalidate(host->file_cache, key, 0);
+    }
+
+    // 壓縮檔出現或消失會改變原始檔的 Vary 標頭
+    size_t base_len = is_dir ? 0 : precompressed_base_length(path);
+    if (base_len > 0 && base_len < 1024)
+    {
+        char base[1024];
+        memcpy(base, path, base_len);
+        base[base_len] = '\0';
+        file_cache_invalidate(host->file_cache, base, 0);
+    }
+}
+
+// path 位於 host 的根目錄內，或 path 是包含根目錄的目錄（is_dir）時通知該主機
+static int host_is_affected(const VirtualHost *host, const char *path, int is_dir)
+{
+    if (strncmp(path, host->root, host->root_len) == 0 &&
+        (path[host->root_len] == '/' || path[host->root_len] == '\0'))
+        return 1;
+    size_t len = strlen(path);
+    return is_dir && len < host->root_len && strncmp(host->root, path, len) == 0 && host->root[len] == '/';
+}
+
+static void static_handler_on_change(const char *path, int is_dir, void *ctx)
+{
+    (void)ctx;
+    // 多個主機的根目錄可能相同或互相包含，每個受影響的主機都要失效
+    if (host_is_affected(&g_default_host, path, is_dir))
+        host_on_change(&g_default_host, path, is_dir);
+    for (int i = 0; i < vhost_count(); i++)
+    {
+        VirtualHost *host = vhost_get(i);
+        if (host_is_affected(host, path, is_dir))
+            host_on_change(host, path, is_dir);
+    }
+}
+
+void static_handler_set_autoindex(int enabled)
+{
+    g_autoindex_enabled = enabled;
+}
+
+void static_handler_set_cache_pages(CacheArenaMode mode)
+{
+    g_cache_pages = mode;
+}
+
+// 解析根目錄並建立主機的快取
+static void host_init(VirtualHost *host)
+{
+    // 解析符號連結與相對路徑，之後每個請求只需把路徑接在後面
+#ifdef _WIN32
+    char *resolved = _fullpath(NULL, host->root, 0);
+#else
+    char *resolved = realpath(host->root, NULL);
+#endif
+    if (resolved)
+        snprintf(host->root, sizeof(host->root), "%s", resolved);
+    free(resolved);
+    host->root_len = strlen(host->root);
+    while (host->root_len > 1 && (host->root[host->root_len - 1] == '/' || host->root[host->root_len - 1] == '\\'))
+        host->root[--host->root_len] = '\0';
+    host->root_fd = open_directory(host->root);
+    log_message(LOG_INFO, "[%s] Document root: %s", host->name, host->root);
+
+    // 沒有變更通知時仍可使用，過期時間限制了結果沿用多久
+    if (host->open_files > 0)
+    {
+        host->open_file_cache = open_file_cache_create(host->open_files, OPEN_FILE_CACHE_TTL_MS);
+        log_message(LOG_INFO, "[%s] Open file cache: %d entries, %d ms TTL", host->name, host->open_files,
+                    OPEN_FILE_CACHE_TTL_MS);
+    }
+
+    // 沒有變更通知時無法保證快取內容是最新的，因此不使用快取
+    if (fs_watch_start(host->root) != 0)
+    {
+        log_message(LOG_WARNING, "[%s] Static file cache disabled: cannot watch %s", host->name, host->root);
+        return;
+    }
+
+    host->precompressed = precompressed_create();
+    if (g_autoindex_enabled)
+        host->autoindex = autoindex_create(AUTOINDEX_DEFAULT_MAX_DIRS);
+
+    if (host->cache_bytes == 0)
+    {
+        log_message(LOG_INFO, "[%s] Static file cache disabled", host->name);
+        return;
+    }
+
+    host->file_cache = file_cache_create(host->name, host->cache_bytes, FILE_CACHE_MAX_ENTRY, g_cache_pages);
+    if (host->file_cache)
+    {
+        log_message(LOG_INFO, "[%s] Static file cache: %zu MB, files up to %zu KB, %s", host->name,
+                    host->cache_bytes / (1024 * 1024), file_cache_max_entry(host->file_cache) / 1024,
+                    file_cache_page_type(host->file_cache));
+    }
+}
+
+void static_handler_init(const char *root, size_t cache_bytes, int open_files)
+{
+    snprintf(g_default_host.name, sizeof(g_default_host.name), "default");
+    snprintf(g_default_host.root, sizeof(g_default_host.root), "%s", root);
+    g_default_host.cache_bytes = cache_bytes;
+    g_default_host.open_files = open_files;
+
+#ifdef HAVE_EMBEDDED_ASSETS
+    log_message(LOG_INFO, "Serving %d embedded files, other paths from the document root", embedded_asset_count);
+#endif
+    if (g_autoindex_enabled)
+        log_message(LOG_INFO, "Directory listings enabled");
+
+    g_loads = single_flight_create("static");
+    fs_watch_subscribe(static_handler_on_change, NULL);
+    host_init(&g_default_host);
+    for (int i = 0; i < vhost_count(); i++)
+        host_init(vhost_get(i));
+}
+
+// 送出全部資料（處理部分送出），回傳已送出的位元組數
+static int send_all(int client_socket, const char *data, int len)
+{
+    int total_sent = 0;
+    while (total_sent < len)
+    {
+        int sent = send(client_socket, data + total_sent, len - total_sent, 0);
+        if (sent <= 0)
+            break;
+        total_sent += sent;
+    }
+    return total_sent;
+}
+
+// 狀態列與 Date 每次回應都不同，其餘標頭可以預先組好
+static int format_status_line(char *buffer, size_t size, const char *status)
+{
+    char date[64];
+    http_format_date(date, sizeof(date), time(NULL));
+    return snprintf(buffer, size, "HTTP/1.1 %s\r\nDate: %s\r\n", status, date);
+}
+
+// 200 與 304 共用的快取相關標頭：ETag、Last-Modified、Cache-Control、Vary
+static int format_cache_headers(char *buffer, size_t size, const EntityInfo *info, const FileCacheValidator *validator)
+{
+    int len = 0;
+    if (validator->etag[0])
+    {
+        char date[64];
+        http_format_date(date, sizeof(date), validator->mtime);
+        len += snprintf(buffer + len, size - len, "ETag: %s\r\nLast-Modified: %s\r\n", validator->etag, date);
+    }
+    if (info->cache_control)
+        len += snprintf(buffer + len, size - len, "Cache-Control: %s\r\n", info->cache_control);
+    if (info->vary_encoding)
+        len += snprintf(buffer + len, size - len, "Vary: Accept-Encoding\r\n");
+    return len;
+}
+
+// content_length 為 -1 時以 chunked 編碼送出（長度事先未知）
+static int format_entity_headers(char *buffer, size_t size, const EntityInfo *info, long long content_length)
+{
+    int len = snprintf(buffer, size, "Server: Simple C Server\r\n");
+    if (info->mime && info->mime->header_len < size - len)
+    {
+        memcpy(buffer + len, info->mime->header, info->mime->header_len);
+        len += info->mime->header_len;
+    }
+    else
+    {
+        len += snprintf(buffer + len, size - len, "Content-Type: %s\r\n", info->content_type);
+    }
+    if (content_length >= 0)
+        len += snprintf(buffer + len, size - len, "Content-Length: %lld\r\n", content_length);
+    else
+        len += snprintf(buffer + len, size - len, "Transfer-Encoding: chunked\r\n");
+    if (info->content_encoding)
+        len += snprintf(buffer + len, size - len, "Content-Encoding: %s\r\n", info->content_encoding);
+    if (info->validator.etag[0] && content_length >= 0)
+        len += snprintf(buffer + len, size - len, "Accept-Ranges: bytes\r\n");
+    len += format_cache_headers(buffer + len, size - len, info, &info->validator);
+    len += snprintf(buffer + len, size - len, "Connection: close\r\n\r\n");
+    return len;
+}
+
+// 依 If-None-Match（優先）或 If-Modified-Since 判斷用戶端的副本是否仍有效
+static int is_not_modified(const Preconditions *cond, const FileCacheValidator *validator)
+{
+    if (!validator->etag[0])
+        return 0;
+    if (cond->if_none_match[0])
+        return http_etag_match(cond->if_none_match, validator->etag);
+    return cond->if_modified_since >= 0 && validator->mtime <= cond->if_modified_since;
+}
+
+// 304 沒有內容，只送驗證與快取相關標頭
+static void send_not_modified(int client_socket, const EntityInfo *info, const FileCacheValidator *validator)
 {
     char header[1024];
-    time_t now = time(NULL);
-    char date[100];
-    strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", gmtime(&now));
-
-    snprintf(header, sizeof(header),
-             "HTTP/1.1 %s\r\n"
-             "Date: %s\r\n"
-             "Server: Simple C Server\r\n"
-             "Content-Type: %s\r\n"
-             "Content-Length: %d\r\n"
-             "Connection: close\r\n"
-             "\r\n",
-             status, date, content_type, body_len);
-
-    send(client_socket, header, strlen(header), 0);
+    int header_len = format_status_line(header, sizeof(header), "304 Not Modified");
+    header_len += snprintf(header + header_len, sizeof(header) - header_len, "Server: Simple C Server\r\n");
+    header_len += format_cache_headers(header + header_len, sizeof(header) - header_len, info, validator);
+    header_len += snprintf(header + header_len, sizeof(header) - header_len, "Connection: close\r\n\r\n");
+
+    send_all(client_socket, header, header_len);
+    latency_mark(LAT_SENT);
+    metrics_http_response(304, header_len);
+}
+
+// 以 inode、大小與修改時間（奈秒）組成強 ETag，檔案內容變更時必定改變
+static void make_validator(FileCacheValidator *validator, const FileStat *st)
+{
+    snprintf(validator->etag, sizeof(validator->etag), "\"%llx-%llx-%llx\"",
+             st->inode, (unsigned long long)st->size,
+             (unsigned long long)(st->mtime * 1000000000LL + st->mtime_nsec));
+    validator->mtime = st->mtime;
+}
+
+// 壓縮版本是不同的表示法，ETag 需與原始檔不同（加上編碼後綴）
+static void make_variant_validator(FileCacheValidator *variant, const FileCacheValidator *identity,
+                                   const char *encoding)
+{
+    *variant = *identity;
+    size_t etag_len = strlen(identity->etag);
+    if (etag_len > 1)
+        snprintf(variant->etag, sizeof(variant->etag), "%.*s-%s\"", (int)(etag_len - 1), identity->etag, encoding);
+}
+
+// 送出狀態列與標頭，回傳標頭長度
+static int send_headers(int client_socket, const char *status, const EntityInfo *info, long long content_length)
+{
+    char header[1024];
+    int header_len = format_status_line(header, sizeof(header), status);
+    header_len += format_entity_headers(header + header_len, sizeof(header) - header_len, info, content_length);
+
+    send_all(client_socket, header, header_len);
+    return header_len;
+}
+
+void send_response(int client_socket, const char *status, const char *content_type, const char *body, int body_len)
+{
+    EntityInfo info = {0};
+    info.content_type = content_type;
+    int header_len = send_headers(client_socket, status, &info, body_len);
     if (body_len > 0)
     {
-        send(client_socket, body, body_len, 0);
+        send_all(client_socket, body, body_len);
+    }
+
+    latency_mark(LAT_SENT);
+    metrics_http_response(atoi(status), header_len + body_len);
+}
+
+// 以 sendfile 直接從檔案送出內容，記憶體用量與檔案大小無關
+static void send_file_response(int client_socket, const EntityInfo *info, int fd, long long file_size,
+                               int head_only)
+{
+    int header_len = send_headers(client_socket, "200 OK", info, file_size);
+    if (head_only)
+    {
+        latency_mark(LAT_SENT);
+        metrics_http_response(200, header_len);
+        return;
+    }
+    long long sent = send_file(client_socket, fd, 0, file_size);
+    if (sent < file_size)
+    {
+        log_message(LOG_WARNING, "File transfer incomplete: %lld of %lld bytes", sent < 0 ? 0 : sent, file_size);
+    }
+
+    latency_mark(LAT_SENT);
+    metrics_http_response(200, header_len + (sent > 0 ? sent : 0));
+}
+
+// 以一次系統呼叫送出兩段資料（例如狀態列與預先組好的標頭＋內容），回傳已送出的位元組數
+static size_t send_two_parts(int client_socket, const char *head, size_t head_len, const char *data, size_t data_len)
+{
+    size_t total = head_len + data_len;
+    size_t sent_total = 0;
+
+#ifdef _WIN32
+    sent_total = send_all(client_socket, head, (int)head_len);
+    if (sent_total == head_len)
+        sent_total += send_all(client_socket, data, (int)data_len);
+#else
+    while (sent_total < total)
+    {
+        struct iovec iov[2];
+        int iov_count = 0;
+        if (sent_total < head_len)
+        {
+            iov[iov_count].iov_base = (char *)head + sent_total;
+            iov[iov_count].iov_len = head_len - sent_total;
+            iov_count++;
+            iov[iov_count].iov_base = (char *)data;
+            iov[iov_count].iov_len = data_len;
+            iov_count++;
+        }
+        else
+        {
+            iov[iov_count].iov_base = (char *)data + (sent_total - head_len);
+            iov[iov_count].iov_len = total - sent_total;
+            iov_count++;
+        }
+
+        ssize_t sent = writev(client_socket, iov, iov_count);
+        if (sent <= 0)
+            break;
+        sent_total += sent;
+    }
+#endif
+    return sent_total;
+}
+
+// 從快取送出：狀態列與預先組好的標頭＋內容以一次系統呼叫送出
+static void send_cached_response(int client_socket, FileCacheEntry *entry, int head_only)
+{
+    char status_line[128];
+    int status_len = format_status_line(status_line, sizeof(status_line), "200 OK");
+    size_t sent_total = send_two_parts(client_socket, status_line, status_len, entry->data,
+                                       entry->header_len + (head_only ? 0 : entry->body_len));
+
+    latency_mark(LAT_SENT);
+    metrics_http_response(200, sent_total);
+}
+
+// 把小檔案讀入記憶體並放進快取，失敗時回傳 NULL（改用 sendfile 送出）
+static FileCacheEntry *cache_file(const VirtualHost *host, const char *full_path, uint64_t generation, int fd,
+                                  long long file_size, const EntityInfo *info)
+{
+    char *body = malloc(file_size > 0 ? file_size : 1);
+    if (!body)
+        return NULL;
+
+    // fd 可能與其他請求共用，一律從指定偏移量讀取；不在 page cache 中時交給 I/O 執行緒
+    if (disk_io_read(fd, body, file_size, 0) != file_size)
+    {
+        free(body);
+        return NULL;
     }
+
+    char header[512];
+    int header_len = format_entity_headers(header, sizeof(header), info, file_size);
+    FileCacheEntry *entry = file_cache_put(host->file_cache, full_path, generation, header, header_len, body,
+                                           file_size, &info->validator);
+    free(body);
+    return entry;
+}
+
+// 送出快取項目，用戶端的副本仍有效時改回 304
+static void send_entry(int client_socket, FileCacheEntry *entry, const EntityInfo *info, const Preconditions *cond)
+{
+    latency_mark(LAT_HANDLED);
+    if (is_not_modified(cond, &entry->validator))
+        send_not_modified(client_socket, info, &entry->validator);
+    else
+        send_cached_response(client_socket, entry, cond->head_only);
+}
+
+// 以 sendfile 送出已開啟的檔案（file->validator 已填入），用戶端的副本仍有效時改回 304
+static void send_opened_file(int client_socket, const EntityInfo *file, OpenFileHandle *opened,
+                             const Preconditions *cond)
+{
+    latency_mark(LAT_HANDLED);
+    if (is_not_modified(cond, &file->validator))
+        send_not_modified(client_socket, file, &file->validator);
+    else
+        send_file_response(client_socket, file, opened->fd, opened->stat.size, cond->head_only);
+    open_file_cache_close(opened);
+}
+
+// 讀入 full_path 並放進快取（已在快取中則直接取得）；read_body 為 0 時（例如 HEAD）只需要 stat 結果，不讀取內容
+// 檔案不存在、太大、沒有快取或未命中且不讀取內容時回傳 NULL，並以 opened 交回已開啟的檔案
+// （不存在時 opened->fd 為 -1），此時 file 為加上驗證資訊的 info
+// 同一個檔案同時未命中時只有一個請求讀取內容，其餘等它放進快取後直接取得
+static FileCacheEntry *load_cached(const VirtualHost *host, const char *full_path, const EntityInfo *info,
+                                   uint64_t generation, OpenFileHandle *opened, EntityInfo *file, int read_body)
+{
+    opened->fd = -1;
+    opened->entry = NULL;
+    if (host->file_cache)
+    {
+        FileCacheEntry *entry = file_cache_get(host->file_cache, full_path);
+        if (entry)
+            return entry;
+    }
+
+    if (open_file_cache_open(host->open_file_cache, host->root_fd, full_path, host->root_len, opened) != 0)
+        return NULL;
+    *file = *info;
+    make_validator(&file->validator, &opened->stat);
+
+    if (host->file_cache && read_body && opened->stat.size <= (long long)file_cache_max_entry(host->file_cache))
+    {
+        // 等到其他請求載入完成，或在取得載入權之前對方剛好完成時，直接使用快取中的結果
+        SingleFlightCall *call = single_flight_begin(g_loads, full_path);
+        FileCacheEntry *entry = file_cache_get(host->file_cache, full_path);
+        if (!entry)
+            entry = cache_file(host, full_path, generation, opened->fd, opened->stat.size, file);
+        single_flight_end(g_loads, call);
+        if (entry)
+        {
+            open_file_cache_close(opened);
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// 送出 full_path 的內容：先查記憶體快取，小檔案讀入後放進快取，其餘以 sendfile 送出
+// generation 需在決定 info 之前取得；檔案不存在時回傳 -1
+static int serve_file(int client_socket, const VirtualHost *host, const char *full_path, const EntityInfo *info,
+                      uint64_t generation, const Preconditions *cond)
+{
+    OpenFileHandle opened;
+    EntityInfo file;
+    FileCacheEntry *entry = load_cached(host, full_path, info, generation, &opened, &file, !cond->head_only);
+    if (entry)
+    {
+        send_entry(client_socket, entry, info, cond);
+        file_cache_release(entry);
+        return 0;
+    }
+    if (opened.fd < 0)
+        return -1;
+
+    send_opened_file(client_socket, &file, &opened, cond);
+    return 0;
+}
+
+static long compress_stream_transform(void *ctx, const char *in, size_t in_len, size_t *consumed,
+                                      char *out, size_t out_size, int finish, int *done)
+{
+    return compress_stream_process(ctx, in, in_len, consumed, out, out_size, finish, done);
+}
+
+// 以固定大小的緩衝區邊讀邊壓縮，長度事先未知，以 chunked 編碼送出（file->validator 已填入）
+static void send_compressed_stream(int client_socket, const EntityInfo *file, OpenFileHandle *opened,
+                                   CompressCodec codec, const Preconditions *cond)
+{
+    EntityInfo variant = *file;
+    variant.content_encoding = compress_encoding_name(codec);
+    make_variant_validator(&variant.validator, &file->validator, variant.content_encoding);
+
+    latency_mark(LAT_HANDLED);
+    CompressStream *stream = NULL;
+    if (is_not_modified(cond, &variant.validator))
+    {
+        send_not_modified(client_socket, &variant, &variant.validator);
+    }
+    else if (cond->head_only)
+    {
+        // 長度在壓縮完成前未知，GET 也以 chunked 送出，標頭因此完全相同
+        int header_len = send_headers(client_socket, "200 OK", &variant, -1);
+        latency_mark(LAT_SENT);
+        metrics_http_response(200, header_len);
+    }
+    else if (!(stream = compress_stream_create(codec, compress_level(codec, 1))))
+    {
+        send_file_response(client_socket, file, opened->fd, opened->stat.size, 0);
+    }
+    else
+    {
+        int header_len = send_headers(client_socket, "200 OK", &variant, -1);
+        FileStreamTransform transform = {compress_stream_transform, stream};
+        long long sent = file_stream_send(client_socket, opened->fd, 0, opened->stat.size, &transform, 1);
+        compress_stream_destroy(stream);
+
+        latency_mark(LAT_SENT);
+        metrics_http_response(200, header_len + (sent > 0 ? sent : 0));
+    }
+    open_file_cache_close(opened);
+}
+
+// 壓縮快取中的 identity，結果以 key 放進快取；壓縮後沒有變小時存入原始內容
+static FileCacheEntry *cache_compressed(const VirtualHost *host, const char *key, uint64_t key_generation,
+                                        const FileCacheEntry *identity, const EntityInfo *info, CompressCodec codec)
+{
+    const char *body = identity->data + identity->header_len;
+    size_t compressed_len;
+    char *compressed = compress_buffer(codec, compress_level(codec, 0), body, identity->body_len, &compressed_len);
+
+    EntityInfo variant = *info;
+    variant.validator = identity->validator;
+    if (compressed)
+    {
+        variant.content_encoding = compress_encoding_name(codec);
+        make_variant_validator(&variant.validator, &identity->validator, variant.content_encoding);
+    }
+
+    char header[512];
+    long long length = compressed ? (long long)compressed_len : (long long)identity->body_len;
+    int header_len = format_entity_headers(header, sizeof(header), &variant, length);
+    FileCacheEntry *entry = file_cache_put(host->file_cache, key, key_generation, header, header_len,
+                                           compressed ? compressed : body, length, &variant.validator);
+    free(compressed);
+    return entry;
+}
+
+// 即時壓縮：每個檔案只壓縮一次，結果以 "路徑#編碼" 為鍵放在原始檔旁
+// 壓縮後沒有變小的檔案，原始內容也會存到該鍵下，避免每次請求都重新嘗試
+static int serve_compressed(int client_socket, const VirtualHost *host, const char *full_path, const EntityInfo *info,
+                            uint64_t generation, CompressCodec codec, const Preconditions *cond)
+{
+    // 壓縮版本的世代值需在取得原始內容之前讀取：檔案變更時先讓原始檔、再讓 "路徑#編碼" 失效，
+    // 之後才讀取會拿到新的世代值，舊內容壓縮後的結果就會被當成最新版本放進快取
+    char key[1100];
+    snprintf(key, sizeof(key), "%s#%s", full_path, compress_encoding_name(codec));
+    uint64_t key_generation = file_cache_generation(host->file_cache, key);
+
+    // 小檔案不壓縮，只查一次快取
+    FileCacheEntry *identity = file_cache_get(host->file_cache, full_path);
+    if (identity && identity->body_len < COMPRESS_MIN_SIZE)
+    {
+        send_entry(client_socket, identity, info, cond);
+        file_cache_release(identity);
+        return 0;
+    }
+
+    FileCacheEntry *entry = file_cache_get(host->file_cache, key);
+    if (entry)
+    {
+        file_cache_release(identity);
+        send_entry(client_socket, entry, info, cond);
+        file_cache_release(entry);
+        return 0;
+    }
+
+    if (!identity)
+    {
+        OpenFileHandle opened;
+        EntityInfo file;
+        // HEAD 也讀入並壓縮：壓縮版本的長度與 ETag 要壓縮後才知道，每個檔案只需付出一次
+        identity = load_cached(host, full_path, info, generation, &opened, &file, 1);
+        if (!identity)
+        {
+            if (opened.fd < 0)
+                return -1;
+            // 超過快取上限的大檔案邊讀邊壓縮，不放進快取（HEAD 送出相同的 chunked 標頭）
+            send_compressed_stream(client_socket, &file, &opened, codec, cond);
+            return 0;
+        }
+    }
+
+    // 同一個壓縮版本同時未命中時只壓縮一次，其餘請求等待後直接使用結果
+    if (identity->body_len >= COMPRESS_MIN_SIZE)
+    {
+        SingleFlightCall *call = single_flight_begin(g_loads, key);
+        entry = file_cache_get(host->file_cache, key);
+        if (!entry)
+            entry = cache_compressed(host, key, key_generation, identity, info, codec);
+        single_flight_end(g_loads, call);
+    }
+    if (entry)
+    {
+        file_cache_release(identity);
+        send_entry(client_socket, entry, info, cond);
+        file_cache_release(entry);
+        return 0;
+    }
+
+    send_entry(client_socket, identity, info, cond);
+    file_cache_release(identity);
+    return 0;
+}
+
+// If-Range 相符時 Range 才適用：ETag 需強比較相符，日期需與 Last-Modified 完全相同
+static int if_range_matches(const char *if_range, const FileCacheValidator *validator)
+{
+    if (!if_range[0])
+        return 1;
+    if (!validator->etag[0] || (if_range[0] == 'W' && if_range[1] == '/'))
+        return 0;
+    if (if_range[0] == '"')
+        return strcmp(if_range, validator->etag) == 0;
+    long long date = http_parse_date(if_range);
+    return date >= 0 && date == validator->mtime;
+}
+
+// 送出範圍內容：memory 不為 NULL 時來自快取項目，否則以 sendfile 從 fd 的偏移量送出
+static long long send_range_body(int client_socket, const char *memory, int fd, const HttpRange *range)
+{
+    long long length = range->end - range->start + 1;
+    if (memory)
+        return send_all(client_socket, memory + range->start, (int)length);
+    long long sent = send_file(client_socket, fd, range->start, length);
+    return sent > 0 ? sent : 0;
+}
+
+static void send_range_not_satisfiable(int client_socket, long long size)
+{
+    char header[512];
+    int header_len = format_status_line(header, sizeof(header), "416 Range Not Satisfiable");
+    header_len += snprintf(header + header_len, sizeof(header) - header_len,
+                           "Server: Simple C Server\r\n"
+                           "Content-Range: bytes */%lld\r\n"
+                           "Content-Length: 0\r\n"
+                           "Connection: close\r\n\r\n",
+                           size);
+    send_all(client_socket, header, header_len);
+    latency_mark(LAT_SENT);
+    metrics_http_response(416, header_len);
+}
+
+// 送出 206：單一範圍直接送出內容，多個範圍以 multipart/byteranges 包裝
+static void send_ranges(int client_socket, const EntityInfo *file, const HttpRange *ranges, int count,
+                        long long size, const char *memory, int fd)
+{
+    char header[1024];
+    int header_len = format_status_line(header, sizeof(header), "206 Partial Content");
+    long long body_len = 0;
+    char boundary[32];
+
+    if (count == 1)
+    {
+        body_len = ranges[0].end - ranges[0].start + 1;
+        header_len += snprintf(header + header_len, sizeof(header) - header_len,
+                               "Server: Simple C Server\r\n"
+                               "Content-Type: %s\r\n"
+                               "Content-Length: %lld\r\n"
+                               "Content-Range: bytes %lld-%lld/%lld\r\n",
+                               file->content_type, body_len, ranges[0].start, ranges[0].end, size);
+    }
+    else
+    {
+        static unsigned int boundary_counter = 0;
+        snprintf(boundary, sizeof(boundary), "%08x%08x", (unsigned int)time(NULL),
+                 __atomic_add_fetch(&boundary_counter, 1, __ATOMIC_RELAXED));
+
+        // 先算出每個分段標頭的長度，才能給出 Content-Length
+        char part[256];
+        for (int i = 0; i < count; i++)
+        {
+            body_len += snprintf(part, sizeof(part),
+                                 "\r\n--%s\r\nContent-Type: %s\r\nContent-Range: bytes %lld-%lld/%lld\r\n\r\n",
+                                 boundary, file->content_type, ranges[i].start, ranges[i].end, size);
+            body_len += ranges[i].end - ranges[i].start + 1;
+        }
+        body_len += snprintf(part, sizeof(part), "\r\n--%s--\r\n", boundary);
+
+        header_len += snprintf(header + header_len, sizeof(header) - header_len,
+                               "Server: Simple C Server\r\n"
+                               "Content-Type: multipart/byteranges; boundary=%s\r\n"
+                               "Content-Length: %lld\r\n",
+                               boundary, body_len);
+    }
+    header_len += snprintf(header + header_len, sizeof(header) - header_len, "Accept-Ranges: bytes\r\n");
+    header_len += format_cache_headers(header + header_len, sizeof(header) - header_len, file, &file->validator);
+    header_len += snprintf(header + header_len, sizeof(header) - header_len, "Connection: close\r\n\r\n");
+
+    long long sent = send_all(client_socket, header, header_len);
+    if (count == 1)
+    {
+        sent += send_range_body(client_socket, memory, fd, &ranges[0]);
+    }
+    else
+    {
+        char part[256];
+        for (int i = 0; i < count; i++)
+        {
+            int part_len = snprintf(part, sizeof(part),
+                                    "\r\n--%s\r\nContent-Type: %s\r\nContent-Range: bytes %lld-%lld/%lld\r\n\r\n",
+                                    boundary, file->content_type, ranges[i].start, ranges[i].end, size);
+            sent += send_all(client_socket, part, part_len);
+            sent += send_range_body(client_socket, memory, fd, &ranges[i]);
+        }
+        int part_len = snprintf(part, sizeof(part), "\r\n--%s--\r\n", boundary);
+        sent += send_all(client_socket, part, part_len);
+    }
+
+    if (sent < header_len + body_len)
+        log_message(LOG_WARNING, "Range transfer incomplete: %lld of %lld bytes", sent, header_len + body_len);
+
+    latency_mark(LAT_SENT);
+    metrics_http_response(206, sent);
+}
+
+// 處理帶有 Range 的請求（一律使用未壓縮的原始內容），檔案不存在時回傳 -1
+// 304 優先於 Range；If-Range 不符或 Range 無法解析時送出完整內容
+static int serve_range(int client_socket, const VirtualHost *host, const char *full_path, const EntityInfo *info,
+                       uint64_t generation, const Preconditions *cond)
+{
+    OpenFileHandle opened;
+    EntityInfo file;
+    FileCacheEntry *entry = load_cached(host, full_path, info, generation, &opened, &file, !cond->head_only);
+    if (!entry && opened.fd < 0)
+        return -1;
+
+    long long size = entry ? (long long)entry->body_len : opened.stat.size;
+    const char *memory = NULL;
+    if (entry)
+    {
+        file = *info;
+        file.validator = entry->validator;
+        memory = entry->data + entry->header_len;
+    }
+
+    latency_mark(LAT_HANDLED);
+    if (is_not_modified(cond, &file.validator))
+    {
+        send_not_modified(client_socket, &file, &file.validator);
+    }
+    else
+    {
+        HttpRange ranges[HTTP_MAX_RANGES];
+        int count = -1;
+        if (if_range_matches(cond->if_range, &file.validator))
+            count = http_parse_range(cond->range, size, ranges, HTTP_MAX_RANGES);
+
+        if (count == 0)
+            send_range_not_satisfiable(client_socket, size);
+        else if (count > 0)
+            send_ranges(client_socket, &file, ranges, count, size, memory, opened.fd);
+        else if (entry)
+            send_cached_response(client_socket, entry, 0);
+        else
+            send_file_response(client_socket, &file, opened.fd, size, 0);
+    }
+
+    if (entry)
+        file_cache_release(entry);
+    else
+        open_file_cache_close(&opened);
+    return 0;
+}
+
+// 依 Accept-Encoding 從可用的壓縮檔中挑選，權重相同時優先 br；都不接受時回傳 NULL
+static const char *choose_precompressed(const char *request, int variants, const char **suffix)
+{
+    char accept[256];
+    if (http_find_header(request, "Accept-Encoding", accept, sizeof(accept)) < 0)
+        return NULL;
+
+    int br = (variants & PRECOMPRESSED_BR) ? http_encoding_quality(accept, "br") : 0;
+    int gzip = (variants & PRECOMPRESSED_GZIP) ? http_encoding_quality(accept, "gzip") : 0;
+    if (br > 0 && br >= gzip)
+    {
+        *suffix = ".br";
+        return "br";
+    }
+    if (gzip > 0)
+    {
+        *suffix = ".gz";
+        return "gzip";
+    }
+    return NULL;
+}
+
+// 靜態檔案沒有路由表，所有請求共用同一組延遲分佈
+static LatencyRoute *static_latency_route(void)
+{
+    static LatencyRoute *route = NULL;
+    LatencyRoute *current = __atomic_load_n(&route, __ATOMIC_ACQUIRE);
+    if (!current)
+    {
+        current = latency_route("GET static");
+        __atomic_store_n(&route, current, __ATOMIC_RELEASE);
+    }
+    return current;
+}
+
+#ifdef HAVE_EMBEDDED_ASSETS
+// 從編譯進執行檔的資源送出：標頭與內容都已備妥，不需要任何檔案系統操作
+static void serve_embedded(int client_socket, const EmbeddedAsset *asset, const char *request, EntityInfo *info,
+                           const Preconditions *cond)
+{
+    const EmbeddedVariant *variant = &asset->identity;
+    if (asset->gzip.header)
+    {
+        info->vary_encoding = 1;
+        char accept[256];
+        if (!cond->range[0] && http_find_header(request, "Accept-Encoding", accept, sizeof(accept)) >= 0 &&
+            http_encoding_quality(accept, "gzip") > 0)
+        {
+            variant = &asset->gzip;
+            info->content_encoding = "gzip";
+        }
+    }
+    snprintf(info->validator.etag, sizeof(info->validator.etag), "%s", variant->etag);
+    info->validator.mtime = asset->mtime;
+
+    latency_mark(LAT_HANDLED);
+    if (is_not_modified(cond, &info->validator))
+    {
+        send_not_modified(client_socket, info, &info->validator);
+        return;
+    }
+
+    const char *body = (const char *)variant->body;
+    long long size = (long long)variant->body_len;
+    if (cond->range[0])
+    {
+        HttpRange ranges[HTTP_MAX_RANGES];
+        int count = -1;
+        if (if_range_matches(cond->if_range, &info->validator))
+            count = http_parse_range(cond->range, size, ranges, HTTP_MAX_RANGES);
+        if (count == 0)
+        {
+            send_range_not_satisfiable(client_socket, size);
+            return;
+        }
+        if (count > 0)
+        {
+            send_ranges(client_socket, info, ranges, count, size, body, -1);
+            return;
+        }
+    }
+
+    // 實體標頭由 embed_gen 保證小於 EMBEDDED_HEADER_MAX，Cache-Control 不超過 CACHE_POLICY_MAX_VALUE，
+    // 其餘 256 位元組放狀態列、Server 與 Connection
+    char header[EMBEDDED_HEADER_MAX + CACHE_POLICY_MAX_VALUE + 256];
+    int header_len = format_status_line(header, sizeof(header), "200 OK");
+    header_len += snprintf(header + header_len, sizeof(header) - header_len, "Server: Simple C Server\r\n");
+    memcpy(header + header_len, variant->header, variant->header_len);
+    header_len += variant->header_len;
+    if (info->cache_control)
+        header_len += snprintf(header + header_len, sizeof(header) - header_len, "Cache-Control: %s\r\n",
+                               info->cache_control);
+    header_len += snprintf(header + header_len, sizeof(header) - header_len, "Connection: close\r\n\r\n");
+
+    size_t body_len = cond->head_only ? 0 : variant->body_len;
+    size_t sent = send_two_parts(client_socket, header, header_len, body, body_len);
+    latency_mark(LAT_SENT);
+    metrics_http_response(200, sent);
+}
+#endif
+
+// 目錄沒有 index.html 時的列表；?page=N&limit=M 分頁，?format=json 或 Accept: application/json 時輸出 JSON
+// dir_path 為目錄的完整路徑（不含結尾 '/'），url_path 為網址路徑（以 '/' 結尾）
+static int serve_autoindex(int client_socket, const VirtualHost *host, const char *request, const char *target,
+                           const char *dir_path, const char *url_path, int head_only)
+{
+    AutoindexListing *listing = autoindex_get(host->autoindex, host->root_fd, dir_path, host->root_len);
+    if (!listing)
+        return -1;
+
+    char value[64];
+    int json = http_query_param(target, "format", value, sizeof(value)) >= 0 && strcmp(value, "json") == 0;
+    if (!json && http_find_header(request, "Accept", value, sizeof(value)) >= 0)
+        json = strstr(value, "application/json") != NULL;
+    int limit = http_query_param(target, "limit", value, sizeof(value)) > 0 ? atoi(value) : AUTOINDEX_PAGE_SIZE;
+    if (limit <= 0 || limit > AUTOINDEX_MAX_PAGE_SIZE)
+        limit = limit <= 0 ? AUTOINDEX_PAGE_SIZE : AUTOINDEX_MAX_PAGE_SIZE;
+    long long page = http_query_param(target, "page", value, sizeof(value)) > 0 ? strtoll(value, NULL, 10) : 1;
+    if (page < 1)
+        page = 1;
+    // 先限制在最後一頁的下一頁（列表為空），相乘時不會溢位
+    if (page > listing->count / limit + 1)
+        page = listing->count / limit + 1;
+    int offset = (int)(page - 1) * limit;
+    if (offset > listing->count)
+        offset = listing->count;
+
+    size_t body_len;
+    char *body = autoindex_render(listing, url_path, offset, limit, json, &body_len);
+    autoindex_release(listing);
+    if (!body)
+        return -1;
+
+    EntityInfo info = {0};
+    info.content_type = json ? "application/json" : "text/html; charset=utf-8";
+    info.cache_control = "no-cache";
+    latency_mark(LAT_HANDLED);
+    int header_len = send_headers(client_socket, "200 OK", &info, body_len);
+    int sent = head_only ? 0 : send_all(client_socket, body, (int)body_len);
+    free(body);
+    latency_mark(LAT_SENT);
+    metrics_http_response(200, header_len + sent);
+    return 0;
+}
+
+// OPTIONS 與 405：預先組好的回應只需加上狀態列與 Date
+static void send_fixed_response(int client_socket, const char *status, const char *response, size_t response_len)
+{
+    char status_line[128];
+    int status_len = format_status_line(status_line, sizeof(status_line), status);
+    size_t sent = send_two_parts(client_socket, status_line, status_len, response, response_len);
+    latency_mark(LAT_SENT);
+    metrics_http_response(atoi(status), sent);
+}
+
+// "/dir" 指向目錄時導向 "/dir/"，讓列表中的相對連結正確（保留查詢字串）
+static void send_directory_redirect(int client_socket, const char *target)
+{
+    const char *query = strchr(target, '?');
+    int path_len = query ? (int)(query - target) : (int)strlen(target);
+
+    char header[1024];
+    int header_len = format_status_line(header, sizeof(header), "301 Moved Permanently");
+    header_len += snprintf(header + header_len, sizeof(header) - header_len,
+                           "Server: Simple C Server\r\nLocation: %.*s/%s\r\nContent-Length: 0\r\n"
+                           "Connection: close\r\n\r\n",
+                           path_len, target, query ? query : "");
+    if (header_len >= (int)sizeof(header))
+        header_len = sizeof(header) - 1;
+    send_all(client_socket, header, header_len);
+    latency_mark(LAT_SENT);
+    metrics_http_response(301, header_len);
+}
+
+// 解碼並正規化請求目標，直接寫在 host 的文件根目錄之後；".." 已在這裡解析，
+// 符號連結則由 openat2 確保不會離開根目錄。以 '/' 結尾時加上 index.html
+// 回傳正規化後網址路徑的長度（不含 index.html），格式錯誤時回傳 -1
+static int resolve_path(const VirtualHost *host, const char *target, char *full_path, size_t size)
+{
+    memcpy(full_path, host->root, host->root_len);
+    char *path_start = full_path + host->root_len;
+    int path_len = http_normalize_path(target, path_start, size - host->root_len - sizeof("index.html"));
+    if (path_len > 0 && path_start[path_len - 1] == '/')
+        memcpy(path_start + path_len, "index.html", sizeof("index.html"));
+    return path_len;
+}
+
+long long static_handler_warm(const char *host_name, const char *path)
+{
+    VirtualHost *host = vhost_lookup(host_name);
+    if (!host)
+        host = &g_default_host;
+
+    char full_path[1024];
+    if (resolve_path(host, path, full_path, sizeof(full_path)) < 0)
+        return -1;
+    const char *url_path = full_path + host->root_len;
+#ifdef HAVE_EMBEDDED_ASSETS
+    if (host == &g_default_host && embedded_lookup(url_path))
+        return 0; // 已在執行檔中
+#endif
+
+    // 與 handle_client 相同的實體標頭，預先組好的標頭才會與實際回應一致
+    const MimeType *mime = mime_lookup(url_path);
+    EntityInfo info = {mime->type, NULL, 0, cache_policy_lookup(url_path), {{0}, 0}, mime};
+    int dynamic_compression = host->file_cache && compress_available() && compress_is_compressible(info.content_type);
+    int variants = precompressed_lookup(host->precompressed, full_path);
+    if (dynamic_compression || variants)
+        info.vary_encoding = 1;
+
+    Preconditions cond;
+    memset(&cond, 0, sizeof(cond));
+    cond.if_modified_since = -1;
+
+    // 壓縮版本的世代值與原始檔一樣在讀取內容之前取得（見 serve_compressed）
+    const CompressCodec codecs[] = {COMPRESS_GZIP, COMPRESS_ZSTD};
+    uint64_t key_generations[2] = {0, 0};
+    for (size_t i = 0; dynamic_compression && i < 2; i++)
+    {
+        char key[1100];
+        snprintf(key, sizeof(key), "%s#%s", full_path, compress_encoding_name(codecs[i]));
+        key_generations[i] = file_cache_generation(host->file_cache, key);
+    }
+
+    uint64_t generation = host->file_cache ? file_cache_generation(host->file_cache, full_path) : 0;
+    OpenFileHandle opened;
+    EntityInfo file;
+    FileCacheEntry *identity = load_cached(host, full_path, &info, generation, &opened, &file, 1);
+    long long bytes;
+    if (identity)
+    {
+        bytes = identity->body_len;
+        for (size_t i = 0; dynamic_compression && identity->body_len >= COMPRESS_MIN_SIZE && i < 2; i++)
+        {
+            // 只預先壓縮有編譯進來的方式
+            if (compress_negotiate(compress_encoding_name(codecs[i])) != codecs[i])
+                continue;
+            char key[1100];
+            snprintf(key, sizeof(key), "%s#%s", full_path, compress_encoding_name(codecs[i]));
+            FileCacheEntry *entry = file_cache_get(host->file_cache, key);
+            if (!entry)
+                entry = cache_compressed(host, key, key_generations[i], identity, &info, codecs[i]);
+            file_cache_release(entry);
+        }
+        file_cache_release(identity);
+    }
+    else if (opened.fd >= 0)
+    {
+        // 超過快取上限的檔案保持開啟，並提示核心預先讀入 page cache
+        bytes = opened.stat.size;
+#ifdef __linux__
+        posix_fadvise(opened.fd, 0, opened.stat.size, POSIX_FADV_WILLNEED);
+#endif
+        open_file_cache_close(&opened);
+    }
+    else
+    {
+        return -1;
+    }
+
+    // 預先壓縮的 .br / .gz 檔
+    const char *suffixes[] = {".br", ".gz"};
+    const char *encodings[] = {"br", "gzip"};
+    const int masks[] = {PRECOMPRESSED_BR, PRECOMPRESSED_GZIP};
+    for (int i = 0; i < 2; i++)
+    {
+        if (!(variants & masks[i]))
+            continue;
+        char variant_path[1040];
+        snprintf(variant_path, sizeof(variant_path), "%s%s", full_path, suffixes[i]);
+        EntityInfo variant = info;
+        variant.content_encoding = encodings[i];
+        uint64_t variant_generation = host->file_cache ? file_cache_generation(host->file_cache, variant_path) : 0;
+        FileCacheEntry *entry = load_cached(host, variant_path, &variant, variant_generation, &opened, &file, 1);
+        if (entry)
+            file_cache_release(entry);
+        else if (opened.fd >= 0)
+            open_file_cache_close(&opened);
+    }
+    return bytes;
 }
 
 void handle_client(int client_socket)
@@ -51,59 +1114,172 @@ void handle_client(int client_socket)
     }
 
     buffer[received] = '\0';
+    latency_mark(LAT_FIRST_BYTE);
+    metrics_http_request(received);
 
     // 解析 HTTP 請求
     char method[16], path[256], version[16];
-    if (sscanf(buffer, "%s %s %s", method, path, version) != 3)
+    if (sscanf(buffer, "%15s %255s %15s", method, path, version) != 3)
     {
         send_response(client_socket, "400 Bad Request", "text/plain", "Bad Request", 11);
         return;
     }
 
+    latency_mark(LAT_PARSED);
+    latency_set_route(static_latency_route());
     log_message(LOG_INFO, "%s %s", method, path);
 
-    // 只支援 GET 方法
-    if (strcmp(method, "GET") != 0)
+    // GET 與 HEAD 走相同的流程；OPTIONS 與其他方法直接以預先組好的回應處理
+    int head_only = strcmp(method, "HEAD") == 0;
+    if (!head_only && strcmp(method, "GET") != 0)
     {
-        send_response(client_socket, "405 Method Not Allowed", "text/plain", "Method Not Allowed", 18);
+        if (strcmp(method, "OPTIONS") == 0)
+            send_fixed_response(client_socket, "204 No Content", g_options_response, sizeof(g_options_response) - 1);
+        else
+            send_fixed_response(client_socket, "405 Method Not Allowed", g_method_not_allowed_response,
+                                sizeof(g_method_not_allowed_response) - 1);
         return;
     }
 
-    // 處理路徑
-    if (strcmp(path, "/") == 0)
+    // 依 Host 選擇網站，沒有 Host 或不符合任何虛擬主機時使用預設網站
+    VirtualHost *host = &g_default_host;
+    char host_name[256];
+    if (vhost_count() > 0 && http_find_header(buffer, "Host", host_name, sizeof(host_name)) >= 0)
     {
-        strcpy(path, "/index.html");
+        VirtualHost *match = vhost_lookup(host_name);
+        if (match)
+            host = match;
     }
 
-    // 安全檢查：防止路徑遍歷
-    if (strstr(path, "..") != NULL)
+    char full_path[1024];
+    int path_len = resolve_path(host, path, full_path, sizeof(full_path));
+    if (path_len < 0)
     {
-        send_response(client_socket, "403 Forbidden", "text/plain", "Forbidden", 9);
+        send_response(client_socket, "400 Bad Request", "text/plain", "Bad Request", 11);
         return;
     }
+    char *path_start = full_path + host->root_len;
+    int is_directory = path_start[path_len - 1] == '/';
+    const char *url_path = path_start;
 
-    // 建構完整檔案路徑
-    char full_path[512];
-    char cwd[256];
-    getcwd(cwd, sizeof(cwd));
-    snprintf(full_path, sizeof(full_path), "%s/www%s", cwd, path);
+    latency_mark(LAT_ROUTED);
+    const MimeType *mime = mime_lookup(url_path);
+    EntityInfo info = {mime->type, NULL, 0, cache_policy_lookup(url_path), {{0}, 0}, mime};
 
-    // 讀取檔案
-    char *file_content;
-    int file_size = read_file(full_path, &file_content);
+    Preconditions cond;
+    cond.if_modified_since = -1;
+    cond.head_only = head_only;
+    if (http_find_header(buffer, "If-None-Match", cond.if_none_match, sizeof(cond.if_none_match)) < 0)
+    {
+        cond.if_none_match[0] = '\0';
+        char since[64];
+        if (http_find_header(buffer, "If-Modified-Since", since, sizeof(since)) >= 0)
+            cond.if_modified_since = http_parse_date(since);
+    }
+    // Range 只適用於 GET，HEAD 回應完整內容的標頭
+    if (head_only || http_find_header(buffer, "Range", cond.range, sizeof(cond.range)) < 0)
+        cond.range[0] = '\0';
+    if (http_find_header(buffer, "If-Range", cond.if_range, sizeof(cond.if_range)) < 0)
+        cond.if_range[0] = '\0';
+
+#ifdef HAVE_EMBEDDED_ASSETS
+    // 內嵌的是預設網站的 www/
+    const EmbeddedAsset *asset = host == &g_default_host ? embedded_lookup(url_path) : NULL;
+    if (asset)
+    {
+        serve_embedded(client_socket, asset, buffer, &info, &cond);
+        warmup_record(host->name, url_path);
+        return;
+    }
+#endif
+
+    uint64_t generation = host->file_cache ? file_cache_generation(host->file_cache, full_path) : 0;
+
+    // 可即時壓縮的類型，回應內容會依 Accept-Encoding 而不同
+    int dynamic_compression = host->file_cache && compress_available() &&
+                              compress_is_compressible(info.content_type);
+    if (dynamic_compression)
+        info.vary_encoding = 1;
+
+    // 預先壓縮的 .br / .gz 檔
+    int variants = precompressed_lookup(host->precompressed, full_path);
+    if (variants)
+    {
+        info.vary_encoding = 1;
+        const char *suffix = NULL;
+        if (!cond.range[0]) // Range 只套用在原始內容上
+            info.content_encoding = choose_precompressed(buffer, variants, &suffix);
+        if (info.content_encoding)
+        {
+            char variant_path[1040];
+            snprintf(variant_path, sizeof(variant_path), "%s%s", full_path, suffix);
+            uint64_t variant_generation =
+                host->file_cache ? file_cache_generation(host->file_cache, variant_path) : 0;
+            if (serve_file(client_socket, host, variant_path, &info, variant_generation, &cond) == 0)
+            {
+                warmup_record(host->name, url_path);
+                return;
+            }
+            info.content_encoding = NULL; // 壓縮檔剛被刪除，改送原始檔
+        }
+    }
+
+    // 沒有預先壓縮檔時即時壓縮
+    if (dynamic_compression && !info.content_encoding && !cond.range[0])
+    {
+        char accept[256];
+        CompressCodec codec = COMPRESS_NONE;
+        if (http_find_header(buffer, "Accept-Encoding", accept, sizeof(accept)) >= 0)
+            codec = compress_negotiate(accept);
+        if (codec != COMPRESS_NONE &&
+            serve_compressed(client_socket, host, full_path, &info, generation, codec, &cond) == 0)
+        {
+            warmup_record(host->name, url_path);
+            return;
+        }
+    }
 
-    if (file_size < 0)
+    int result = cond.range[0] ? serve_range(client_socket, host, full_path, &info, generation, &cond)
+                               : serve_file(client_socket, host, full_path, &info, generation, &cond);
+    // 只記錄實際送出的檔案（200 / 206 / 304），404、重新導向與目錄列表不會佔用清單的路徑數上限；
+    // 關閉時寫出最常請求的路徑作為下次啟動的預熱清單（未啟用時不做任何事）
+    if (result == 0)
+        warmup_record(host->name, url_path);
+    if (result != 0 && g_autoindex_enabled)
+    {
+        // 沒有 index.html 的目錄改送列表；full_path 截掉 "/index.html" 即為目錄路徑
+        if (is_directory)
+        {
+            char url_dir[1024];
+            memcpy(url_dir, path_start, path_len);
+            url_dir[path_len] = '\0';
+            full_path[host->root_len + path_len - 1] = '\0';
+            result = serve_autoindex(client_socket, host, buffer, path, full_path, url_dir, cond.head_only);
+            full_path[host->root_len + path_len - 1] = '/';
+        }
+        else if (autoindex_is_directory(host->root_fd, full_path, host->root_len))
+        {
+            send_directory_redirect(client_socket, path);
+            return;
+        }
+    }
+    if (result != 0)
     {
         // 檔案不存在，返回 404 頁面
+        latency_mark(LAT_HANDLED);
         const char *not_found = "<html><body><h1>404 Not Found</h1></body></html>";
-        send_response(client_socket, "404 Not Found", "text/html", not_found, strlen(not_found));
+        if (head_only)
+        {
+            EntityInfo not_found_info = {0};
+            not_found_info.content_type = "text/html";
+            int header_len = send_headers(client_socket, "404 Not Found", &not_found_info, strlen(not_found));
+            latency_mark(LAT_SENT);
+            metrics_http_response(404, header_len);
+        }
+        else
+        {
+            send_response(client_socket, "404 Not Found", "text/html", not_found, strlen(not_found));
+        }
         log_message(LOG_WARNING, "File not found: %s", full_path);
     }
-    else
-    {
-        // 根據副檔名決定 Content-Type
-        const char *content_type = get_content_type(path);
-        send_response(client_socket, "200 OK", content_type, file_content, file_size);
-        free(file_content);
-    }
 }
\ No newline at end of file
@@ -0,0 +1,338 @@
+// open_file_cache.c - 開啟檔案快取實現
+//
+// 項目保存開啟的 fd 與 stat 結果，或「不存在」的結果（負快取），
+// 讓重複請求不必再走一次路徑解析與 open/fstat。fd 以參考計數共用，
+// 最後一個使用者釋放後才關閉。沒有 pread/sendfile 偏移量可用的平台
+// （Windows）不共用 fd，只快取不存在的路徑。
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "open_file_cache.h"
+#include "../core/latency.h"
+#include "../core/metrics.h"
+
+#ifdef _WIN32
+#define OPEN_FILE_CACHE_SHARE_FD 0
+#else
+#define OPEN_FILE_CACHE_SHARE_FD 1
+#endif
+
+typedef struct OpenFileEntry
+{
+    struct OpenFileCache *cache;
+    char *path;
+    uint32_t hash;
+    int fd;     // -1 表示路徑不存在
+    FileStat stat;
+    uint64_t expires;
+    int refcount; // 快取本身持有一份，每個使用中的請求再加一
+    int referenced;
+    int clock_index;
+    struct OpenFileEntry *next;
+} OpenFileEntry;
+
+typedef struct
+{
+    pthread_mutex_t mutex;
+    OpenFileEntry *buckets[OPEN_FILE_CACHE_BUCKETS];
+    OpenFileEntry **clock;
+    int clock_count;
+    int clock_hand;
+    uint64_t generation;
+} OpenFileShard;
+
+struct OpenFileCache
+{
+    OpenFileShard shards[OPEN_FILE_CACHE_SHARDS];
+    int shard_capacity;
+    uint64_t ttl_ns;
+    Metric *hits;
+    Metric *negative_hits;
+    Metric *misses;
+    Metric *open_files;
+};
+
+static uint32_t open_file_hash(const char *path)
+{
+    uint32_t hash = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)path; *p; p++)
+    {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static OpenFileShard *open_file_shard(OpenFileCache *cache, uint32_t hash)
+{
+    return &cache->shards[hash & (OPEN_FILE_CACHE_SHARDS - 1)];
+}
+
+static OpenFileEntry **open_file_bucket(OpenFileShard *shard, uint32_t hash)
+{
+    return &shard->buckets[(hash >> 4) % OPEN_FILE_CACHE_BUCKETS];
+}
+
+OpenFileCache *open_file_cache_create(int max_entries, int ttl_ms)
+{
+    OpenFileCache *cache = calloc(1, sizeof(OpenFileCache));
+    if (!cache)
+        return NULL;
+
+    cache->shard_capacity = max_entries / OPEN_FILE_CACHE_SHARDS;
+    if (cache->shard_capacity < 1)
+        cache->shard_capacity = 1;
+    cache->ttl_ns = (uint64_t)ttl_ms * 1000000ULL;
+
+    for (int i = 0; i < OPEN_FILE_CACHE_SHARDS; i++)
+    {
+        pthread_mutex_init(&cache->shards[i].mutex, NULL);
+        cache->shards[i].clock = calloc(cache->shard_capacity, sizeof(OpenFileEntry *));
+        if (!cache->shards[i].clock)
+        {
+            while (i >= 0)
+                free(cache->shards[i--].clock);
+            free(cache);
+            return NULL;
+        }
+    }
+
+    cache->hits = metrics_counter("static_open_file_hits_total", "Open file cache hits", NULL);
+    cache->negative_hits = metrics_counter("static_open_file_negative_hits_total",
+                                           "Requests for missing files answered from the open file cache", NULL);
+    cache->misses = metrics_counter("static_open_file_misses_total", "Open file cache misses", NULL);
+    cache->open_files = metrics_gauge("static_open_files", "File descriptors held by the open file cache", NULL);
+    return cache;
+}
+
+// 最後一份參考釋放時項目必定已離開快取，因此不需要分片鎖
+static void open_file_entry_release(OpenFileEntry *entry)
+{
+    if (__atomic_sub_fetch(&entry->refcount, 1, __ATOMIC_ACQ_REL) != 0)
+        return;
+    if (entry->fd >= 0)
+    {
+        close(entry->fd);
+        metrics_add(entry->cache->open_files, -1);
+    }
+    free(entry->path);
+    free(entry);
+}
+
+// 從雜湊表與 CLOCK 環移除（需持有分片鎖），並釋放快取持有的參考
+static void open_file_unlink(OpenFileShard *shard, OpenFileEntry *entry)
+{
+    OpenFileEntry **link = open_file_bucket(shard, entry->hash);
+    while (*link && *link != entry)
+        link = &(*link)->next;
+    if (*link)
+        *link = entry->next;
+
+    int index = entry->clock_index;
+    shard->clock_count--;
+    if (index != shard->clock_count)
+    {
+        shard->clock[index] = shard->clock[shard->clock_count];
+        shard->clock[index]->clock_index = index;
+    }
+    if (shard->clock_hand >= shard->clock_count)
+        shard->clock_hand = 0;
+
+    open_file_entry_release(entry);
+}
+
+static OpenFileEntry *open_file_find(OpenFileShard *shard, uint32_t hash, const char *path)
+{
+    OpenFileEntry *entry = *open_file_bucket(shard, hash);
+    while (entry && (entry->hash != hash || strcmp(entry->path, path) != 0))
+        entry = entry->next;
+    return entry;
+}
+
+// 把項目交給呼叫者；不存在的路徑回傳 -1
+static int open_file_use(OpenFileEntry *entry, OpenFileHandle *handle)
+{
+    if (entry->fd < 0)
+    {
+        handle->fd = -1;
+        errno = ENOENT;
+        return -1;
+    }
+    __atomic_add_fetch(&entry->refcount, 1, __ATOMIC_RELAXED);
+    handle->fd = entry->fd;
+    handle->stat = entry->stat;
+    handle->entry = entry;
+    return 0;
+}
+
+// 只快取「不存在」與「不是一般檔案」，其他錯誤（權限、fd 用盡）每次重試
+static int open_file_is_missing(int error)
+{
+    return error == ENOENT || error == ENOTDIR || error == EISDIR;
+}
+
+static int open_file_at_root(int root_fd, const char *path, size_t root_len, FileStat *stat)
+{
+    if (root_fd < 0)
+        return open_regular_file(path, stat);
+    const char *relative = path + root_len;
+    while (*relative == '/')
+        relative++;
+    return open_regular_file_beneath(root_fd, relative, stat);
+}
+
+int open_file_cache_open(OpenFileCache *cache, int root_fd, const char *path, size_t root_len,
+                         OpenFileHandle *handle)
+{
+    handle->entry = NULL;
+    if (!cache)
+    {
+        handle->fd = open_file_at_root(root_fd, path, root_len, &handle->stat);
+        return handle->fd < 0 ? -1 : 0;
+    }
+
+    uint32_t hash = open_file_hash(path);
+    OpenFileShard *shard = open_file_shard(cache, hash);
+    uint64_t now = latency_now();
+
+    pthread_mutex_lock(&shard->mutex);
+    OpenFileEntry *entry = open_file_find(shard, hash, path);
+    if (entry && entry->expires <= now)
+    {
+        open_file_unlink(shard, entry);
+        entry = NULL;
+    }
+    if (entry)
+    {
+        entry->referenced = 1;
+        int result = open_file_use(entry, handle);
+        pthread_mutex_unlock(&shard->mutex);
+        metrics_inc(result == 0 ? cache->hits : cache->negative_hits);
+        return result;
+    }
+    uint64_t generation = shard->generation;
+    pthread_mutex_unlock(&shard->mutex);
+    metrics_inc(cache->misses);
+
+    handle->fd = open_file_at_root(root_fd, path, root_len, &handle->stat);
+    int error = errno;
+    if (handle->fd < 0 && !open_file_is_missing(error))
+        return -1;
+    if (handle->fd >= 0 && !OPEN_FILE_CACHE_SHARE_FD)
+        return 0; // 只快取不存在的路徑
+
+    OpenFileEntry *created = calloc(1, sizeof(OpenFileEntry));
+    if (created)
+        created->path = strdup(path);
+    if (!created || !created->path)
+    {
+        free(created);
+        errno = error;
+        return handle->fd < 0 ? -1 : 0;
+    }
+    created->cache = cache;
+    created->hash = hash;
+    created->fd = handle->fd;
+    created->stat = handle->stat;
+    created->expires = now + cache->ttl_ns;
+    created->refcount = 1;
+
+    pthread_mutex_lock(&shard->mutex);
+    if (shard->generation != generation)
+    {
+        // 開啟期間檔案已變更，結果只用於這次請求
+        pthread_mutex_unlock(&shard->mutex);
+        free(created->path);
+        free(created);
+        errno = error;
+        return handle->fd < 0 ? -1 : 0;
+    }
+
+    entry = open_file_find(shard, hash, path);
+    if (entry)
+        open_file_unlink(shard, entry); // 其他執行緒同時開啟了相同路徑，以新的結果為準
+
+    // CLOCK 淘汰
+    while (shard->clock_count >= cache->shard_capacity)
+    {
+        OpenFileEntry *victim = shard->clock[shard->clock_hand];
+        if (victim->referenced)
+        {
+            victim->referenced = 0;
+            shard->clock_hand = (shard->clock_hand + 1) % shard->clock_count;
+            continue;
+        }
+        open_file_unlink(shard, victim);
+    }
+
+    OpenFileEntry **bucket = open_file_bucket(shard, hash);
+    created->next = *bucket;
+    *bucket = created;
+    created->clock_index = shard->clock_count;
+    shard->clock[shard->clock_count++] = created;
+    if (created->fd >= 0)
+    {
+        metrics_add(cache->open_files, 1);
+        open_file_use(created, handle);
+    }
+    pthread_mutex_unlock(&shard->mutex);
+
+    errno = error;
+    return handle->fd < 0 ? -1 : 0;
+}
+
+void open_file_cache_close(OpenFileHandle *handle)
+{
+    if (handle->entry)
+        open_file_entry_release(handle->entry);
+    else if (handle->fd >= 0)
+        close(handle->fd);
+    handle->entry = NULL;
+    handle->fd = -1;
+}
+
+static int open_file_path_under(const char *path, const char *prefix, size_t prefix_len)
+{
+    return strncmp(path, prefix, prefix_len) == 0 && (path[prefix_len] == '/' || path[prefix_len] == '\0');
+}
+
+void open_file_cache_invalidate(OpenFileCache *cache, const char *path, int is_prefix)
+{
+    if (!cache)
+        return;
+
+    if (!is_prefix)
+    {
+        uint32_t hash = open_file_hash(path);
+        OpenFileShard *shard = open_file_shard(cache, hash);
+        pthread_mutex_lock(&shard->mutex);
+        shard->generation++;
+        OpenFileEntry *entry = open_file_find(shard, hash, path);
+        if (entry)
+            open_file_unlink(shard, entry);
+        pthread_mutex_unlock(&shard->mutex);
+        return;
+    }
+
+    size_t prefix_len = strlen(path);
+    for (int i = 0; i < OPEN_FILE_CACHE_SHARDS; i++)
+    {
+        OpenFileShard *shard = &cache->shards[i];
+        pthread_mutex_lock(&shard->mutex);
+        shard->generation++;
+        for (int n = shard->clock_count - 1; n >= 0; n--)
+        {
+            if (n < shard->clock_count && open_file_path_under(shard->clock[n]->path, path, prefix_len))
+                open_file_unlink(shard, shard->clock[n]);
+        }
+        pthread_mutex_unlock(&shard->mutex);
+    }
+}
@@ -0,0 +1,36 @@
+// open_file_cache.h - 已開啟的檔案描述符與 stat 結果快取（含找不到的路徑），TTL 到期或 inotify 通知時失效
+#ifndef OPEN_FILE_CACHE_H
+#define OPEN_FILE_CACHE_H
+
+#include "../core/file_utils.h"
+
+#define OPEN_FILE_CACHE_SHARDS 16
+#define OPEN_FILE_CACHE_BUCKETS 256
+#define OPEN_FILE_CACHE_DEFAULT_MAX 512 // 同時保持開啟的檔案數上限（注意 RLIMIT_NOFILE）
+#define OPEN_FILE_CACHE_TTL_MS 5000     // 沒有變更通知時，結果最多沿用的時間
+
+typedef struct OpenFileCache OpenFileCache;
+
+// 開啟的檔案：fd 只能以指定偏移量的方式讀取（pread、sendfile），因為可能由多個請求共用
+typedef struct
+{
+    int fd;
+    FileStat stat;
+    void *entry; // 快取項目，NULL 表示 fd 屬於這次請求
+} OpenFileHandle;
+
+// max_entries 為快取項目上限（含不存在的路徑），ttl_ms 為項目有效時間
+OpenFileCache *open_file_cache_create(int max_entries, int ttl_ms);
+
+// 開啟 path，成功回傳 0；檔案不存在或不是一般檔案時回傳 -1（可能來自負快取）
+// path 為快取鍵（完整路徑），前 root_len 個字元是根目錄；root_fd 不為 -1 時
+// 以 open_regular_file_beneath 從 root_fd 開啟其餘部分，不能跳出根目錄
+// cache 為 NULL 時每次都直接開啟；使用完畢需呼叫 open_file_cache_close
+int open_file_cache_open(OpenFileCache *cache, int root_fd, const char *path, size_t root_len,
+                         OpenFileHandle *handle);
+void open_file_cache_close(OpenFileHandle *handle);
+
+// 讓 path 失效；is_prefix 為 1 時讓所有以 path 為目錄前綴的項目失效
+void open_file_cache_invalidate(OpenFileCache *cache, const char *path, int is_prefix);
+
+#endif // OPEN_FILE_CACHE_H
@@ -0,0 +1,210 @@
+// precompressed.c - 預先壓縮檔查詢實現
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "precompressed.h"
+
+typedef struct PrecompressedEntry
+{
+    char *path;
+    uint32_t hash;
+    int mask;
+    struct PrecompressedEntry *next;
+} PrecompressedEntry;
+
+typedef struct
+{
+    pthread_mutex_t mutex;
+    PrecompressedEntry *buckets[PRECOMPRESSED_BUCKETS];
+    int count;
+} PrecompressedShard;
+
+struct PrecompressedIndex
+{
+    PrecompressedShard shards[PRECOMPRESSED_SHARDS];
+};
+
+static uint32_t precompressed_hash(const char *path, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= (unsigned char)path[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static int precompressed_exists(const char *full_path, const char *suffix)
+{
+    char path[1024];
+    snprintf(path, sizeof(path), "%s%s", full_path, suffix);
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISREG(st.st_mode);
+}
+
+static int precompressed_probe(const char *full_path)
+{
+    int mask = 0;
+    if (precompressed_exists(full_path, ".br"))
+        mask |= PRECOMPRESSED_BR;
+    if (precompressed_exists(full_path, ".gz"))
+        mask |= PRECOMPRESSED_GZIP;
+    return mask;
+}
+
+PrecompressedIndex *precompressed_create(void)
+{
+    PrecompressedIndex *index = calloc(1, sizeof(PrecompressedIndex));
+    if (!index)
+        return NULL;
+    for (int i = 0; i < PRECOMPRESSED_SHARDS; i++)
+        pthread_mutex_init(&index->shards[i].mutex, NULL);
+    return index;
+}
+
+static void precompressed_clear_shard(PrecompressedShard *shard)
+{
+    for (int b = 0; b < PRECOMPRESSED_BUCKETS; b++)
+    {
+        PrecompressedEntry *entry = shard->buckets[b];
+        while (entry)
+        {
+            PrecompressedEntry *next = entry->next;
+            free(entry->path);
+            free(entry);
+            entry = next;
+        }
+        shard->buckets[b] = NULL;
+    }
+    shard->count = 0;
+}
+
+int precompressed_lookup(PrecompressedIndex *index, const char *full_path)
+{
+    // 壓縮檔本身不再尋找壓縮檔
+    if (precompressed_base_length(full_path))
+        return 0;
+    if (!index)
+        return precompressed_probe(full_path);
+
+    uint32_t hash = precompressed_hash(full_path, strlen(full_path));
+    PrecompressedShard *shard = &index->shards[hash & (PRECOMPRESSED_SHARDS - 1)];
+    PrecompressedEntry **bucket = &shard->buckets[(hash >> 4) % PRECOMPRESSED_BUCKETS];
+
+    pthread_mutex_lock(&shard->mutex);
+    for (PrecompressedEntry *entry = *bucket; entry; entry = entry->next)
+    {
+        if (entry->hash == hash && strcmp(entry->path, full_path) == 0)
+        {
+            int mask = entry->mask;
+            pthread_mutex_unlock(&shard->mutex);
+            return mask;
+        }
+    }
+
+    // 未命中時在鎖內 stat，避免和失效通知交錯而留下過期結果
+    int mask = precompressed_probe(full_path);
+    if (shard->count >= PRECOMPRESSED_MAX_ENTRIES)
+        precompressed_clear_shard(shard);
+
+    PrecompressedEntry *entry = malloc(sizeof(PrecompressedEntry));
+    if (entry)
+    {
+        entry->path = strdup(full_path);
+        if (entry->path)
+        {
+            entry->hash = hash;
+            entry->mask = mask;
+            entry->next = *bucket;
+            *bucket = entry;
+            shard->count++;
+        }
+        else
+        {
+            free(entry);
+        }
+    }
+    pthread_mutex_unlock(&shard->mutex);
+    return mask;
+}
+
+size_t precompressed_base_length(const char *path)
+{
+    size_t len = strlen(path);
+    if (len > 3 && strcmp(path + len - 3, ".br") == 0)
+        return len - 3;
+    if (len > 3 && strcmp(path + len - 3, ".gz") == 0)
+        return len - 3;
+    return 0;
+}
+
+static int precompressed_path_under(const char *path, const char *prefix, size_t prefix_len)
+{
+    return strncmp(path, prefix, prefix_len) == 0 && (path[prefix_len] == '/' || path[prefix_len] == '\0');
+}
+
+void precompressed_invalidate(PrecompressedIndex *index, const char *path, int is_prefix)
+{
+    if (!index)
+        return;
+
+    if (is_prefix)
+    {
+        size_t prefix_len = strlen(path);
+        for (int i = 0; i < PRECOMPRESSED_SHARDS; i++)
+        {
+            PrecompressedShard *shard = &index->shards[i];
+            pthread_mutex_lock(&shard->mutex);
+            for (int b = 0; b < PRECOMPRESSED_BUCKETS; b++)
+            {
+                PrecompressedEntry **link = &shard->buckets[b];
+                while (*link)
+                {
+                    PrecompressedEntry *entry = *link;
+                    if (precompressed_path_under(entry->path, path, prefix_len))
+                    {
+                        *link = entry->next;
+                        free(entry->path);
+                        free(entry);
+                        shard->count--;
+                    }
+                    else
+                    {
+                        link = &entry->next;
+                    }
+                }
+            }
+            pthread_mutex_unlock(&shard->mutex);
+        }
+        return;
+    }
+
+    size_t len = precompressed_base_length(path);
+    if (len == 0)
+        len = strlen(path);
+
+    uint32_t hash = precompressed_hash(path, len);
+    PrecompressedShard *shard = &index->shards[hash & (PRECOMPRESSED_SHARDS - 1)];
+    PrecompressedEntry **link = &shard->buckets[(hash >> 4) % PRECOMPRESSED_BUCKETS];
+
+    pthread_mutex_lock(&shard->mutex);
+    while (*link)
+    {
+        PrecompressedEntry *entry = *link;
+        if (entry->hash == hash && strncmp(entry->path, path, len) == 0 && entry->path[len] == '\0')
+        {
+            *link = entry->next;
+            free(entry->path);
+            free(entry);
+            shard->count--;
+            break;
+        }
+        link = &entry->next;
+    }
+    pthread_mutex_unlock(&shard->mutex);
+}
@@ -0,0 +1,26 @@
+// precompressed.h - 預先壓縮檔（file.br / file.gz）查詢，結果快取並由 inotify 失效
+#ifndef PRECOMPRESSED_H
+#define PRECOMPRESSED_H
+
+#define PRECOMPRESSED_GZIP 0x1
+#define PRECOMPRESSED_BR 0x2
+
+#define PRECOMPRESSED_SHARDS 16
+#define PRECOMPRESSED_BUCKETS 1024
+#define PRECOMPRESSED_MAX_ENTRIES 8192 // 每個分片的上限，超過時清空該分片
+
+typedef struct PrecompressedIndex PrecompressedIndex;
+
+PrecompressedIndex *precompressed_create(void);
+
+// 回傳 full_path 旁存在的壓縮檔（PRECOMPRESSED_* 位元遮罩）
+// index 為 NULL 時每次都直接 stat（沒有變更通知的平台）
+int precompressed_lookup(PrecompressedIndex *index, const char *full_path);
+
+// 檔案變更通知；path 為 .br/.gz 時會讓對應的原始檔失效
+void precompressed_invalidate(PrecompressedIndex *index, const char *path, int is_prefix);
+
+// 若 path 是某個檔案的壓縮檔，回傳原始檔路徑的長度，否則回傳 0
+size_t precompressed_base_length(const char *path);
+
+#endif // PRECOMPRESSED_H
@@ -0,0 +1,28 @@
+// static_handler.h - 靜態檔案處理器的設定
+#ifndef STATIC_HANDLER_H
+#define STATIC_HANDLER_H
+
+#include <stddef.h>
+
+#include "cache_arena.h"
+
+#define STATIC_CACHE_DEFAULT_MB 64
+
+// 在 start_server 之前呼叫；root 為預設網站的文件根目錄，啟動時解析為絕對路徑
+// 以 vhost_add / vhost_load 加入的虛擬主機也在這裡建立各自的快取
+// cache_bytes 為 0 時不使用記憶體快取，一律以 sendfile 送出
+// open_files 為開啟檔案快取的項目上限，0 表示每個請求都重新開啟檔案
+void static_handler_init(const char *root, size_t cache_bytes, int open_files);
+
+// 目錄沒有 index.html 時產生列表（預設關閉），需在 static_handler_init 之前呼叫
+void static_handler_set_autoindex(int enabled);
+
+// 記憶體快取的項目來源（預設 CACHE_ARENA_HUGE_PAGES），需在 static_handler_init 之前呼叫
+void static_handler_set_cache_pages(CacheArenaMode mode);
+
+// 預熱一個檔案（static_handler_init 之後、start_server 之前呼叫，可由多個執行緒同時呼叫）：
+// 讀入記憶體快取並組好標頭、產生即時壓縮版本、載入預先壓縮檔；超過快取上限的檔案只預讀進 page cache
+// host 為主機名稱，不符合任何虛擬主機時使用預設網站；回傳檔案大小，找不到時回傳 -1
+long long static_handler_warm(const char *host, const char *path);
+
+#endif // STATIC_HANDLER_H
@@ -2,6 +2,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <signal.h>
+#include <errno.h>
+#include <pthread.h>
 #ifdef _WIN32
 #include <winsock2.h>
 #include <ws2tcpip.h>
@@ -16,12 +18,35 @@
 #include "../core/server.h"
 #include "../core/http_handler.h"
 #include "../core/logger.h"
+#include "../core/admin.h"
+#include "../core/latency.h"
+#include "../core/trace.h"
+#include "../core/mime.h"
+#include "../core/disk_io.h"
+#include "static_handler.h"
+#include "cache_policy.h"
+#include "open_file_cache.h"
+#include "vhost.h"
+#include "warmup.h"
 
 int server_socket = -1;
 int router_enabled = 0; // 不使用路由
 
+// 預熱清單：啟動時載入，指定 --warmup-record 時在關閉時以本次最常請求的路徑覆寫
+static const char *g_warmup_manifest = NULL;
+static int g_warmup_record = 0;
+
 void cleanup()
 {
+    if (g_warmup_manifest && g_warmup_record > 0)
+    {
+        int saved = warmup_save(g_warmup_manifest, g_warmup_record);
+        if (saved >= 0)
+            log_message(LOG_INFO, "Saved %d hot paths to %s", saved, g_warmup_manifest);
+        else
+            log_message(LOG_WARNING, "Cannot save hot paths to %s", g_warmup_manifest);
+    }
+
     if (server_socket != -1)
     {
 #ifdef _WIN32
@@ -33,31 +58,182 @@ void cleanup()
     }
 }
 
-void signal_handler(int sig)
+static void shutdown_server(void)
 {
     log_message(LOG_INFO, "Shutting down server...");
     cleanup();
     exit(0);
 }
 
-int main(int argc, char *argv[])
+void signal_handler(int sig)
 {
-    int port = DEFAULT_PORT;
+    (void)sig;
+    shutdown_server();
+}
+
+#ifndef _WIN32
+// cleanup 會取得鎖、配置記憶體並寫入檔案，都不能在信號處理函數中進行（信號可能打斷持有同一把鎖
+// 或正在 malloc 的執行緒）；信號處理函數只寫入 pipe，關閉流程在專用執行緒中進行
+static int g_shutdown_pipe[2] = {-1, -1};
 
-    if (argc > 1)
+static void shutdown_signal_handler(int sig)
+{
+    (void)sig;
+    int saved_errno = errno;
+    char c = 1;
+    if (write(g_shutdown_pipe[1], &c, 1) < 0)
     {
-        port = atoi(argv[1]);
+        // pipe 已滿時忽略，關閉流程已在進行
     }
+    errno = saved_errno;
+}
 
-    // 設置信號處理
-    signal(SIGINT, signal_handler);
+static void *shutdown_thread(void *arg)
+{
+    (void)arg;
+    char c;
+    while (read(g_shutdown_pipe[0], &c, 1) < 0 && errno == EINTR)
+        ;
+    shutdown_server();
+    return NULL;
+}
+#endif
+
+// SIGINT / SIGTERM 時寫入預熱清單並結束；Windows 的主控台信號本來就在另一個執行緒中處理
+static void install_shutdown_signals(void)
+{
 #ifndef _WIN32
+    pthread_t thread;
+    if (pipe(g_shutdown_pipe) == 0 && pthread_create(&thread, NULL, shutdown_thread, NULL) == 0)
+    {
+        pthread_detach(thread);
+        signal(SIGINT, shutdown_signal_handler);
+        signal(SIGTERM, shutdown_signal_handler);
+        return;
+    }
+    log_message(LOG_WARNING, "Cannot create shutdown thread, cleaning up in the signal handler");
     signal(SIGTERM, signal_handler);
 #endif
+    signal(SIGINT, signal_handler);
+}
+
+int main(int argc, char *argv[])
+{
+    int port = DEFAULT_PORT;
+    int metrics_port = 0;
+    const char *metrics_bind = NULL;
+    long cache_mb = STATIC_CACHE_DEFAULT_MB;
+    int open_files = OPEN_FILE_CACHE_DEFAULT_MAX;
+    int io_threads = DISK_IO_DEFAULT_THREADS;
+
+    const char *mime_types = NULL;
+    const char *vhosts = NULL;
+
+    // 參數：[port] [--metrics-port N] [--metrics-bind ADDR] [--cache-size MB] [--open-files N] [--io-threads N] [--vhosts FILE] [--warmup FILE] [--warmup-record N] [--autoindex] [--cache-pages huge|small|malloc] [--cache-policy RULE]... [--mime-types FILE] [--trace]
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--metrics-port") == 0 && i + 1 < argc)
+        {
+            metrics_port = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--metrics-bind") == 0 && i + 1 < argc)
+        {
+            metrics_bind = argv[++i]; // 預設只監聽 127.0.0.1
+        }
+        else if (strcmp(argv[i], "--cache-size") == 0 && i + 1 < argc)
+        {
+            cache_mb = atol(argv[++i]); // 0 表示停用記憶體快取
+        }
+        else if (strcmp(argv[i], "--open-files") == 0 && i + 1 < argc)
+        {
+            open_files = atoi(argv[++i]); // 0 表示停用開啟檔案快取
+        }
+        else if (strcmp(argv[i], "--io-threads") == 0 && i + 1 < argc)
+        {
+            io_threads = atoi(argv[++i]); // 0 表示在請求執行緒直接讀取
+        }
+        else if (strcmp(argv[i], "--vhosts") == 0 && i + 1 < argc)
+        {
+            vhosts = argv[++i];
+        }
+        else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+        {
+            g_warmup_manifest = argv[++i];
+        }
+        else if (strcmp(argv[i], "--warmup-record") == 0 && i + 1 < argc)
+        {
+            g_warmup_record = atoi(argv[++i]); // 關閉時寫入清單的路徑數
+        }
+        else if (strcmp(argv[i], "--autoindex") == 0)
+        {
+            static_handler_set_autoindex(1); // 沒有 index.html 的目錄回傳列表
+        }
+        else if (strcmp(argv[i], "--cache-pages") == 0 && i + 1 < argc)
+        {
+            // 記憶體快取的頁面類型：huge（預設，大頁面 arena）、small（一般頁面 arena）、malloc
+            const char *pages = argv[++i];
+            if (strcmp(pages, "huge") == 0)
+                static_handler_set_cache_pages(CACHE_ARENA_HUGE_PAGES);
+            else if (strcmp(pages, "small") == 0)
+                static_handler_set_cache_pages(CACHE_ARENA_SMALL_PAGES);
+            else if (strcmp(pages, "malloc") == 0)
+                static_handler_set_cache_pages(CACHE_ARENA_OFF);
+            else
+                fprintf(stderr, "Ignoring unknown cache page type: %s\n", pages);
+        }
+        else if (strcmp(argv[i], "--cache-policy") == 0 && i + 1 < argc)
+        {
+            // 例如 "/assets/=public, max-age=31536000, immutable" 或 ".html=no-cache"
+            const char *rule = argv[++i];
+            if (cache_policy_add(rule) != 0)
+                fprintf(stderr, "Ignoring invalid cache policy: %s\n", rule);
+        }
+        else if (strcmp(argv[i], "--mime-types") == 0 && i + 1 < argc)
+        {
+            mime_types = argv[++i];
+        }
+        else if (strcmp(argv[i], "--trace") == 0)
+        {
+            trace_set_enabled(1); // 也可以之後在指標埠上 POST /admin/trace/start 開啟
+        }
+        else
+        {
+            port = atoi(argv[i]);
+        }
+    }
 
     // 初始化日誌
     init_logger("server.log");
 
+    // 設置信號處理
+    install_shutdown_signals();
+    latency_install_dump_signal(); // kill -USR1 <pid> 輸出延遲報表
+
+    // MIME 類型：指定的檔案，或目前目錄下的 mime.types（存在時），其餘使用內建預設值
+    if (mime_types && mime_load(mime_types) < 0)
+        log_message(LOG_WARNING, "Cannot load MIME types from %s, using built-in defaults", mime_types);
+    else if (!mime_types)
+        mime_load("mime.types");
+
+    // 冷資料的讀取交給 I/O 執行緒
+    disk_io_start(io_threads > 0 ? io_threads : 0);
+
+    // 虛擬主機：未指定容量的主機與預設網站使用相同的上限
+    size_t cache_bytes = cache_mb > 0 ? (size_t)cache_mb * 1024 * 1024 : 0;
+    if (open_files < 0)
+        open_files = 0;
+    if (vhosts && vhost_load(vhosts, cache_bytes, open_files) < 0)
+        log_message(LOG_WARNING, "Cannot load virtual hosts from %s", vhosts);
+
+    // 文件根目錄（相對於目前目錄，初始化時解析一次）；Host 不符合任何虛擬主機時使用
+    static_handler_init("www", cache_bytes, open_files);
+
+    // 在開始接受連線前載入上一次的熱門檔案（清單不存在時略過，例如第一次啟動）
+    if (g_warmup_manifest && warmup_run(g_warmup_manifest, WARMUP_DEFAULT_THREADS, static_handler_warm) < 0)
+        log_message(LOG_INFO, "No warm-up manifest at %s", g_warmup_manifest);
+    if (g_warmup_manifest && g_warmup_record > 0)
+        warmup_start_recording();
+
     // 啟動伺服器
     server_socket = start_server(port);
     if (server_socket < 0)
@@ -67,6 +243,12 @@ int main(int argc, char *argv[])
     }
 
     log_message(LOG_INFO, "Server started on port %d", port);
+
+    // 選用的指標埠
+    if (metrics_port > 0 && admin_start(metrics_bind, metrics_port) != 0)
+    {
+        log_message(LOG_WARNING, "Metrics endpoint disabled");
+    }
     printf("Web server running on http://localhost:%d\n", port);
     printf("Press Ctrl+C to stop\n");
 
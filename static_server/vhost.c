@@ -0,0 +1,208 @@
+// vhost.c - 名稱式虛擬主機實現
+//
+// 主機表在啟動時建立，之後只會被讀取，因此查詢不需要鎖。
+// 每個請求只做一次 Host 正規化（小寫、去掉埠號與結尾的 '.'）與一次雜湊查詢。
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "vhost.h"
+#include "../core/logger.h"
+
+typedef struct VhostName
+{
+    char *name;
+    uint32_t hash;
+    VirtualHost *host;
+    struct VhostName *next;
+} VhostName;
+
+static VirtualHost g_hosts[VHOST_MAX_HOSTS];
+static int g_host_count = 0;
+static VhostName *g_names[VHOST_BUCKETS];
+
+static uint32_t vhost_hash(const char *name, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// 正規化主機名稱寫入 out：小寫，去掉埠號與結尾的 '.'；"[::1]:8080" 保留方括號內的部分
+static size_t vhost_normalize(const char *host, size_t len, char *out, size_t size)
+{
+    while (len > 0 && (*host == ' ' || *host == '\t'))
+    {
+        host++;
+        len--;
+    }
+    const char *end = host + len;
+    if (len > 0 && host[0] == '[')
+    {
+        const char *bracket = memchr(host, ']', len);
+        if (bracket)
+            end = bracket + 1;
+    }
+    else
+    {
+        const char *colon = memchr(host, ':', len);
+        if (colon)
+            end = colon;
+    }
+    while (end > host && (end[-1] == '.' || end[-1] == ' ' || end[-1] == '\t'))
+        end--;
+
+    size_t out_len = end - host;
+    if (out_len >= size)
+        return 0;
+    for (size_t i = 0; i < out_len; i++)
+        out[i] = (char)tolower((unsigned char)host[i]);
+    out[out_len] = '\0';
+    return out_len;
+}
+
+static VhostName *vhost_find(const char *name, size_t len, uint32_t hash)
+{
+    VhostName *entry = g_names[hash % VHOST_BUCKETS];
+    while (entry && (entry->hash != hash || strlen(entry->name) != len || memcmp(entry->name, name, len) != 0))
+        entry = entry->next;
+    return entry;
+}
+
+int vhost_add(const char *names, const char *root, size_t cache_bytes, int open_files)
+{
+    if (g_host_count >= VHOST_MAX_HOSTS)
+    {
+        log_message(LOG_WARNING, "Too many virtual hosts, ignoring %s", names);
+        return -1;
+    }
+
+    VirtualHost *host = &g_hosts[g_host_count];
+    memset(host, 0, sizeof(VirtualHost));
+    snprintf(host->root, sizeof(host->root), "%s", root);
+    host->root_fd = -1;
+    host->cache_bytes = cache_bytes;
+    host->open_files = open_files;
+
+    int added = 0;
+    const char *p = names;
+    while (*p)
+    {
+        const char *comma = strchr(p, ',');
+        size_t len = comma ? (size_t)(comma - p) : strlen(p);
+
+        char name[256];
+        size_t name_len = vhost_normalize(p, len, name, sizeof(name));
+        p += len + (comma ? 1 : 0);
+        if (name_len == 0)
+            continue;
+
+        uint32_t hash = vhost_hash(name, name_len);
+        if (vhost_find(name, name_len, hash))
+        {
+            log_message(LOG_WARNING, "Duplicate virtual host name %s, ignoring", name);
+            continue;
+        }
+
+        VhostName *entry = malloc(sizeof(VhostName));
+        if (!entry || !(entry->name = strdup(name)))
+        {
+            free(entry);
+            continue;
+        }
+        entry->hash = hash;
+        entry->host = host;
+        entry->next = g_names[hash % VHOST_BUCKETS];
+        g_names[hash % VHOST_BUCKETS] = entry;
+        if (added++ == 0)
+            snprintf(host->name, sizeof(host->name), "%s", name);
+    }
+
+    if (added == 0)
+        return -1;
+    g_host_count++;
+    return 0;
+}
+
+int vhost_load(const char *path, size_t cache_bytes, int open_files)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return -1;
+
+    char line[1024];
+    int line_number = 0;
+    int count = 0;
+    while (fgets(line, sizeof(line), file))
+    {
+        line_number++;
+        char *comment = strchr(line, '#');
+        if (comment)
+            *comment = '\0';
+
+        // 欄位：主機名稱、根目錄、快取 MB、開啟檔案數
+        char *fields[4] = {NULL, NULL, NULL, NULL};
+        int field_count = 0;
+        char *p = line;
+        while (*p && field_count < 5)
+        {
+            while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+                p++;
+            if (!*p)
+                break;
+            char *token = p;
+            while (*p && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+                p++;
+            if (*p)
+                *p++ = '\0';
+            if (field_count < 4)
+                fields[field_count] = token;
+            field_count++;
+        }
+        if (field_count == 0)
+            continue;
+        if (field_count < 2 || field_count > 4)
+        {
+            log_message(LOG_WARNING, "%s:%d: expected \"host[,alias...] root [cache-mb] [open-files]\"", path,
+                        line_number);
+            continue;
+        }
+
+        size_t host_cache = fields[2] ? (size_t)atol(fields[2]) * 1024 * 1024 : cache_bytes;
+        int host_open_files = fields[3] ? atoi(fields[3]) : open_files;
+        if (vhost_add(fields[0], fields[1], host_cache, host_open_files > 0 ? host_open_files : 0) == 0)
+            count++;
+    }
+    fclose(file);
+
+    log_message(LOG_INFO, "Loaded %d virtual hosts from %s", count, path);
+    return count;
+}
+
+VirtualHost *vhost_lookup(const char *host)
+{
+    if (g_host_count == 0)
+        return NULL;
+
+    char name[256];
+    size_t len = vhost_normalize(host, strlen(host), name, sizeof(name));
+    if (len == 0)
+        return NULL;
+    VhostName *entry = vhost_find(name, len, vhost_hash(name, len));
+    return entry ? entry->host : NULL;
+}
+
+int vhost_count(void)
+{
+    return g_host_count;
+}
+
+VirtualHost *vhost_get(int index)
+{
+    return index >= 0 && index < g_host_count ? &g_hosts[index] : NULL;
+}
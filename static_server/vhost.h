@@ -0,0 +1,47 @@
+// vhost.h - 名稱式虛擬主機：依 Host 標頭選擇文件根目錄，每個主機有自己的快取與容量上限
+#ifndef VHOST_H
+#define VHOST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "file_cache.h"
+#include "precompressed.h"
+#include "open_file_cache.h"
+#include "autoindex.h"
+
+#define VHOST_MAX_HOSTS 64
+#define VHOST_BUCKETS 128 // 主機名稱（含別名）雜湊表的桶數
+
+typedef struct
+{
+    char name[256];     // 第一個主機名稱（小寫），用於日誌與指標標籤；預設網站為 "default"
+    char root[512];     // 文件根目錄，static_handler_init 會解析為絕對路徑（不含結尾的 /）
+    size_t root_len;
+    int root_fd;        // 開啟檔案時的根目錄，不支援時為 -1
+    size_t cache_bytes; // 記憶體快取容量，0 表示不使用
+    int open_files;     // 開啟檔案快取的項目上限，0 表示不使用
+
+    // 以下由 static_handler_init 建立，之後不再改變
+    FileCache *file_cache;
+    PrecompressedIndex *precompressed;
+    OpenFileCache *open_file_cache;
+    AutoindexCache *autoindex;
+} VirtualHost;
+
+// 加入主機（應在 static_handler_init 之前呼叫），names 為以逗號分隔的主機名稱與別名
+// 名稱不分大小寫；重複的名稱或超過上限時回傳 -1
+int vhost_add(const char *names, const char *root, size_t cache_bytes, int open_files);
+
+// 讀取設定檔，每行 "主機[,別名...] 根目錄 [快取MB] [開啟檔案數]"，# 之後為註解
+// 省略的容量使用 cache_bytes / open_files；回傳加入的主機數，無法開啟檔案時回傳 -1
+int vhost_load(const char *path, size_t cache_bytes, int open_files);
+
+// 依 Host 標頭的值（可含埠號，例如 "Example.com:8080"）查詢主機，沒有符合的主機時回傳 NULL
+VirtualHost *vhost_lookup(const char *host);
+
+// 依加入順序走訪所有主機
+int vhost_count(void);
+VirtualHost *vhost_get(int index);
+
+#endif // VHOST_H
@@ -0,0 +1,312 @@
+// warmup.c - 啟動預熱實現
+//
+// 重新啟動後記憶體快取是空的，page cache 也可能已被換出，前幾分鐘的請求都要讀磁碟。
+// 在開始接受連線前依清單載入熱門檔案（內容、預先組好的標頭與壓縮版本），
+// 清單可以手動維護，也可以由上一次執行在關閉時依請求次數產生。
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "warmup.h"
+#include "../core/latency.h"
+#include "../core/logger.h"
+
+typedef struct WarmupPath
+{
+    char *host;
+    char *path;
+    uint32_t hash;
+    uint64_t hits;
+    struct WarmupPath *next;
+} WarmupPath;
+
+typedef struct
+{
+    pthread_mutex_t mutex;
+    WarmupPath *buckets[WARMUP_BUCKETS];
+    int count;
+} WarmupShard;
+
+static WarmupShard g_shards[WARMUP_SHARDS];
+static int g_recording = 0;
+static int g_path_count = 0;
+
+static uint32_t warmup_hash(const char *host, const char *path)
+{
+    uint32_t hash = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)host; *p; p++)
+    {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    hash ^= ' ';
+    hash *= 16777619u;
+    for (const unsigned char *p = (const unsigned char *)path; *p; p++)
+    {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void warmup_start_recording(void)
+{
+    for (int i = 0; i < WARMUP_SHARDS; i++)
+        pthread_mutex_init(&g_shards[i].mutex, NULL);
+    __atomic_store_n(&g_recording, 1, __ATOMIC_RELEASE);
+}
+
+void warmup_record(const char *host, const char *path)
+{
+    if (!__atomic_load_n(&g_recording, __ATOMIC_ACQUIRE))
+        return;
+
+    uint32_t hash = warmup_hash(host, path);
+    WarmupShard *shard = &g_shards[hash & (WARMUP_SHARDS - 1)];
+    WarmupPath **bucket = &shard->buckets[(hash >> 4) % WARMUP_BUCKETS];
+
+    pthread_mutex_lock(&shard->mutex);
+    for (WarmupPath *entry = *bucket; entry; entry = entry->next)
+    {
+        if (entry->hash == hash && strcmp(entry->path, path) == 0 && strcmp(entry->host, host) == 0)
+        {
+            entry->hits++;
+            pthread_mutex_unlock(&shard->mutex);
+            return;
+        }
+    }
+
+    if (__atomic_add_fetch(&g_path_count, 1, __ATOMIC_RELAXED) > WARMUP_MAX_PATHS)
+    {
+        __atomic_sub_fetch(&g_path_count, 1, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&shard->mutex);
+        return;
+    }
+    WarmupPath *entry = malloc(sizeof(WarmupPath));
+    if (entry)
+    {
+        entry->host = strdup(host);
+        entry->path = strdup(path);
+        if (entry->host && entry->path)
+        {
+            entry->hash = hash;
+            entry->hits = 1;
+            entry->next = *bucket;
+            *bucket = entry;
+            shard->count++;
+        }
+        else
+        {
+            free(entry->host);
+            free(entry->path);
+            free(entry);
+        }
+    }
+    pthread_mutex_unlock(&shard->mutex);
+}
+
+static int warmup_compare_hits(const void *a, const void *b)
+{
+    const WarmupPath *x = *(const WarmupPath *const *)a;
+    const WarmupPath *y = *(const WarmupPath *const *)b;
+    if (x->hits != y->hits)
+        return x->hits < y->hits ? 1 : -1;
+    return strcmp(x->path, y->path);
+}
+
+// 路徑以 %XX 寫出空白、'%'、'#'、'?' 與控制字元，讀回時由 http_normalize_path 解碼
+static void warmup_write_path(FILE *file, const char *path)
+{
+    for (const unsigned char *p = (const unsigned char *)path; *p; p++)
+    {
+        if (*p <= ' ' || *p == '%' || *p == '#' || *p == '?' || *p == 0x7f)
+            fprintf(file, "%%%02X", *p);
+        else
+            fputc(*p, file);
+    }
+}
+
+int warmup_save(const char *manifest, int top_n)
+{
+    if (!__atomic_load_n(&g_recording, __ATOMIC_ACQUIRE))
+        return -1;
+
+    // 停止記錄後才走訪各分片
+    __atomic_store_n(&g_recording, 0, __ATOMIC_RELEASE);
+    int count = __atomic_load_n(&g_path_count, __ATOMIC_RELAXED);
+    WarmupPath **paths = malloc((count > 0 ? count : 1) * sizeof(WarmupPath *));
+    if (!paths)
+        return -1;
+
+    int total = 0;
+    for (int i = 0; i < WARMUP_SHARDS; i++)
+    {
+        pthread_mutex_lock(&g_shards[i].mutex);
+        for (int b = 0; b < WARMUP_BUCKETS; b++)
+        {
+            for (WarmupPath *entry = g_shards[i].buckets[b]; entry && total < count; entry = entry->next)
+                paths[total++] = entry;
+        }
+        pthread_mutex_unlock(&g_shards[i].mutex);
+    }
+    qsort(paths, total, sizeof(WarmupPath *), warmup_compare_hits);
+
+    // 先寫入暫存檔再改名，中途被中斷時不會留下不完整的清單
+    char temp[1024];
+    snprintf(temp, sizeof(temp), "%s.tmp", manifest);
+    FILE *file = fopen(temp, "w");
+    if (!file)
+    {
+        free(paths);
+        return -1;
+    }
+    if (top_n > total)
+        top_n = total;
+    fprintf(file, "# hottest %d of %d paths, written on shutdown: host path hits\n", top_n, total);
+    for (int i = 0; i < top_n; i++)
+    {
+        fprintf(file, "%s ", paths[i]->host);
+        warmup_write_path(file, paths[i]->path);
+        fprintf(file, " # %llu\n", (unsigned long long)paths[i]->hits);
+    }
+    free(paths);
+    if (fclose(file) != 0 || rename(temp, manifest) != 0)
+    {
+        remove(temp);
+        return -1;
+    }
+    return top_n;
+}
+
+typedef struct
+{
+    char *host;
+    char *path;
+} WarmupItem;
+
+typedef struct
+{
+    WarmupItem *items;
+    int count;
+    int next;   // 下一個要處理的項目（以原子操作遞增）
+    int loaded;
+    long long bytes;
+    WarmupLoader loader;
+} WarmupJob;
+
+static void *warmup_worker(void *arg)
+{
+    WarmupJob *job = arg;
+    int index;
+    while ((index = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) < job->count)
+    {
+        long long bytes = job->loader(job->items[index].host, job->items[index].path);
+        if (bytes >= 0)
+        {
+            __atomic_add_fetch(&job->loaded, 1, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&job->bytes, bytes, __ATOMIC_RELAXED);
+        }
+    }
+    return NULL;
+}
+
+// 解析一行：以 '/' 開頭時整行是預設網站的路徑，否則第一個欄位是主機名稱
+static int warmup_parse_line(char *line, WarmupItem *item)
+{
+    char *comment = strchr(line, '#');
+    if (comment)
+        *comment = '\0';
+    char *p = line;
+    while (*p == ' ' || *p == '\t')
+        p++;
+    char *end = p + strlen(p);
+    while (end > p && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r' || end[-1] == '\n'))
+        *--end = '\0';
+    if (!*p)
+        return -1;
+
+    const char *host = "default";
+    if (*p != '/')
+    {
+        host = p;
+        while (*p && *p != ' ' && *p != '\t')
+            p++;
+        if (*p)
+            *p++ = '\0';
+        while (*p == ' ' || *p == '\t')
+            p++;
+        if (*p != '/')
+            return -1;
+    }
+    item->host = strdup(host);
+    item->path = strdup(p);
+    if (!item->host || !item->path)
+    {
+        free(item->host);
+        free(item->path);
+        return -1;
+    }
+    return 0;
+}
+
+int warmup_run(const char *manifest, int threads, WarmupLoader loader)
+{
+    FILE *file = fopen(manifest, "r");
+    if (!file)
+        return -1;
+
+    WarmupJob job = {NULL, 0, 0, 0, 0, loader};
+    int capacity = 0;
+    char line[1300];
+    while (fgets(line, sizeof(line), file))
+    {
+        WarmupItem item;
+        if (warmup_parse_line(line, &item) != 0)
+            continue;
+        if (job.count == capacity)
+        {
+            int new_capacity = capacity ? capacity * 2 : 256;
+            WarmupItem *items = realloc(job.items, new_capacity * sizeof(WarmupItem));
+            if (!items)
+            {
+                free(item.host);
+                free(item.path);
+                break;
+            }
+            job.items = items;
+            capacity = new_capacity;
+        }
+        job.items[job.count++] = item;
+    }
+    fclose(file);
+
+    uint64_t start = latency_now();
+    if (threads < 1)
+        threads = 1;
+    if (threads > job.count)
+        threads = job.count > 0 ? job.count : 1;
+
+    // 呼叫者自己也處理項目，建立執行緒失敗時仍會完成
+    pthread_t *workers = malloc(threads * sizeof(pthread_t));
+    int started = 0;
+    while (workers && started < threads - 1 && pthread_create(&workers[started], NULL, warmup_worker, &job) == 0)
+        started++;
+    warmup_worker(&job);
+    for (int i = 0; i < started; i++)
+        pthread_join(workers[i], NULL);
+    free(workers);
+
+    for (int i = 0; i < job.count; i++)
+    {
+        free(job.items[i].host);
+        free(job.items[i].path);
+    }
+    free(job.items);
+
+    log_message(LOG_INFO, "Warm-up: %d of %d files from %s (%lld KB) in %llu ms with %d threads", job.loaded,
+                job.count, manifest, job.bytes / 1024, (unsigned long long)((latency_now() - start) / 1000000),
+                started + 1);
+    return job.loaded;
+}
@@ -0,0 +1,26 @@
+// warmup.h - 啟動預熱：依清單平行預先載入熱門檔案，並可在關閉時記錄本次最常請求的路徑
+#ifndef WARMUP_H
+#define WARMUP_H
+
+#define WARMUP_SHARDS 16
+#define WARMUP_BUCKETS 256         // 每個分片的雜湊桶數
+#define WARMUP_MAX_PATHS 16384     // 記錄的不同路徑數上限，超過後新路徑不再計數
+#define WARMUP_DEFAULT_THREADS 4
+
+// 預先載入一個檔案，回傳載入的位元組數，找不到時回傳 -1
+// host 為清單中的主機名稱（預設網站為 "default"），path 為網址路徑（可含 %XX）
+typedef long long (*WarmupLoader)(const char *host, const char *path);
+
+// 清單格式：每行 "[主機] /路徑"，# 之後為註解；以 '/' 開頭的行屬於預設網站
+// 以 threads 個執行緒平行呼叫 loader，全部完成後才回傳（應在 start_server 之前呼叫）
+// 回傳載入的檔案數，無法開啟清單時回傳 -1
+int warmup_run(const char *manifest, int threads, WarmupLoader loader);
+
+// 開始記錄每個路徑的請求次數（預設不記錄，warmup_record 不做任何事）
+void warmup_start_recording(void);
+void warmup_record(const char *host, const char *path);
+
+// 把請求次數最多的 top_n 個路徑寫入清單，回傳寫入的行數，失敗時回傳 -1
+int warmup_save(const char *manifest, int top_n);
+
+#endif // WARMUP_H
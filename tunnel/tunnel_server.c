@@ -1,6 +1,8 @@
 // tunnel_server.c - 隧道服務器（運行在公網VPS）
 #include "tunnel_common.h"
 #include "logger.h"
+#include "metrics.h"
+#include "admin.h"
 #include <signal.h>
 #include <time.h>
 
@@ -37,6 +39,30 @@ typedef struct
 
 static TunnelServer *g_server = NULL;
 
+// 執行期指標
+static Metric *g_http_requests = NULL;
+static Metric *g_clients_active = NULL;
+static Metric *g_bytes_to_tunnel = NULL;
+static Metric *g_bytes_to_client = NULL;
+static Metric *g_errors_bad_request = NULL;
+static Metric *g_errors_no_tunnel = NULL;
+static Metric *g_errors_data_timeout = NULL;
+static Metric *g_errors_handshake = NULL;
+
+static void init_metrics(void)
+{
+    g_http_requests = metrics_counter("tunnel_http_requests_total", "Public HTTP requests received", NULL);
+    g_clients_active = metrics_gauge("tunnel_clients_active", "Tunnel clients currently connected", NULL);
+    g_bytes_to_tunnel = metrics_counter("tunnel_bytes_total", "Bytes relayed through tunnels", "direction=\"to_tunnel\"");
+    g_bytes_to_client = metrics_counter("tunnel_bytes_total", "Bytes relayed through tunnels", "direction=\"to_client\"");
+
+    const char *errors_help = "Public HTTP requests that could not be tunnelled";
+    g_errors_bad_request = metrics_counter("tunnel_http_errors_total", errors_help, "reason=\"bad_request\"");
+    g_errors_no_tunnel = metrics_counter("tunnel_http_errors_total", errors_help, "reason=\"no_tunnel\"");
+    g_errors_data_timeout = metrics_counter("tunnel_http_errors_total", errors_help, "reason=\"data_timeout\"");
+    g_errors_handshake = metrics_counter("tunnel_http_errors_total", errors_help, "reason=\"handshake\"");
+}
+
 // 前向宣告
 static void *handle_http_request(void *arg);
 static void *handle_control_connection(void *arg);
@@ -131,6 +157,7 @@ static void *handle_http_request(void *arg)
         return NULL;
     }
     buffer[len] = '\0';
+    metrics_inc(g_http_requests);
 
     // 解析Host頭
     if (!parse_host_header(buffer, len, subdomain, sizeof(subdomain)))
@@ -143,6 +170,7 @@ static void *handle_http_request(void *arg)
             "<h1>Bad Request</h1>\r\n";
         send(client_sock, error_response, strlen(error_response), 0);
         close(client_sock);
+        metrics_inc(g_errors_bad_request);
         return NULL;
     }
 
@@ -161,6 +189,7 @@ static void *handle_http_request(void *arg)
             "<h1>Tunnel Not Found</h1><p>No such tunnel</p>";
         send(client_sock, not_found, strlen(not_found), 0);
         close(client_sock);
+        metrics_inc(g_errors_no_tunnel);
         return NULL;
     }
 
@@ -205,6 +234,7 @@ static void *handle_http_request(void *arg)
     {
         log_error("Timeout waiting for data tunnel");
         close(client_sock);
+        metrics_inc(g_errors_data_timeout);
         return NULL;
     }
 
@@ -218,6 +248,7 @@ static void *handle_http_request(void *arg)
         log_error("Invalid data tunnel handshake");
         close(data_sock);
         close(client_sock);
+        metrics_inc(g_errors_handshake);
         return NULL;
     }
 
@@ -225,6 +256,7 @@ static void *handle_http_request(void *arg)
 
     // 發送原始HTTP請求到隧道
     tunnel_send_msg(data_sock, TUNNEL_DATA, session_id, buffer, len);
+    metrics_add(g_bytes_to_tunnel, len);
 
     // 雙向數據轉發
     fd_set read_fds;
@@ -255,6 +287,7 @@ static void *handle_http_request(void *arg)
             {
                 break;
             }
+            metrics_add(g_bytes_to_tunnel, len);
         }
 
         // 隧道 -> HTTP客戶端
@@ -273,6 +306,7 @@ static void *handle_http_request(void *arg)
             if (header.type == TUNNEL_DATA)
             {
                 send(client_sock, buffer, header.data_len, 0);
+                metrics_add(g_bytes_to_client, header.data_len);
             }
         }
     }
@@ -334,6 +368,7 @@ static void *handle_control_connection(void *arg)
     }
 
     pthread_mutex_unlock(&g_server->mutex);
+    metrics_add(g_clients_active, 1);
 
     // 發送域名分配
     DomainAssignment assign;
@@ -393,6 +428,7 @@ static void *handle_control_connection(void *arg)
     pthread_mutex_unlock(&g_server->mutex);
 
     close(client_sock);
+    metrics_add(g_clients_active, -1);
     log_info("Client disconnected: %s", client->subdomain);
 
     return NULL;
@@ -524,6 +560,22 @@ int main(int argc, char *argv[])
     init_logger("tunnel_server.log");
     signal(SIGINT, signal_handler);
     srand(time(NULL));
+    init_metrics();
+
+    // 參數：[--metrics-port N] [--metrics-bind ADDR]
+    int metrics_port = 0;
+    const char *metrics_bind = NULL;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--metrics-port") == 0 && i + 1 < argc)
+        {
+            metrics_port = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--metrics-bind") == 0 && i + 1 < argc)
+        {
+            metrics_bind = argv[++i]; // 預設只監聽 127.0.0.1
+        }
+    }
 
     // 創建服務器
     TunnelServer server;
@@ -537,8 +589,17 @@ int main(int argc, char *argv[])
     printf("  HTTP Port: %d\n", HTTP_PORT);
     printf("  Control Port: %d\n", CONTROL_PORT);
     printf("  Data Port: %d\n", DATA_PORT);
+    if (metrics_port > 0)
+    {
+        printf("  Metrics Port: %d\n", metrics_port);
+    }
     printf("========================================\n\n");
 
+    if (metrics_port > 0)
+    {
+        admin_start(metrics_bind, metrics_port);
+    }
+
     // 啟動服務線程
     pthread_t http_thread, control_thread;
     pthread_create(&http_thread, NULL, http_server_thread, NULL);